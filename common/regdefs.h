@@ -26,4 +26,29 @@ enum {
   REG32_MAX
 };
 
+/// Sections of the head firmware timed by its profile (robot/firmware/profile.h)
+enum {
+  PROF_GAIT,        ///< computation of the setpoints of a tick (ex7 swim_mode)
+  PROF_CAN,         ///< register access or group frame on CAN (can.c)
+  PROF_I2C_LED,     ///< colour written to the RGB LED on I2C (set_rgb)
+  PROF_UART_ISR,    ///< radio receiver interrupt
+  PROF_TIMER1_ISR,  ///< timer1 interrupt, with its user functions
+  PROF_MAX
+};
+
+/// Declaration of all multibyte radio registers
+enum {
+  REGMB_PROFILE,                          ///< first section of the profile, one register per section
+  REGMB_MAX = REGMB_PROFILE + PROF_MAX
+};
+
+/// Record of a section of the profile, as read from its register (little
+/// endian), durations in system timer tics (100 ns)
+struct prof_record {
+  uint32_t count;   ///< times the section ran
+  uint32_t min;     ///< shortest duration
+  uint32_t max;     ///< longest duration
+  uint32_t mean;    ///< mean duration
+};
+
 #endif
@@ -0,0 +1,162 @@
+/*
+ * bootstrap.cc -- parallel percentile bootstrap of summary statistics
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "bootstrap.h"
+
+using namespace std;
+
+double sample_mean(const vector<double>& x)
+{
+  if (x.empty()) return NAN;
+  double s(0);
+  for (size_t i(0); i < x.size(); i++) s += x[i];
+  return s / x.size();
+}
+
+double sample_std(const vector<double>& x)
+{
+  if (x.size() < 2) return NAN;
+  double m = sample_mean(x);
+  double s(0);
+  for (size_t i(0); i < x.size(); i++) s += (x[i] - m) * (x[i] - m);
+  return sqrt(s / (x.size() - 1));
+}
+
+// Hedges' g from the moments of both samples
+static double hedges_g(double mx, double vx, size_t nx, double my, double vy, size_t ny)
+{
+  if (nx < 2 || ny < 2) return NAN;
+  double sp = sqrt(((nx - 1) * vx + (ny - 1) * vy) / (nx + ny - 2));
+  if (sp == 0) return NAN;
+  // small sample bias correction
+  double j = 1.0 - 3.0 / (4.0 * (nx + ny) - 9.0);
+  return j * (my - mx) / sp;
+}
+
+double hedges_g(const vector<double>& x, const vector<double>& y)
+{
+  double sx = sample_std(x), sy = sample_std(y);
+  return hedges_g(sample_mean(x), sx * sx, x.size(), sample_mean(y), sy * sy, y.size());
+}
+
+void percentile_interval(vector<double>& v, double level, double& lo, double& hi)
+{
+  // resamples where the statistic is undefined (e.g. zero variance) are dropped
+  v.erase(remove_if(v.begin(), v.end(), [](double d) { return !isfinite(d); }), v.end());
+  if (v.empty()) {
+    lo = hi = NAN;
+    return;
+  }
+  double a = (1.0 - level) / 2.0;
+  size_t il = (size_t) floor(a * (v.size() - 1));
+  size_t ih = (size_t) ceil((1.0 - a) * (v.size() - 1));
+  nth_element(v.begin(), v.begin() + il, v.end());
+  lo = v[il];
+  nth_element(v.begin() + il, v.begin() + ih, v.end());
+  hi = v[ih];
+}
+
+// Draws a resample of x (with replacement) and returns its mean and unbiased variance
+static void draw(const vector<double>& x, mt19937_64& rng, double& mean, double& var)
+{
+  uniform_int_distribution<size_t> pick(0, x.size() - 1);
+  size_t n = x.size();
+  double s(0), s2(0);
+  for (size_t i(0); i < n; i++) {
+    double v = x[pick(rng)];
+    s += v;
+    s2 += v * v;
+  }
+  mean = s / n;
+  var = n > 1 ? (s2 - s * mean) / (n - 1) : NAN;
+}
+
+CBootstrap::CBootstrap(unsigned int resamples, unsigned int threads, uint64_t seed)
+  : resamples(resamples), threads(threads), seed(seed)
+{
+  if (this->threads == 0) this->threads = thread::hardware_concurrency();
+  if (this->threads == 0) this->threads = 1;
+  if (this->threads > resamples && resamples > 0) this->threads = resamples;
+}
+
+vector<double> CBootstrap::run(const resample_fn& fn) const
+{
+  vector<double> res(resamples);
+  vector<thread> workers;
+
+  for (unsigned int t(0); t < threads; t++) {
+    // each thread fills its own contiguous slice of the results
+    size_t first = (size_t) resamples * t / threads;
+    size_t last = (size_t) resamples * (t + 1) / threads;
+    workers.push_back(thread([&, t, first, last]() {
+      seed_seq seq{ (uint32_t) seed, (uint32_t) (seed >> 32), (uint32_t) t };
+      mt19937_64 rng(seq);
+      for (size_t i(first); i < last; i++) res[i] = fn(rng);
+    }));
+  }
+  for (size_t i(0); i < workers.size(); i++) workers[i].join();
+
+  return res;
+}
+
+ci_result CBootstrap::mean_ci(const vector<double>& x, double level) const
+{
+  ci_result r;
+  r.value = sample_mean(x);
+  if (x.empty()) {
+    r.lo = r.hi = NAN;
+    return r;
+  }
+
+  vector<double> v = run([&x](mt19937_64& rng) {
+    double m, var;
+    draw(x, rng, m, var);
+    return m;
+  });
+  percentile_interval(v, level, r.lo, r.hi);
+  return r;
+}
+
+ci_result CBootstrap::diff_ci(const vector<double>& x, const vector<double>& y,
+                              double level) const
+{
+  ci_result r;
+  r.value = sample_mean(y) - sample_mean(x);
+  if (x.empty() || y.empty()) {
+    r.lo = r.hi = NAN;
+    return r;
+  }
+
+  vector<double> v = run([&x, &y](mt19937_64& rng) {
+    double mx, vx, my, vy;
+    draw(x, rng, mx, vx);
+    draw(y, rng, my, vy);
+    return my - mx;
+  });
+  percentile_interval(v, level, r.lo, r.hi);
+  return r;
+}
+
+ci_result CBootstrap::hedges_g_ci(const vector<double>& x, const vector<double>& y,
+                                  double level) const
+{
+  ci_result r;
+  r.value = hedges_g(x, y);
+  if (x.size() < 2 || y.size() < 2) {
+    r.lo = r.hi = NAN;
+    return r;
+  }
+
+  vector<double> v = run([&x, &y](mt19937_64& rng) {
+    double mx, vx, my, vy;
+    draw(x, rng, mx, vx);
+    draw(y, rng, my, vy);
+    return hedges_g(mx, vx, x.size(), my, vy, y.size());
+  });
+  percentile_interval(v, level, r.lo, r.hi);
+  return r;
+}
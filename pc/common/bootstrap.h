@@ -0,0 +1,81 @@
+#ifndef __BOOTSTRAP_H
+#define __BOOTSTRAP_H
+
+#include <stdint.h>
+#include <functional>
+#include <random>
+#include <vector>
+
+/// Point estimate of a statistic with its confidence interval
+struct ci_result {
+  double value;   ///< statistic computed on the original samples
+  double lo;      ///< lower bound of the confidence interval
+  double hi;      ///< upper bound of the confidence interval
+};
+
+/** \brief Percentile bootstrap, with the resamples distributed over several
+  *   threads. Each thread draws from its own random stream, derived from the
+  *   seed and the thread number, so results are reproducible for a given
+  *   seed and thread count.
+  */
+class CBootstrap {
+
+public:
+
+  /// Statistic evaluated on one resample, using the given random generator
+  typedef std::function<double(std::mt19937_64&)> resample_fn;
+
+  /** \brief Constructor
+    * \param resamples Number of bootstrap resamples
+    * \param threads Number of worker threads (0 = number of cores)
+    * \param seed Seed of the random streams
+    */
+  CBootstrap(unsigned int resamples = 10000, unsigned int threads = 0, uint64_t seed = 1);
+
+  /** \brief Confidence interval of the mean of a sample
+    * \param x The samples
+    * \param level Confidence level (e.g. 0.95)
+    */
+  ci_result mean_ci(const std::vector<double>& x, double level = 0.95) const;
+
+  /// Confidence interval of the difference of the means (mean(y) - mean(x))
+  ci_result diff_ci(const std::vector<double>& x, const std::vector<double>& y,
+                    double level = 0.95) const;
+
+  /// Confidence interval of Hedges' g effect size between x and y (positive if y > x)
+  ci_result hedges_g_ci(const std::vector<double>& x, const std::vector<double>& y,
+                        double level = 0.95) const;
+
+  /** \brief Evaluates a statistic on all the resamples, in parallel
+    * \param fn Function computing the statistic of one resample
+    * \return The statistic values, in no particular order
+    */
+  std::vector<double> run(const resample_fn& fn) const;
+
+  /// Number of worker threads actually used
+  unsigned int thread_count() const { return threads; }
+
+private:
+
+  unsigned int resamples;
+  unsigned int threads;
+  uint64_t seed;
+
+};
+
+/// Mean of a sample (NAN if empty)
+double sample_mean(const std::vector<double>& x);
+
+/// Unbiased standard deviation of a sample (NAN if less than two values)
+double sample_std(const std::vector<double>& x);
+
+/// Hedges' g (bias-corrected standardized mean difference, positive if y > x)
+double hedges_g(const std::vector<double>& x, const std::vector<double>& y);
+
+/** \brief Percentile interval of a set of statistic values
+  * \param v The values (reordered by the function)
+  * \param level Confidence level
+  */
+void percentile_interval(std::vector<double>& v, double level, double& lo, double& hi);
+
+#endif
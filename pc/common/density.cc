@@ -0,0 +1,151 @@
+/*
+ * density.cc -- occupancy and velocity fields of tracked trajectories
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include "density.h"
+
+using namespace std;
+
+CDensityGrid::CDensityGrid(double width, double height, double cell)
+  : width(width), height(height), cell(cell)
+{
+  nx = (int) ceil(width / cell);
+  ny = (int) ceil(height / cell);
+  if (nx < 1) nx = 1;
+  if (ny < 1) ny = 1;
+  clear();
+}
+
+void CDensityGrid::clear()
+{
+  total = 0;
+  time.assign(nx * ny, 0.0);
+  sum_vx.assign(nx * ny, 0.0);
+  sum_vy.assign(nx * ny, 0.0);
+}
+
+inline void CDensityGrid::add_point(double x, double y, double w, double vx, double vy)
+{
+  if (x < 0 || y < 0) return;
+  int ix = (int) (x / cell);
+  int iy = (int) (y / cell);
+  if (ix >= nx || iy >= ny) return;
+  int i = iy * nx + ix;
+  time[i] += w;
+  sum_vx[i] += w * vx;
+  sum_vy[i] += w * vy;
+  total += w;
+}
+
+void CDensityGrid::add_run(const vector<track_sample>& samples, bool segments, int64_t max_gap)
+{
+  for (size_t i(0); i + 1 < samples.size(); i++) {
+    const track_sample& a = samples[i];
+    const track_sample& b = samples[i + 1];
+    int64_t gap = b.t - a.t;
+    if (gap <= 0 || gap > max_gap) continue;
+
+    double dt = gap / 1000.0;
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double vx = dx / dt;
+    double vy = dy / dt;
+
+    if (!segments) {
+      add_point(a.x, a.y, dt, vx, vy);
+      continue;
+    }
+
+    // splits the segment in pieces of at most half a cell, each one
+    // receiving its share of the time at its middle point
+    int k = (int) ceil(sqrt(dx * dx + dy * dy) / (cell / 2));
+    if (k < 1) k = 1;
+    for (int j(0); j < k; j++) {
+      double f = (j + 0.5) / k;
+      add_point(a.x + f * dx, a.y + f * dy, dt / k, vx, vy);
+    }
+  }
+}
+
+void CDensityGrid::merge(const CDensityGrid& other)
+{
+  if (other.nx != nx || other.ny != ny) return;
+  for (size_t i(0); i < time.size(); i++) {
+    time[i] += other.time[i];
+    sum_vx[i] += other.sum_vx[i];
+    sum_vy[i] += other.sum_vy[i];
+  }
+  total += other.total;
+}
+
+int CDensityGrid::add_files(const vector<string>& files, bool segments, unsigned int threads)
+{
+  if (threads == 0) threads = thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+  if (threads > files.size()) threads = files.size();
+
+  vector<CDensityGrid> partial(threads, CDensityGrid(width, height, cell));
+  vector<thread> workers;
+  atomic<size_t> next(0);
+  atomic<int> loaded(0);
+
+  for (unsigned int t(0); t < threads; t++) {
+    workers.push_back(thread([&, t]() {
+      vector<track_sample> samples;
+      // the files are handed out one by one, as their sizes vary a lot
+      for (size_t i = next++; i < files.size(); i = next++) {
+        if (load_run_log(files[i], samples)) {
+          partial[t].add_run(samples, segments);
+          loaded++;
+        }
+      }
+    }));
+  }
+  for (unsigned int t(0); t < threads; t++) {
+    workers[t].join();
+    merge(partial[t]);
+  }
+
+  return loaded;
+}
+
+void CDensityGrid::mean_velocity(int ix, int iy, double& vx, double& vy) const
+{
+  int i = iy * nx + ix;
+  if (time[i] > 0) {
+    vx = sum_vx[i] / time[i];
+    vy = sum_vy[i] / time[i];
+  } else {
+    vx = vy = 0;
+  }
+}
+
+bool CDensityGrid::write_csv(const char* filename) const
+{
+  FILE* f = fopen(filename, "w");
+  if (!f) {
+    perror(filename);
+    return false;
+  }
+
+  fprintf(f, "X,Y,Occupancy,Fraction,VX,VY\n");
+  for (int iy(0); iy < ny; iy++) {
+    for (int ix(0); ix < nx; ix++) {
+      int i = iy * nx + ix;
+      double x = (ix + 0.5) * cell;
+      double y = (iy + 0.5) * cell;
+      fprintf(f, "%.3f,%.3f,%.4f,%.6f", x, y, time[i], total > 0 ? time[i] / total : 0.0);
+      if (time[i] > 0) {
+        fprintf(f, ",%.4f,%.4f\n", sum_vx[i] / time[i], sum_vy[i] / time[i]);
+      } else {
+        fprintf(f, ",,\n");
+      }
+    }
+  }
+
+  return fclose(f) == 0;
+}
@@ -0,0 +1,82 @@
+#ifndef __DENSITY_H
+#define __DENSITY_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "runlog.h"
+
+/** \brief Occupancy and mean velocity fields over a regular grid covering the
+  *   tank. Each sample contributes the time until the next one to the cell it
+  *   lies in, together with its velocity weighted by that time.
+  */
+class CDensityGrid {
+
+public:
+
+  /** \brief Constructor
+    * \param width Size of the covered area along x [m]
+    * \param height Size of the covered area along y [m]
+    * \param cell Size of one (square) cell [m]
+    */
+  CDensityGrid(double width, double height, double cell);
+
+  /** \brief Adds the samples of one run
+    * \param samples The samples of the run, in time order
+    * \param segments If true, the time between two samples is spread along the
+    *   segment joining them instead of being assigned to the first point
+    * \param max_gap Time gap [ms] above which two samples are not considered
+    *   consecutive (e.g. when the spot was lost)
+    */
+  void add_run(const std::vector<track_sample>& samples, bool segments = false,
+               int64_t max_gap = 500);
+
+  /// Adds the contents of another grid of the same geometry
+  void merge(const CDensityGrid& other);
+
+  /// Clears all the cells
+  void clear();
+
+  /** \brief Bins a set of log files, in parallel. Each thread reads and bins
+    *   its share of the files into its own grid, the grids are merged at the end.
+    * \param files Paths of the log files (CSV or .trk)
+    * \param segments See add_run()
+    * \param threads Number of threads (0 = number of cores)
+    * \return The number of files that could be read
+    */
+  int add_files(const std::vector<std::string>& files, bool segments = false,
+                unsigned int threads = 0);
+
+  /** \brief Writes the fields as CSV, one line per cell with its center, the
+    *   occupancy (total time, in s), the fraction of the total time and the
+    *   mean velocity (in m/s, empty for unvisited cells)
+    * \return true on success, false if the file cannot be written
+    */
+  bool write_csv(const char* filename) const;
+
+  /// Number of cells along x
+  int size_x() const { return nx; }
+  /// Number of cells along y
+  int size_y() const { return ny; }
+  /// Total time accumulated in the grid [s]
+  double total_time() const { return total; }
+  /// Time spent in a cell [s]
+  double occupancy(int ix, int iy) const { return time[iy * nx + ix]; }
+  /// Mean velocity in a cell [m/s] (0 if the cell was never visited)
+  void mean_velocity(int ix, int iy, double& vx, double& vy) const;
+
+private:
+
+  /// Adds a weighted velocity sample at a position (ignored if outside the grid)
+  void add_point(double x, double y, double w, double vx, double vy);
+
+  double width, height, cell;
+  int nx, ny;
+  double total;
+  std::vector<double> time;    ///< time spent in each cell [s]
+  std::vector<double> sum_vx;  ///< time-weighted sum of the x velocities
+  std::vector<double> sum_vy;  ///< time-weighted sum of the y velocities
+
+};
+
+#endif
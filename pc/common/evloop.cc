@@ -0,0 +1,301 @@
+/*
+ * evloop.cc -- event loop waiting on sockets, keyboard, timers and other threads
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+
+#ifdef _WIN32
+  #include <winsock2.h>
+  #include <windows.h>
+  #include "wperror.h"
+  #define perror wperror
+#else
+  #include <unistd.h>
+  #include <sys/epoll.h>
+  #include <sys/eventfd.h>
+  #include <sys/timerfd.h>
+#endif
+
+#include "evloop.h"
+
+using namespace std;
+
+#ifndef _WIN32
+/// epoll tags of the timer and of the wake-up event, the sources follow
+enum { TAG_TIMER = 0, TAG_WAKE = 1, TAG_SOURCES = 2 };
+#endif
+
+CEventLoop::CEventLoop() : ok(false), running(false), next_timer(0)
+{
+#ifdef _WIN32
+  timer_handle = NULL;
+#ifdef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+  // the default timers have the resolution of the system tick (~15 ms)
+  timer_handle = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+  if (!timer_handle) timer_handle = CreateWaitableTimer(NULL, FALSE, NULL);
+  wake_handle = CreateEvent(NULL, FALSE, FALSE, NULL);
+  ok = timer_handle && wake_handle;
+  if (!ok) perror("CEventLoop");
+#else
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epfd < 0 || timer_fd < 0 || wake_fd < 0) {
+    perror("CEventLoop");
+    return;
+  }
+  epoll_event e;
+  e.events = EPOLLIN;
+  e.data.u32 = TAG_TIMER;
+  ok = epoll_ctl(epfd, EPOLL_CTL_ADD, timer_fd, &e) == 0;
+  e.data.u32 = TAG_WAKE;
+  ok = ok && epoll_ctl(epfd, EPOLL_CTL_ADD, wake_fd, &e) == 0;
+  if (!ok) perror("epoll_ctl");
+#endif
+}
+
+CEventLoop::~CEventLoop()
+{
+#ifdef _WIN32
+  for (size_t i(0); i < sources.size(); i++) {
+    if (sources[i].fd < 0) continue;
+    // gives the socket back in blocking mode
+    SOCKET s = (SOCKET) sources[i].fd;
+    u_long nb = 0;
+    WSAEventSelect(s, NULL, 0);
+    ioctlsocket(s, FIONBIO, &nb);
+    WSACloseEvent((WSAEVENT) sources[i].event);
+  }
+  if (timer_handle) CloseHandle(timer_handle);
+  if (wake_handle) CloseHandle(wake_handle);
+#else
+  if (epfd >= 0) close(epfd);
+  if (timer_fd >= 0) close(timer_fd);
+  if (wake_fd >= 0) close(wake_fd);
+#endif
+}
+
+double CEventLoop::now()
+{
+  return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CEventLoop::watch_socket(int sock, const handler& h)
+{
+  if (!ok) return false;
+  source s = { sock, h, NULL };
+#ifdef _WIN32
+  WSAEVENT ev = WSACreateEvent();
+  if (ev == WSA_INVALID_EVENT || WSAEventSelect((SOCKET) sock, ev, FD_READ | FD_CLOSE) != 0) {
+    perror("WSAEventSelect");
+    if (ev != WSA_INVALID_EVENT) WSACloseEvent(ev);
+    return false;
+  }
+  s.event = ev;
+#else
+  epoll_event e;
+  e.events = EPOLLIN;
+  e.data.u32 = TAG_SOURCES + sources.size();
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &e) != 0) {
+    perror("epoll_ctl");
+    return false;
+  }
+#endif
+  sources.push_back(s);
+  return true;
+}
+
+bool CEventLoop::watch_input(const handler& h)
+{
+  if (!ok) return false;
+  source s = { -1, h, NULL };
+#ifndef _WIN32
+  epoll_event e;
+  e.events = EPOLLIN;
+  e.data.u32 = TAG_SOURCES + sources.size();
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, STDIN_FILENO, &e) != 0) {
+    perror("epoll_ctl");
+    return false;
+  }
+#endif
+  sources.push_back(s);
+  return true;
+}
+
+int CEventLoop::add_timer(double delay, const handler& h)
+{
+  timer t = { now() + delay, next_timer++, h };
+  timers.push_back(t);
+  arm_timer();
+  return t.id;
+}
+
+void CEventLoop::cancel_timer(int id)
+{
+  for (size_t i(0); i < timers.size(); i++) {
+    if (timers[i].id == id) {
+      timers.erase(timers.begin() + i);
+      arm_timer();
+      return;
+    }
+  }
+}
+
+void CEventLoop::post(const handler& h)
+{
+  {
+    lock_guard<mutex> lock(guard);
+    posted.push_back(h);
+  }
+#ifdef _WIN32
+  SetEvent(wake_handle);
+#else
+  uint64_t one = 1;
+  if (write(wake_fd, &one, sizeof(one)) != sizeof(one)) perror("eventfd");
+#endif
+}
+
+bool CEventLoop::arm_timer()
+{
+  if (!ok) return false;
+  // time to the earliest deadline, negative if none
+  double delay(-1);
+  if (!timers.empty()) {
+    double first = timers[0].deadline;
+    for (size_t i(1); i < timers.size(); i++) first = min(first, timers[i].deadline);
+    delay = max(first - now(), 1e-6);
+  }
+
+#ifdef _WIN32
+  if (delay < 0) return CancelWaitableTimer(timer_handle);
+  LARGE_INTEGER due;
+  due.QuadPart = -max((LONGLONG) (delay * 1e7), (LONGLONG) 1);   // relative, in 100 ns
+  if (!SetWaitableTimer(timer_handle, &due, 0, NULL, NULL, FALSE)) {
+    perror("SetWaitableTimer");
+    return false;
+  }
+#else
+  // a zero time disarms the timer
+  itimerspec its = {};
+  if (delay >= 0) {
+    its.it_value.tv_sec = (time_t) delay;
+    its.it_value.tv_nsec = max((long) ((delay - its.it_value.tv_sec) * 1e9), 1L);
+  }
+  if (timerfd_settime(timer_fd, 0, &its, NULL) != 0) {
+    perror("timerfd_settime");
+    return false;
+  }
+#endif
+  return true;
+}
+
+void CEventLoop::run_timers()
+{
+#ifndef _WIN32
+  uint64_t n;
+  if (read(timer_fd, &n, sizeof(n)) < 0) {
+    // spurious wake-up, the timer has been re-armed meanwhile
+  }
+#endif
+  double t = now();
+  // the due timers run one at a time in deadline order, each still registered
+  // when its turn comes, as a handler may cancel another one; the timers
+  // added by the handlers wait for the next pass
+  int added = next_timer;
+  while (running) {
+    size_t first = timers.size();
+    for (size_t i(0); i < timers.size(); i++) {
+      if (timers[i].deadline <= t && timers[i].id < added &&
+          (first == timers.size() || timers[i].deadline < timers[first].deadline)) first = i;
+    }
+    if (first == timers.size()) break;
+    handler h = timers[first].h;
+    timers.erase(timers.begin() + first);
+    h();
+  }
+  arm_timer();
+}
+
+void CEventLoop::run_posted()
+{
+#ifndef _WIN32
+  uint64_t n;
+  if (read(wake_fd, &n, sizeof(n)) < 0) {
+    // already drained
+  }
+#endif
+  vector<handler> work;
+  {
+    lock_guard<mutex> lock(guard);
+    work.swap(posted);
+  }
+  for (size_t i(0); i < work.size(); i++) work[i]();
+}
+
+void CEventLoop::run_source(size_t i)
+{
+  // the handler may add sources, which moves the vector
+  handler h = sources[i].h;
+#ifdef _WIN32
+  if (sources[i].fd >= 0) {
+    SOCKET s = (SOCKET) sources[i].fd;
+    WSAEVENT ev = (WSAEVENT) sources[i].event;
+    WSANETWORKEVENTS ne;
+    u_long nb = 0;
+    WSAEnumNetworkEvents(s, ev, &ne);
+    WSAEventSelect(s, NULL, 0);
+    ioctlsocket(s, FIONBIO, &nb);
+    h();
+    // signals again at once if data remain
+    WSAEventSelect(s, ev, FD_READ | FD_CLOSE);
+    return;
+  }
+#endif
+  h();
+}
+
+bool CEventLoop::run()
+{
+  if (!ok) return false;
+  running = true;
+
+  while (running) {
+#ifdef _WIN32
+    HANDLE h[MAXIMUM_WAIT_OBJECTS];
+    DWORD n(0);
+    h[n++] = timer_handle;
+    h[n++] = wake_handle;
+    for (size_t i(0); i < sources.size() && n < MAXIMUM_WAIT_OBJECTS; i++) {
+      h[n++] = sources[i].fd < 0 ? GetStdHandle(STD_INPUT_HANDLE) : (HANDLE) sources[i].event;
+    }
+    DWORD r = WaitForMultipleObjects(n, h, FALSE, INFINITE);
+    if (r == WAIT_FAILED || r >= WAIT_OBJECT_0 + n) {
+      perror("WaitForMultipleObjects");
+      running = false;
+      return false;
+    }
+    if (r == WAIT_OBJECT_0) run_timers();
+    else if (r == WAIT_OBJECT_0 + 1) run_posted();
+    else run_source(r - WAIT_OBJECT_0 - 2);
+#else
+    epoll_event e[16];
+    int n = epoll_wait(epfd, e, 16, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      perror("epoll_wait");
+      running = false;
+      return false;
+    }
+    for (int i(0); i < n && running; i++) {
+      if (e[i].data.u32 == TAG_TIMER) run_timers();
+      else if (e[i].data.u32 == TAG_WAKE) run_posted();
+      else run_source(e[i].data.u32 - TAG_SOURCES);
+    }
+#endif
+  }
+  return true;
+}
@@ -0,0 +1,97 @@
+#ifndef __EVLOOP_H
+#define __EVLOOP_H
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/** \brief Single-threaded event loop, sleeping until a socket is readable,
+  *   a key is pressed, a timer expires or another thread posts some work
+  *   (e.g. the completion of a radio transfer). It uses epoll, timerfd and
+  *   eventfd on Linux, and WaitForMultipleObjects on Windows.
+  *
+  *   All the handlers run in the thread calling run(). On Windows, a watched
+  *   socket is non-blocking while the loop waits, but it is back in blocking
+  *   mode while its handler runs and once the loop is destroyed.
+  */
+class CEventLoop {
+
+public:
+
+  typedef std::function<void()> handler;
+
+  CEventLoop();
+  ~CEventLoop();
+
+  /// Calls h each time the socket has data to read (or has been closed)
+  bool watch_socket(int sock, const handler& h);
+
+  /** \brief Calls h each time keyboard input is waiting. The handler has to
+    *   consume the key presses (see ext_key()), otherwise it is called again
+    *   immediately.
+    */
+  bool watch_input(const handler& h);
+
+  /** \brief Calls h once, after a delay
+    * \param delay Delay from now [s]
+    * \return An identifier for cancel_timer()
+    */
+  int add_timer(double delay, const handler& h);
+
+  /// Cancels a timer that has not expired yet
+  void cancel_timer(int id);
+
+  /// Calls h from the loop as soon as possible; can be called from any thread
+  void post(const handler& h);
+
+  /// Runs the handlers until stop() is called, returns false on error
+  bool run();
+
+  /// Makes run() return after the current handler
+  void stop() { running = false; }
+
+  /// true while run() is running and not stopped
+  bool is_running() const { return running; }
+
+  /// Monotonic time [s], as used by the timers
+  static double now();
+
+private:
+
+  struct source {
+    int fd;           ///< socket, or -1 for the keyboard
+    handler h;
+    void* event;      ///< event associated with the socket (Windows)
+  };
+
+  struct timer {
+    double deadline;
+    int id;
+    handler h;
+  };
+
+  /// Sets the system timer to the earliest deadline
+  bool arm_timer();
+  void run_timers();
+  void run_posted();
+  void run_source(size_t i);
+
+  bool ok;
+  bool running;
+  std::vector<source> sources;
+  std::vector<timer> timers;
+  int next_timer;
+
+  std::mutex guard;              ///< protects posted
+  std::vector<handler> posted;
+
+#ifdef _WIN32
+  void* timer_handle;            ///< waitable timer
+  void* wake_handle;             ///< event set by post()
+#else
+  int epfd, timer_fd, wake_fd;
+#endif
+
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef __GAIT_H
+#define __GAIT_H
+
+#include <stdint.h>
+#include "regdefs.h"
+
+/// Idle mode: do nothing
+#define IMODE_IDLE 0
+
+/// set the robot in a warped and rigid position (prevent capsizing)
+#define IMODE_READY 1
+
+/// active swimming mode
+#define IMODE_SWIM 2
+
+// Define limits for frequency and amplitude
+#define MAX_FREQ 1.5f  // Maximum frequency in Hz
+#define MAX_AMP 60.0f  // Maximum amplitude in degrees
+#define MAX_LAG 1.5f // Maximum lag between elements in degrees
+#define MAX_OFF 3.0f // Maximum offset in degrees
+
+#define MIN_FREQ 0.1f
+#define MIN_AMP 1.0f  // Min amplitude in degrees
+#define MIN_LAG 0.5f // Min lag between elements in degrees
+#define MIN_OFF -3.0f // Min offset in degrees
+
+// Define registers for frequency, lag, offset and amplitude control
+#define REG8_SINE_FREQ 10 // Register for sine wave frequency
+#define REG8_SINE_AMP 11  // Register for sine wave amplitude
+#define REG8_SINE_LAG 12  // Register for sine wave lag between elements
+#define REG8_SINE_OFF 13  // Register for sine wave offset
+
+/// Gait parameters of the swimming controller
+struct gait_params {
+  float freq;   ///< oscillation frequency [Hz]
+  float amp;    ///< amplitude [deg]
+  float lag;    ///< lag between elements
+  float off;    ///< offset [deg]
+};
+
+/// Clamps a parameter to its range and encodes it as a register value
+inline uint8_t encode_gait_param(float value, float min_value, float max_value)
+{
+  if (value < min_value) value = min_value;
+  if (value > max_value) value = max_value;
+  return ENCODE_PARAM_8(value, min_value, max_value);
+}
+
+/** \brief Rounds the gait parameters to the values the robot actually
+  *   receives once encoded in its 8-bit registers
+  */
+inline gait_params quantize_gait(const gait_params& g)
+{
+  gait_params q;
+  q.freq = DECODE_PARAM_8(encode_gait_param(g.freq, MIN_FREQ, MAX_FREQ), MIN_FREQ, MAX_FREQ);
+  q.amp = DECODE_PARAM_8(encode_gait_param(g.amp, MIN_AMP, MAX_AMP), MIN_AMP, MAX_AMP);
+  q.lag = DECODE_PARAM_8(encode_gait_param(g.lag, MIN_LAG, MAX_LAG), MIN_LAG, MAX_LAG);
+  q.off = DECODE_PARAM_8(encode_gait_param(g.off, MIN_OFF, MAX_OFF), MIN_OFF, MAX_OFF);
+  return q;
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * geofence.cc -- prediction of the collisions with the walls of the tank
+ */
+
+#include <chrono>
+#include <cmath>
+#include "geofence.h"
+
+using namespace std;
+
+CGeofence::CGeofence(double width, double height, const fence_settings& s)
+  : s(s), width(width), height(height)
+{
+  reset();
+  compute_time.clear();
+  steered = stopped = 0;
+}
+
+void CGeofence::reset()
+{
+  hist.clear();
+  act = FENCE_NONE;
+  ttc = INFINITY;
+  offset = 0;
+}
+
+// Time to reach the lower or the upper bound of an interval at speed v, 0 if
+// already beyond it
+static double time_to_bound(double p, double v, double lo, double hi)
+{
+  if (v > 0) return max(0.0, (hi - p) / v);
+  if (v < 0) return max(0.0, (lo - p) / v);
+  return INFINITY;
+}
+
+fence_action CGeofence::update(double t, bool detected, double x, double y)
+{
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+
+  if (detected && act != FENCE_STOP) {
+    pos p = { t, x, y };
+    hist.push_back(p);
+    while (hist.size() > 2 && t - hist.front().t > s.window) hist.pop_front();
+
+    double dt = t - hist.front().t;
+    if (dt > 0 && dt <= 2 * s.window) {
+      double vx = (x - hist.front().x) / dt;
+      double vy = (y - hist.front().y) / dt;
+
+      // the velocity is that of the middle of the window, and an intervention
+      // decided now acts one latency later
+      double ahead = dt / 2 + s.latency;
+      double px = x + vx * ahead, py = y + vy * ahead;
+      double tx = time_to_bound(px, vx, s.wall_margin, width - s.wall_margin);
+      double ty = time_to_bound(py, vy, s.wall_margin, height - s.wall_margin);
+      ttc = hypot(vx, vy) < s.min_speed ? INFINITY : min(tx, ty);
+
+      if (ttc < s.stop_ttc) {
+        act = FENCE_STOP;
+        stopped++;
+      } else if (act == FENCE_NONE && ttc < s.steer_ttc) {
+        // turns the shortest way to swim along the wall rather than into it
+        // (towards the middle of the tank if heading straight at the wall),
+        // keeping the same side until released
+        double nx = 0, ny = 0;
+        if (tx < ty) nx = vx > 0 ? -1 : 1;
+        else ny = vy > 0 ? -1 : 1;
+        double cross = vx * ny - vy * nx;
+        if (fabs(cross) < 0.1 * hypot(vx, vy)) cross = vx * (height / 2 - y) - vy * (width / 2 - x);
+        offset = cross >= 0 ? s.steer_offset : -s.steer_offset;
+        act = FENCE_STEER;
+        steered++;
+      } else if (act == FENCE_STEER && ttc > s.release_ttc) {
+        act = FENCE_NONE;
+      }
+    }
+  }
+
+  compute_time.add(chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+  return act;
+}
@@ -0,0 +1,91 @@
+#ifndef __GEOFENCE_H
+#define __GEOFENCE_H
+
+#include <stdint.h>
+#include <deque>
+#include "timing.h"
+
+/// Interventions of the geofence, also used as event codes in the logs and timeline marks
+enum fence_action {
+  FENCE_NONE = 0,     ///< no intervention
+  FENCE_STEER = 1,    ///< the offset and the frequency are overridden to turn away from the wall
+  FENCE_STOP = 2      ///< the robot is set to ready mode
+};
+
+/// Thresholds of the geofence
+struct fence_settings {
+  double wall_margin;   ///< distance from a wall at which the robot counts as hitting it [m]
+  double steer_ttc;     ///< time to collision below which the robot is steered away [s]
+  double release_ttc;   ///< time to collision above which the steering override ends [s]
+  double stop_ttc;      ///< time to collision below which the robot is stopped [s]
+  double window;        ///< time window of the velocity estimate [s]
+  double min_speed;     ///< speed below which no collision is predicted [m/s]
+  float steer_offset;   ///< offset turning towards increasing headings [deg]
+  float steer_freq;     ///< frequency while steering away [Hz]
+  double latency;       ///< time from the capture of a frame to the effect of a command [s]
+
+  fence_settings() : wall_margin(0.05), steer_ttc(1.5), release_ttc(3.0), stop_ttc(0.5),
+                     window(1.0), min_speed(0.01), steer_offset(3.0f), steer_freq(0.6f),
+                     latency(0) {}
+};
+
+/** \brief Keeps the robot away from the walls of the tank. The velocity is
+  *   estimated over a time window covering a gait period, the position is
+  *   extrapolated over the delay of the window and the latency (the time an
+  *   intervention takes to act) and the time to collision is the time to
+  *   reach the closest wall along the velocity. A steering
+  *   override ends once the time to collision is long again; a stop lasts
+  *   until the geofence is reset.
+  */
+class CGeofence {
+
+public:
+
+  /** \brief Constructor
+    * \param width Size of the tank along x [m]
+    * \param height Size of the tank along y [m]
+    * \param s Thresholds
+    */
+  CGeofence(double width, double height, const fence_settings& s = fence_settings());
+
+  /// Forgets the positions and ends any intervention
+  void reset();
+
+  /** \brief Processes a tracking frame (the intervention is kept while the
+    *   robot is not detected)
+    * \param t Time of the frame [s]
+    * \param detected true if the robot was found, at (x, y)
+    * \return The intervention required
+    */
+  fence_action update(double t, bool detected, double x, double y);
+
+  /// Current intervention
+  fence_action action() const { return act; }
+
+  /// Predicted time to collision [s], INFINITY if none
+  double time_to_collision() const { return ttc; }
+
+  /// Offset turning away from the wall, chosen when the steering override starts [deg]
+  float steer_offset() const { return offset; }
+
+  /// Settings
+  const fence_settings& settings() const { return s; }
+
+  CTimingStats compute_time;    ///< time spent in update()
+  unsigned int steered;         ///< number of steering overrides
+  unsigned int stopped;         ///< number of stops
+
+private:
+
+  struct pos { double t, x, y; };
+
+  fence_settings s;
+  double width, height;
+  std::deque<pos> hist;
+  fence_action act;
+  double ttc;
+  float offset;
+
+};
+
+#endif
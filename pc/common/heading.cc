@@ -0,0 +1,147 @@
+/*
+ * heading.cc -- heading estimation and closed-loop steering with the gait offset
+ */
+
+#include <chrono>
+#include <cmath>
+#include "gait.h"
+#include "heading.h"
+
+using namespace std;
+
+// Wraps an angle to [-pi, pi]
+static double wrap_angle(double a)
+{
+  return atan2(sin(a), cos(a));
+}
+
+CHeadingEstimator::CHeadingEstimator(double window, double min_dist)
+  : window(window), min_dist(min_dist)
+{
+  reset();
+}
+
+void CHeadingEstimator::reset()
+{
+  hist.clear();
+  h = 0;
+  ok = false;
+}
+
+bool CHeadingEstimator::update(double t, double x, double y)
+{
+  pos p = { t, x, y };
+  hist.push_back(p);
+  while (hist.size() > 2 && t - hist.front().t > window) hist.pop_front();
+
+  double dx = x - hist.front().x;
+  double dy = y - hist.front().y;
+  ok = hist.size() >= 2 && t - hist.front().t <= 2 * window && dx * dx + dy * dy >= min_dist * min_dist;
+  if (ok) h = atan2(dy, dx);
+  return ok;
+}
+
+CPid::CPid(const pid_gains& g) : g(g)
+{
+  reset();
+}
+
+void CPid::reset()
+{
+  integral = 0;
+  sat = false;
+}
+
+double CPid::update(double error, double rate, double dt)
+{
+  double i = integral + error * dt;
+  double u = g.kp * error + g.ki * i - g.kd * rate;
+
+  // the integrator only moves if it does not push the output further into
+  // saturation
+  sat = false;
+  if (u > g.out_max) {
+    sat = true;
+    if (error * g.ki < 0) integral = i;
+    u = g.out_max;
+  } else if (u < g.out_min) {
+    sat = true;
+    if (error * g.ki > 0) integral = i;
+    u = g.out_min;
+  } else {
+    integral = i;
+  }
+  return u;
+}
+
+CHeadingController::CHeadingController(const pid_gains& gains, double write_interval)
+  : pid(gains), target(0), write_interval(write_interval)
+{
+  reset();
+}
+
+void CHeadingController::reset()
+{
+  est.reset();
+  pred.reset();
+  pid.reset();
+  frame_period.clear();
+  compute_time.clear();
+  write_time.clear();
+  writes = skipped = saturated = 0;
+  last_frame = last_update = last_write = -1;
+  last_heading = 0;
+  last_code = -1;
+}
+
+bool CHeadingController::update(double t, bool detected, double x, double y, float& offset)
+{
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  bool write(false);
+
+  if (last_frame >= 0) frame_period.add((t - last_frame) * 1e6);
+  last_frame = t;
+
+  bool valid = detected && est.update(t, x, y);
+  double h = est.heading();
+  double dt = last_update >= 0 ? t - last_update : 0;
+  double rate = dt > 0 ? wrap_angle(h - last_heading) / dt : 0;
+  if (pred.latency() > 0) {
+    valid = pred.update(t, detected, x, y) && detected;
+    h = pred.predicted().heading;
+    rate = pred.predicted().yaw_rate;
+  }
+
+  if (valid) {
+    double u = pid.update(wrap_angle(target - h), rate, dt);
+    last_update = t;
+    last_heading = h;
+    if (pid.saturated()) saturated++;
+
+    // writes only the changes the robot can see, not faster than the radio allows
+    int code = encode_gait_param(u, MIN_OFF, MAX_OFF);
+    if (code != last_code) {
+      if (last_write < 0 || t - last_write >= write_interval) {
+        offset = u;
+        last_code = code;
+        last_write = t;
+        writes++;
+        write = true;
+      } else {
+        skipped++;
+      }
+    }
+  }
+
+  compute_time.add(chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+  return write;
+}
+
+void CHeadingController::print_stats(FILE* f) const
+{
+  frame_period.print("Frame period", f);
+  compute_time.print("Controller time", f);
+  write_time.print("Register writes", f);
+  fprintf(f, "%u write(s), %u frame(s) delayed by the rate limit, %u saturated frame(s)\n",
+          writes, skipped, saturated);
+}
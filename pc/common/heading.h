@@ -0,0 +1,168 @@
+#ifndef __HEADING_H
+#define __HEADING_H
+
+#include <deque>
+#include "predict.h"
+#include "timing.h"
+
+/** \brief Estimates the heading of the robot from the tracked positions. As
+  *   the head oscillates sideways at the gait frequency, the heading is the
+  *   direction of the displacement over a time window, which should cover at
+  *   least one oscillation period.
+  */
+class CHeadingEstimator {
+
+public:
+
+  /** \brief Constructor
+    * \param window Length of the time window [s]
+    * \param min_dist Displacement required for a valid estimate [m]
+    */
+  CHeadingEstimator(double window = 1.0, double min_dist = 0.05);
+
+  /// Forgets all the positions
+  void reset();
+
+  /** \brief Adds a position
+    * \param t Time [s]
+    * \return true if the heading is valid
+    */
+  bool update(double t, double x, double y);
+
+  /// true if enough displacement has been seen in the window
+  bool valid() const { return ok; }
+
+  /// Heading [rad], 0 along x, positive towards y
+  double heading() const { return h; }
+
+private:
+
+  struct pos { double t, x, y; };
+
+  double window, min_dist;
+  std::deque<pos> hist;
+  double h;
+  bool ok;
+
+};
+
+/// Gains and limits of a PID controller
+struct pid_gains {
+  double kp, ki, kd;      ///< proportional, integral and derivative gains
+  double out_min;         ///< lower saturation of the output
+  double out_max;         ///< upper saturation of the output
+};
+
+/** \brief PID controller with output saturation. The integrator is frozen
+  *   while the output is saturated in the direction of the error (anti-windup)
+  *   and the derivative acts on the rate of the measurement, so that a change
+  *   of target does not kick the output.
+  */
+class CPid {
+
+public:
+
+  CPid(const pid_gains& g);
+
+  /// Clears the integrator
+  void reset();
+
+  /** \brief Computes the output
+    * \param error Target minus measurement
+    * \param rate Derivative of the measurement
+    * \param dt Time since the last update [s] (0 for the first one)
+    * \return The saturated output
+    */
+  double update(double error, double rate, double dt);
+
+  /// true if the last output was saturated
+  bool saturated() const { return sat; }
+
+private:
+
+  pid_gains g;
+  double integral;
+  bool sat;
+
+};
+
+/** \brief Holds a heading by steering with the gait offset. It runs at each
+  *   tracking frame and tells when the offset register has to be written,
+  *   at most once per write interval and only when the encoded value changes,
+  *   as each write is a round-trip over the radio.
+  *
+  *   Once a latency is set, the controller acts on the heading predicted for
+  *   the time the offset takes effect (see CStatePredictor) rather than on
+  *   the heading measured in the past, which lets it use higher gains before
+  *   oscillating.
+  */
+class CHeadingController {
+
+public:
+
+  /** \brief Constructor
+    * \param gains Gains from the heading error [rad] to the offset, and the
+    *   offset limits (a negative kp reverses the steering direction)
+    * \param write_interval Shortest time between two register writes [s]
+    */
+  CHeadingController(const pid_gains& gains, double write_interval = 0.1);
+
+  /// Sets the heading to hold [rad]
+  void set_target(double heading) { target = heading; }
+
+  /// Heading to hold [rad]
+  double get_target() const { return target; }
+
+  /// Restarts the controller (estimator, PID and statistics)
+  void reset();
+
+  /// Sets the latency to compensate [s], 0 to act on the measured heading
+  void set_latency(double latency) { pred.set_latency(latency); }
+
+  /// Forgets the last written offset, so that the next one is written even if
+  /// unchanged (after the register has been written by someone else)
+  void resync() { last_code = -1; last_write = -1; }
+
+  /** \brief Processes a tracking frame
+    * \param t Time of the frame [s]
+    * \param detected true if the robot was found, at (x, y)
+    * \param offset Receives the offset to write, when the function returns true
+    * \return true if the offset register has to be written
+    */
+  bool update(double t, bool detected, double x, double y, float& offset);
+
+  /// Reports the time taken by the register write [us]
+  void write_done(double us) { write_time.add(us); }
+
+  /// Heading estimator
+  const CHeadingEstimator& estimator() const { return est; }
+
+  /// State predictor, used once a latency is set
+  const CStatePredictor& predictor() const { return pred; }
+
+  /// Prints the loop timing and the write statistics
+  void print_stats(FILE* f = stdout) const;
+
+  CTimingStats frame_period;    ///< time between tracking frames
+  CTimingStats compute_time;    ///< time spent in update()
+  CTimingStats write_time;      ///< duration of the register writes
+  unsigned int writes;          ///< number of register writes
+  unsigned int skipped;         ///< frames whose change of offset was delayed by the rate limit
+  unsigned int saturated;       ///< frames with a saturated output
+
+private:
+
+  CHeadingEstimator est;
+  CStatePredictor pred;
+  CPid pid;
+  double target;
+  double write_interval;
+  double last_frame;     ///< time of the last frame [s], negative if none
+  double last_update;    ///< time of the last heading estimate [s], negative if none
+  double last_heading;
+  double last_write;     ///< time of the last register write [s], negative if none
+  int last_code;         ///< last written register value, -1 if none
+
+};
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * jobqueue.cc -- queue of trials in a crash-safe append-only journal
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include "jobqueue.h"
+
+#ifdef _WIN32
+  #include <io.h>
+  #define fsync _commit
+  #define fileno _fileno
+#else
+  #include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char* HEADER = "jobs 1";
+
+/// Files written for a run, set aside when the run is interrupted
+static const char* RUN_FILES[] = { ".csv", ".trk", ".evt", ".tln" };
+
+trial_job::trial_job()
+  : id(0), repeat(1), duration(10), settle(5), has_start(false), start_x(0), start_y(0),
+    start_heading(0), dropped(false)
+{
+  gait.freq = gait.amp = gait.lag = gait.off = 0;
+}
+
+CJobQueue::CJobQueue() : f(NULL), next_id(1)
+{
+}
+
+CJobQueue::~CJobQueue()
+{
+  close();
+}
+
+void CJobQueue::close()
+{
+  if (f) fclose(f);
+  f = NULL;
+}
+
+trial_job* CJobQueue::find(unsigned int id)
+{
+  for (size_t i(0); i < list.size(); i++) {
+    if (list[i].id == id) return &list[i];
+  }
+  return NULL;
+}
+
+bool CJobQueue::open(const char* filename)
+{
+  close();
+  list.clear();
+  next_id = 1;
+
+  // last run started by each job and not finished
+  map<unsigned int, string> started;
+  bool cut(false);
+  FILE* in = fopen(filename, "r");
+  if (in) {
+    char line[512];
+    if (fgets(line, sizeof(line), in) && strncmp(line, HEADER, strlen(HEADER)) != 0) {
+      fprintf(stderr, "%s: not a job journal.\n", filename);
+      fclose(in);
+      return false;
+    }
+    while (fgets(line, sizeof(line), in)) {
+      // a line cut by a crash has no newline and is ignored
+      cut = !strchr(line, '\n');
+      if (cut) continue;
+
+      trial_job j;
+      char log[256];
+      unsigned int id;
+      int k(0), k2(0);
+      if (sscanf(line, "job %u %f %f %f %f %u %f %f%n", &j.id, &j.gait.freq, &j.gait.amp, &j.gait.lag,
+                 &j.gait.off, &j.repeat, &j.duration, &j.settle, &k) == 8) {
+        if (sscanf(line + k, " start %lf %lf %lf%n", &j.start_x, &j.start_y, &j.start_heading, &k2) == 3) {
+          j.has_start = true;
+          k += k2;
+        }
+        if ((line[k] == '\n' || line[k] == '\r') && !find(j.id)) {
+          list.push_back(j);
+          next_id = max(next_id, j.id + 1);
+        }
+      } else if (sscanf(line, "run %u %255s", &id, log) == 2) {
+        started[id] = log;
+      } else if (sscanf(line, "done %u %255s", &id, log) == 2) {
+        trial_job* p = find(id);
+        if (p && started[id] == log) p->runs.push_back(log);
+        started.erase(id);
+      } else if (sscanf(line, "abort %u %255s", &id, log) == 2) {
+        started.erase(id);
+      } else if (sscanf(line, "drop %u", &id) == 1) {
+        trial_job* p = find(id);
+        if (p) p->dropped = true;
+      }
+    }
+    fclose(in);
+  }
+
+  f = fopen(filename, "a");
+  if (!f) {
+    perror(filename);
+    return false;
+  }
+  // the position after opening in append mode is not the end on all systems
+  fseek(f, 0, SEEK_END);
+  bool ok(true);
+  if (ftell(f) == 0) ok = append(HEADER);
+  // terminates a cut line so that it cannot be mistaken for a valid one
+  else if (cut) ok = append("!");
+
+  // the runs interrupted by the crash are done again
+  for (map<unsigned int, string>::const_iterator i = started.begin(); ok && i != started.end(); i++) {
+    fprintf(stderr, "Run %s of job %u was interrupted, it will be done again.\n", i->second.c_str(), i->first);
+    ok = abort_run(i->first, i->second);
+  }
+  return ok;
+}
+
+bool CJobQueue::append(const char* line)
+{
+  if (!f) return false;
+  fprintf(f, "%s\n", line);
+  return fflush(f) == 0 && fsync(fileno(f)) == 0;
+}
+
+unsigned int CJobQueue::add(const trial_job& j)
+{
+  char line[256];
+  int n = snprintf(line, sizeof(line), "job %u %.6f %.6f %.6f %.6f %u %.3f %.3f", next_id,
+                   j.gait.freq, j.gait.amp, j.gait.lag, j.gait.off, j.repeat, j.duration, j.settle);
+  if (j.has_start) {
+    snprintf(line + n, sizeof(line) - n, " start %.4f %.4f %.6f", j.start_x, j.start_y, j.start_heading);
+  }
+  if (!append(line)) return 0;
+
+  trial_job a = j;
+  a.id = next_id++;
+  a.runs.clear();
+  a.dropped = false;
+  list.push_back(a);
+  return a.id;
+}
+
+bool CJobQueue::drop(unsigned int id)
+{
+  trial_job* p = find(id);
+  if (!p) return false;
+  char line[32];
+  snprintf(line, sizeof(line), "drop %u", id);
+  if (!append(line)) return false;
+  p->dropped = true;
+  return true;
+}
+
+const trial_job* CJobQueue::next() const
+{
+  for (size_t i(0); i < list.size(); i++) {
+    if (list[i].left() > 0) return &list[i];
+  }
+  return NULL;
+}
+
+unsigned int CJobQueue::runs_left() const
+{
+  unsigned int n(0);
+  for (size_t i(0); i < list.size(); i++) n += list[i].left();
+  return n;
+}
+
+bool CJobQueue::begin_run(unsigned int id, const string& log)
+{
+  string line = "run " + to_string(id) + " " + log;
+  return find(id) && append(line.c_str());
+}
+
+bool CJobQueue::end_run(unsigned int id, const string& log)
+{
+  trial_job* p = find(id);
+  string line = "done " + to_string(id) + " " + log;
+  if (!p || !append(line.c_str())) return false;
+  p->runs.push_back(log);
+  return true;
+}
+
+bool CJobQueue::abort_run(unsigned int id, const string& log)
+{
+  for (size_t i(0); i < sizeof(RUN_FILES) / sizeof(RUN_FILES[0]); i++) {
+    string name = log + RUN_FILES[i];
+    string aside = name + ".aborted";
+    remove(aside.c_str());
+    if (rename(name.c_str(), aside.c_str()) != 0 && errno != ENOENT) perror(name.c_str());
+  }
+  string line = "abort " + to_string(id) + " " + log;
+  return append(line.c_str());
+}
@@ -0,0 +1,100 @@
+#ifndef __JOBQUEUE_H
+#define __JOBQUEUE_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "gait.h"
+
+/// A queued trial, run a given number of times
+struct trial_job {
+  unsigned int id;          ///< identifier, unique in the queue
+  gait_params gait;
+  unsigned int repeat;      ///< number of runs to do
+  float duration;           ///< swimming time of each run [s]
+  float settle;             ///< time in ready mode before each run [s]
+  bool has_start;           ///< the robot has to be brought back to the start pose after each run
+  double start_x, start_y;  ///< start position [m]
+  double start_heading;     ///< start heading [rad]
+
+  // state, rebuilt from the journal
+  std::vector<std::string> runs;  ///< logs of the completed runs
+  bool dropped;                   ///< removed from the queue
+
+  trial_job();
+
+  /// Number of runs left
+  unsigned int left() const { return dropped || runs.size() >= repeat ? 0 : repeat - runs.size(); }
+};
+
+/** \brief Queue of trials kept in an append-only journal, so that a campaign
+  *   survives a crash or an error and resumes exactly where it stopped. Each
+  *   change is one line, flushed to the disk before the function returns:
+  *
+  *   job ID FREQ AMP LAG OFF REPEAT DURATION SETTLE [start X Y HEADING]
+  *   run ID LOG       a run has started, its log is LOG
+  *   done ID LOG      the run has completed and its log is closed
+  *   abort ID LOG     the run was interrupted, its files have been set aside
+  *   drop ID          the job is removed
+  *
+  *   A run counts once its done line is written, which is done after its log
+  *   is complete. The logs of the runs started but never completed (crash,
+  *   interruption) are renamed with an .aborted suffix when the journal is
+  *   opened, so that they do not appear in the run catalog, and the run is
+  *   done again: no run is lost or counted twice.
+  */
+class CJobQueue {
+
+public:
+
+  CJobQueue();
+  ~CJobQueue();
+
+  /** \brief Opens a journal, creating it if needed, and replays it
+    * \return true on success, false if the file cannot be opened or is not a job journal
+    */
+  bool open(const char* filename);
+
+  /// Closes the journal
+  void close();
+
+  /** \brief Adds a job
+    * \param j The job (its identifier and state are ignored)
+    * \return The identifier of the new job, 0 on error
+    */
+  unsigned int add(const trial_job& j);
+
+  /// Removes a job from the queue (its completed runs are kept), false on error
+  bool drop(unsigned int id);
+
+  /// The first job with runs left, NULL if the queue is empty
+  const trial_job* next() const;
+
+  /// Records the start of a run, with the name of its log (without extension)
+  bool begin_run(unsigned int id, const std::string& log);
+
+  /// Records a completed run, once its log has been closed
+  bool end_run(unsigned int id, const std::string& log);
+
+  /// Records that the current run was interrupted, and sets its files aside
+  bool abort_run(unsigned int id, const std::string& log);
+
+  /// All the jobs, in the order they were added
+  const std::vector<trial_job>& jobs() const { return list; }
+
+  /// Number of runs left in the queue
+  unsigned int runs_left() const;
+
+private:
+
+  /// Writes a line to the journal and flushes it to the disk
+  bool append(const char* line);
+  trial_job* find(unsigned int id);
+
+  FILE* f;
+  std::vector<trial_job> list;
+  unsigned int next_id;
+
+};
+
+#endif
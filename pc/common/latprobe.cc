@@ -0,0 +1,131 @@
+/*
+ * latprobe.cc -- command-to-observation latency measurement with the head LED
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "latprobe.h"
+
+using namespace std;
+
+CLatencyProbe::CLatencyProbe(const probe_settings& s, uint64_t seed)
+  : s(s), rng(seed)
+{
+  reset();
+}
+
+void CLatencyProbe::reset()
+{
+  list.clear();
+  timeouts = 0;
+  wait = false;
+  next_on = true;
+  warmup = true;
+  clock_set = false;
+  last_frame_time = 0;
+  frame_clock = 0;
+}
+
+double CLatencyProbe::pause()
+{
+  uniform_real_distribution<double> d(s.min_pause, s.max_pause);
+  return d(rng);
+}
+
+void CLatencyProbe::command(double sent, double acked)
+{
+  current.on = next_on;
+  current.sent = sent;
+  current.acked = acked;
+  wait = true;
+}
+
+void CLatencyProbe::frame(double t, uint32_t frame_time, bool detected)
+{
+  // the frame times may wrap around
+  if (clock_set) frame_clock += (int32_t) (frame_time - last_frame_time) * s.frame_tick;
+  last_frame_time = frame_time;
+  clock_set = true;
+
+  if (!wait) return;
+  if (detected == current.on) {
+    current.captured = frame_clock;
+    current.observed = t;
+    if (!warmup) list.push_back(current);
+  } else if (t - current.sent > s.timeout) {
+    // the LED is out of sight or the write was lost: the state of the LED
+    // is unknown again
+    timeouts++;
+    next_on = true;
+    warmup = true;
+    wait = false;
+    return;
+  } else {
+    return;
+  }
+  warmup = false;
+  wait = false;
+  next_on = !next_on;
+}
+
+void CLatencyProbe::split(vector<latency_split>& out) const
+{
+  out.clear();
+  if (list.empty()) return;
+
+  // no change can be captured before the command reaches the robot
+  double offset = -INFINITY;
+  for (size_t i(0); i < list.size(); i++) {
+    const probe_sample& p = list[i];
+    offset = max(offset, (p.sent + p.acked) / 2 - p.captured);
+  }
+
+  for (size_t i(0); i < list.size(); i++) {
+    const probe_sample& p = list[i];
+    double received = (p.sent + p.acked) / 2;
+    latency_split l;
+    l.radio = (received - p.sent) * 1e6;
+    l.firmware = (p.captured + offset - received) * 1e6;
+    l.camera = (p.observed - p.captured - offset) * 1e6;
+    l.total = (p.observed - p.sent) * 1e6;
+    out.push_back(l);
+  }
+}
+
+double CLatencyProbe::control_latency() const
+{
+  vector<latency_split> l;
+  split(l);
+  if (l.empty()) return 0;
+  vector<double> d;
+  for (size_t i(0); i < l.size(); i++) d.push_back(l[i].camera + l[i].radio);
+  nth_element(d.begin(), d.begin() + d.size() / 2, d.end());
+  return d[d.size() / 2] * 1e-6;
+}
+
+void CLatencyProbe::print(FILE* f) const
+{
+  vector<latency_split> l;
+  split(l);
+
+  CTimingStats radio, firmware, camera, total, on, off;
+  CTimingHistogram hist(5000, 100);
+  for (size_t i(0); i < l.size(); i++) {
+    radio.add(l[i].radio);
+    firmware.add(l[i].firmware);
+    camera.add(l[i].camera);
+    total.add(l[i].total);
+    hist.add(l[i].total);
+    (list[i].on ? on : off).add(l[i].total);
+  }
+
+  fprintf(f, "%u change(s) measured, %u not seen\n", (unsigned int) l.size(), timeouts);
+  radio.print("Radio", f);
+  firmware.print("Firmware and exposure", f);
+  camera.print("Camera and network", f);
+  total.print("Total", f);
+  on.print("Total, spot reappearing", f);
+  off.print("Total, spot disappearing", f);
+  hist.print("Total distribution", f);
+  fprintf(f, "Latency to compensate: %.3f ms\n", control_latency() * 1000);
+}
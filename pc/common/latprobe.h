@@ -0,0 +1,128 @@
+#ifndef __LATPROBE_H
+#define __LATPROBE_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "timing.h"
+
+/// Settings of a latency measurement
+struct probe_settings {
+  unsigned int repeats;   ///< number of measured LED changes
+  double timeout;         ///< longest wait for a change to be seen [s]
+  double min_pause;       ///< shortest pause between a change being seen and the next command [s]
+  double max_pause;       ///< longest pause [s]
+  double frame_tick;      ///< unit of the frame times given by the tracking PC [s]
+  uint32_t color;         ///< value of REG32_LED switching the LED on (0 switches it off)
+
+  probe_settings()
+    : repeats(100), timeout(1.0), min_pause(0.3), max_pause(0.6), frame_tick(0.001),
+      color(0x00FFFFFF) {}
+};
+
+/// One LED change, with the times of this PC [s]
+struct probe_sample {
+  bool on;                ///< the LED was switched on (the spot reappears)
+  double sent;            ///< the register write started
+  double acked;           ///< the write was acknowledged by the robot
+  double captured;        ///< the first frame showing the change was captured (tracking PC clock)
+  double observed;        ///< this frame was received
+};
+
+/// Latency of each stage of a change, estimated from a sample [us]
+struct latency_split {
+  double radio;           ///< command to the robot, half the write round trip
+  double firmware;        ///< command received to the next frame showing the LED
+  double camera;          ///< frame capture to reception by this PC
+  double total;           ///< command to reception of the frame
+};
+
+/** \brief Measures the time from a register write to its effect in the
+  *   tracking frames, by switching the head LED on and off (REG32_LED) and
+  *   watching the spot disappear and reappear. The probe does not talk to
+  *   the robot itself: it is given the frames and the times of the writes,
+  *   and says when to write, so that it runs the same way with the real
+  *   robot or with simulated stand-ins (see CLatencySim).
+  *
+  *   The total latency is split in three stages. The radio takes half the
+  *   round trip of the write. The capture time of each frame is known in the
+  *   clock of the tracking PC only; the offset with the clock of this PC is
+  *   taken as the largest one for which no frame was captured showing a
+  *   change before the command reached the robot. The constant part of the
+  *   firmware latency is therefore counted in the camera stage. The firmware
+  *   stage includes the wait for the next camera exposure, i.e. up to one
+  *   frame period.
+  *
+  *   The pause before each change is random, so that the commands fall
+  *   anywhere in the frame period.
+  */
+class CLatencyProbe {
+
+public:
+
+  CLatencyProbe(const probe_settings& s = probe_settings(), uint64_t seed = 1);
+
+  /** \brief Starts a measurement. The first change switches the LED on and
+    *   is not measured, as its previous state is unknown.
+    */
+  void reset();
+
+  /// true while a change has been sent and not seen yet
+  bool waiting() const { return wait; }
+
+  /// true once all the changes have been measured
+  bool done() const { return list.size() >= s.repeats; }
+
+  /// Random pause before the next change [s]
+  double pause();
+
+  /// Value to write to REG32_LED for the next change
+  uint32_t led_value() const { return next_on ? s.color : 0; }
+
+  /** \brief Records a change written to REG32_LED
+    * \param sent Time at which the write started [s]
+    * \param acked Time at which it was acknowledged [s]
+    */
+  void command(double sent, double acked);
+
+  /** \brief Processes a tracking frame
+    * \param t Time at which it was received [s]
+    * \param frame_time Time stamp given by the tracking PC
+    * \param detected true if the spot of the LED is seen
+    */
+  void frame(double t, uint32_t frame_time, bool detected);
+
+  /// Measured changes
+  const std::vector<probe_sample>& samples() const { return list; }
+
+  /// Splits the latency of each measured change (see the class description)
+  void split(std::vector<latency_split>& out) const;
+
+  /** \brief Latency a controller has to compensate [s]: the median age of a
+    *   frame when it is received plus the time for a command to reach the
+    *   robot (see CStatePredictor), 0 if nothing was measured
+    */
+  double control_latency() const;
+
+  /// Prints the distribution of the latency of each stage
+  void print(FILE* f = stdout) const;
+
+  unsigned int timeouts;        ///< changes that were never seen
+
+private:
+
+  probe_settings s;
+  std::mt19937_64 rng;
+  std::vector<probe_sample> list;
+  probe_sample current;
+  bool wait;
+  bool next_on;
+  bool warmup;                  ///< the change in progress is the first one
+  bool clock_set;               ///< frames have been received, to unwrap their times
+  uint32_t last_frame_time;
+  double frame_clock;           ///< unwrapped frame time [s]
+
+};
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * latsim.cc -- simulated robot LED and tracking system for the latency probe
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "latsim.h"
+
+using namespace std;
+
+/// Time of the first frame, so that the frames are not aligned with the LED interrupt [s]
+static const double FRAME_PHASE = 0.0123;
+
+CLatencySim::CLatencySim(const latsim_settings& s, uint64_t seed)
+  : s(s), rng(seed), frame_index(0), arrival(0), drawn(false)
+{
+}
+
+double CLatencySim::draw(double mean, double std)
+{
+  normal_distribution<double> d(mean, std);
+  return max(d(rng), mean / 10);
+}
+
+bool CLatencySim::led_at(double t) const
+{
+  bool on(false);
+  for (size_t i(0); i < switch_times.size() && switch_times[i] <= t; i++) on = switch_states[i];
+  return on;
+}
+
+double CLatencySim::set_led(double t, uint32_t value)
+{
+  double up = draw(s.radio_mean, s.radio_std);
+  double down = draw(s.radio_mean, s.radio_std);
+
+  // the firmware applies the register at its next LED interrupt
+  double received = t + up;
+  double change = ceil(received / s.led_period) * s.led_period + s.led_write;
+  bool on = (value & 0xFFFFFF) != 0;
+  if (on != led_at(change)) {
+    latsim_truth c = { up, change - received, 0, 0 };
+    unseen.push_back(changes.size());
+    changes.push_back(c);
+    switch_times.push_back(change);
+    switch_states.push_back(on);
+  }
+  return received + down;
+}
+
+double CLatencySim::next_arrival()
+{
+  if (!drawn) {
+    double captured = FRAME_PHASE + frame_index * s.frame_period;
+    // the frames arrive in order, over TCP
+    arrival = max(captured + draw(s.camera_mean, s.camera_std), arrival);
+    drawn = true;
+  }
+  return arrival;
+}
+
+void CLatencySim::next_frame(double& t, uint32_t& frame_time, bool& detected)
+{
+  t = next_arrival();
+  drawn = false;
+  double captured = FRAME_PHASE + frame_index++ * s.frame_period;
+  frame_time = (uint32_t) llround((captured + s.clock_offset) / s.frame_tick);
+  detected = led_at(captured);
+
+  for (size_t i(0); i < unseen.size(); ) {
+    latsim_truth& c = changes[unseen[i]];
+    double change = switch_times[unseen[i]];
+    if (change <= captured) {
+      c.exposure = captured - change;
+      c.camera = t - captured;
+      unseen.erase(unseen.begin() + i);
+    } else {
+      i++;
+    }
+  }
+}
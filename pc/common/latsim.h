@@ -0,0 +1,80 @@
+#ifndef __LATSIM_H
+#define __LATSIM_H
+
+#include <stdint.h>
+#include <random>
+#include <vector>
+
+/// Delays of the simulated robot and tracking system [s]
+struct latsim_settings {
+  double radio_mean;      ///< one-way radio delay
+  double radio_std;
+  double led_period;      ///< period of the LED update of the firmware (LED_TIMER_PERIOD)
+  double led_write;       ///< time to write the LED controller (I2C)
+  double frame_period;    ///< camera frame period
+  double camera_mean;     ///< capture to reception of a frame (processing and network)
+  double camera_std;
+  double clock_offset;    ///< clock of the tracking PC minus the simulated time
+  double frame_tick;      ///< unit of the frame times [s]
+
+  latsim_settings()
+    : radio_mean(0.004), radio_std(0.001), led_period(0.05), led_write(0.0005),
+      frame_period(1.0 / 15), camera_mean(0.030), camera_std(0.005), clock_offset(1234.5),
+      frame_tick(0.001) {}
+};
+
+/// Actual delays of a simulated LED change [s]
+struct latsim_truth {
+  double radio;           ///< write to reception by the robot
+  double firmware;        ///< reception to the LED change
+  double exposure;        ///< LED change to the capture of the next frame
+  double camera;          ///< capture to reception of this frame
+};
+
+/** \brief Simulated stand-in for the robot and the tracking system, to run a
+  *   CLatencyProbe without hardware and check that it finds the delays that
+  *   were simulated. The time is simulated too: the caller moves it forward
+  *   by writing the LED or taking the next frame.
+  */
+class CLatencySim {
+
+public:
+
+  CLatencySim(const latsim_settings& s = latsim_settings(), uint64_t seed = 1);
+
+  /// Writes REG32_LED at a time [s], returns the time at which the write is acknowledged
+  double set_led(double t, uint32_t value);
+
+  /// Time at which the next frame is received [s]
+  double next_arrival();
+
+  /** \brief Gets the next frame
+    * \param t Time at which it is received [s]
+    * \param frame_time Time stamp given by the tracking PC
+    * \param detected true if the LED is on in the frame
+    */
+  void next_frame(double& t, uint32_t& frame_time, bool& detected);
+
+  /// Actual delays of each LED change, in order
+  const std::vector<latsim_truth>& truth() const { return changes; }
+
+private:
+
+  /// true if the LED is on at a time
+  bool led_at(double t) const;
+  /// Delay drawn from a normal distribution, never shorter than a tenth of the mean
+  double draw(double mean, double std);
+
+  latsim_settings s;
+  std::mt19937_64 rng;
+  std::vector<double> switch_times;   ///< times at which the LED changes
+  std::vector<bool> switch_states;    ///< state after each change
+  std::vector<latsim_truth> changes;
+  std::vector<size_t> unseen;         ///< changes waiting for a frame
+  uint64_t frame_index;               ///< next frame to capture
+  double arrival;                     ///< reception of the next frame
+  bool drawn;                         ///< arrival is known
+
+};
+
+#endif
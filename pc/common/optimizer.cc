@@ -0,0 +1,300 @@
+/*
+ * optimizer.cc -- Nelder-Mead search of the gait parameters maximizing the speed
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "optimizer.h"
+
+using namespace std;
+
+/// Size of the new simplex built once the previous one has collapsed
+const double RESTART_STEP = 0.15;
+
+/// Full range of the registers of each parameter (freq, amp, lag, off)
+static const float REG_RANGE[4] = {
+  MAX_FREQ - MIN_FREQ, MAX_AMP - MIN_AMP, MAX_LAG - MIN_LAG, MAX_OFF - MIN_OFF
+};
+
+CNelderMead::CNelderMead(const vector<double>& x0, double step)
+  : n(x0.size()), pts(n + 1, x0), vals(n + 1, INFINITY), order(n + 1), centroid(n),
+    reflected(n), f_reflected(INFINITY), state(NM_INIT), pending(0), evals(0)
+{
+  for (size_t i(0); i <= n; i++) order[i] = i;
+  restart(step);
+  // the starting point itself has not been evaluated yet
+  vals[0] = INFINITY;
+  pending = 0;
+  cand = pts[0];
+}
+
+void CNelderMead::restart(double step)
+{
+  vector<double> x0 = pts[order[0]];
+  double f0 = vals[order[0]];
+
+  // the best point is kept as first vertex, the others are moved by one step
+  // along each axis, inwards if the step would leave the domain
+  for (size_t i(0); i <= n; i++) {
+    pts[i] = x0;
+    vals[i] = INFINITY;
+    order[i] = i;
+    if (i > 0) pts[i][i - 1] += (x0[i - 1] + step <= 1.0) ? step : -step;
+  }
+  vals[0] = f0;
+  state = NM_INIT;
+  pending = (n > 0) ? 1 : 0;
+  cand = pts[pending];
+}
+
+void CNelderMead::sort()
+{
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return vals[a] < vals[b]; });
+}
+
+void CNelderMead::along(double t)
+{
+  const vector<double>& w = pts[order[n]];
+  for (size_t j(0); j < n; j++) {
+    double v = centroid[j] + t * (centroid[j] - w[j]);
+    cand[j] = v < 0 ? 0 : (v > 1 ? 1 : v);
+  }
+}
+
+void CNelderMead::iterate()
+{
+  sort();
+  for (size_t j(0); j < n; j++) {
+    double s(0);
+    for (size_t i(0); i < n; i++) s += pts[order[i]][j];
+    centroid[j] = s / n;
+  }
+  along(1.0);
+  state = NM_REFLECT;
+}
+
+void CNelderMead::shrink_next()
+{
+  // moves each vertex but the best halfway towards the best one
+  const vector<double>& b = pts[order[0]];
+  vector<double>& p = pts[order[pending]];
+  for (size_t j(0); j < n; j++) p[j] = b[j] + 0.5 * (p[j] - b[j]);
+  cand = p;
+}
+
+double CNelderMead::spread() const
+{
+  double d(0);
+  const vector<double>& b = pts[order[0]];
+  for (size_t i(1); i <= n; i++) {
+    double s(0);
+    for (size_t j(0); j < n; j++) s += (pts[order[i]][j] - b[j]) * (pts[order[i]][j] - b[j]);
+    d = max(d, sqrt(s));
+  }
+  return d;
+}
+
+void CNelderMead::tell(double f)
+{
+  evals++;
+  if (std::isnan(f)) f = INFINITY;
+
+  size_t worst = order[n];
+  switch (state) {
+    case NM_INIT:
+      vals[pending] = f;
+      if (++pending <= n) {
+        cand = pts[pending];
+        sort();
+      } else {
+        iterate();
+      }
+      return;
+
+    case NM_REFLECT:
+      if (f < vals[order[0]]) {
+        // tries to go further in the same direction
+        reflected = cand;
+        f_reflected = f;
+        along(2.0);
+        state = NM_EXPAND;
+      } else if (f < vals[order[n - 1]]) {
+        pts[worst] = cand;
+        vals[worst] = f;
+        iterate();
+      } else if (f < vals[worst]) {
+        reflected = cand;
+        f_reflected = f;
+        along(0.5);
+        state = NM_CONTRACT_OUT;
+      } else {
+        along(-0.5);
+        state = NM_CONTRACT_IN;
+      }
+      return;
+
+    case NM_EXPAND:
+      if (f < f_reflected) {
+        pts[worst] = cand;
+        vals[worst] = f;
+      } else {
+        pts[worst] = reflected;
+        vals[worst] = f_reflected;
+      }
+      iterate();
+      return;
+
+    case NM_CONTRACT_OUT:
+    case NM_CONTRACT_IN:
+      if ((state == NM_CONTRACT_OUT && f <= f_reflected) || (state == NM_CONTRACT_IN && f < vals[worst])) {
+        pts[worst] = cand;
+        vals[worst] = f;
+        iterate();
+      } else {
+        state = NM_SHRINK;
+        pending = 1;
+        shrink_next();
+      }
+      return;
+
+    case NM_SHRINK:
+      vals[order[pending]] = f;
+      if (++pending <= n) {
+        shrink_next();
+      } else {
+        iterate();
+      }
+      return;
+  }
+}
+
+CGaitOptimizer::CGaitOptimizer() : nm(vector<double>()), f(NULL)
+{
+}
+
+CGaitOptimizer::~CGaitOptimizer()
+{
+  close();
+}
+
+void CGaitOptimizer::close()
+{
+  if (f) fclose(f);
+  f = NULL;
+}
+
+// Accesses the parameters of a gait by index (freq, amp, lag, off)
+static float& param(gait_params& g, int i)
+{
+  switch (i) {
+    case 0: return g.freq;
+    case 1: return g.amp;
+    case 2: return g.lag;
+    default: return g.off;
+  }
+}
+
+gait_params CGaitOptimizer::to_gait(const vector<double>& x) const
+{
+  gait_params g;
+  for (int i(0); i < 4; i++) param(g, i) = spec.values[i].front();
+  for (size_t j(0); j < free_params.size(); j++) {
+    const vector<float>& v = spec.values[free_params[j]];
+    param(g, free_params[j]) = v.front() + (v.back() - v.front()) * x[j];
+  }
+  return quantize_gait(g);
+}
+
+gait_params CGaitOptimizer::next() const
+{
+  return to_gait(nm.ask());
+}
+
+bool CGaitOptimizer::converged() const
+{
+  // the vertices are at most one step of the registers away from the best
+  // point, along each axis
+  for (size_t j(0); j < free_params.size(); j++) {
+    const vector<float>& v = spec.values[free_params[j]];
+    if (nm.spread() * (v.back() - v.front()) > REG_RANGE[free_params[j]] / 255.0) return false;
+  }
+  return true;
+}
+
+bool CGaitOptimizer::report(double speed)
+{
+  if (f) {
+    gait_params g = next();
+    fprintf(f, "%.6f,%.6f,%.6f,%.6f,%.4f\n", g.freq, g.amp, g.lag, g.off, speed);
+    if (fflush(f) != 0) return false;
+  }
+
+  // the speed is maximized, a run without measurement counts as not moving
+  nm.tell(std::isnan(speed) ? 0.0 : -speed);
+  if (converged()) nm.restart(RESTART_STEP);
+  return true;
+}
+
+void CGaitOptimizer::best(gait_params& g, double& speed) const
+{
+  g = to_gait(nm.best());
+  speed = -nm.best_value();
+}
+
+bool CGaitOptimizer::open(const char* history, const sweep_spec& spec)
+{
+  close();
+  this->spec = spec;
+  free_params.clear();
+  for (int i(0); i < 4; i++) {
+    if (spec.values[i].empty()) {
+      fprintf(stderr, "The optimizer needs a value or a range for each parameter.\n");
+      return false;
+    }
+    if (spec.values[i].size() == 2 && spec.values[i][1] > spec.values[i][0]) free_params.push_back(i);
+  }
+  if (free_params.empty()) {
+    fprintf(stderr, "No parameter to optimize.\n");
+    return false;
+  }
+  nm = CNelderMead(vector<double>(free_params.size(), 0.5));
+
+  // replays the previous evaluations, which must be the points the optimizer
+  // proposes again with the same settings
+  bool cut(false);
+  FILE* in = fopen(history, "r");
+  if (in) {
+    char line[256];
+    while (fgets(line, sizeof(line), in)) {
+      gait_params h;
+      double speed;
+      int k(0);
+      cut = !strchr(line, '\n');
+      if (cut || sscanf(line, "%f,%f,%f,%f,%lf%n", &h.freq, &h.amp, &h.lag, &h.off, &speed, &k) != 5 ||
+          (line[k] != '\n' && line[k] != '\r')) {
+        continue;
+      }
+      gait_params g = next();
+      if (fabs(g.freq - h.freq) > 1e-3 || fabs(g.amp - h.amp) > 1e-3 || fabs(g.lag - h.lag) > 1e-3 ||
+          fabs(g.off - h.off) > 1e-3) {
+        fprintf(stderr, "%s: history of an optimization with other settings.\n", history);
+        fclose(in);
+        return false;
+      }
+      report(speed);
+    }
+    fclose(in);
+  }
+
+  f = fopen(history, "a");
+  if (!f) {
+    perror(history);
+    return false;
+  }
+  fseek(f, 0, SEEK_END);
+  if (ftell(f) == 0) fprintf(f, "Freq,Amp,Lag,Off,Speed\n");
+  else if (cut) fprintf(f, "!\n");
+  return fflush(f) == 0;
+}
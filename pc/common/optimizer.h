@@ -0,0 +1,128 @@
+#ifndef __OPTIMIZER_H
+#define __OPTIMIZER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "gait.h"
+#include "sweep.h"
+
+/** \brief Nelder-Mead simplex minimizer with an ask/tell interface, so that
+  *   each function evaluation can be a trial on the robot. The coordinates
+  *   are kept in [0, 1]. The sequence of points is deterministic for a given
+  *   sequence of values, which allows to resume an optimization by replaying
+  *   its past evaluations.
+  */
+class CNelderMead {
+
+public:
+
+  /** \brief Constructor
+    * \param x0 Starting point
+    * \param step Size of the initial simplex along each axis
+    */
+  CNelderMead(const std::vector<double>& x0, double step = 0.25);
+
+  /// Point to evaluate next (the same until tell() is called)
+  const std::vector<double>& ask() const { return cand; }
+
+  /// Gives the value of the point returned by ask() (lower is better)
+  void tell(double f);
+
+  /// Best point evaluated so far
+  const std::vector<double>& best() const { return pts[order[0]]; }
+
+  /// Value of the best point (+infinity before the simplex is complete)
+  double best_value() const { return vals[order[0]]; }
+
+  /// Number of calls to tell()
+  unsigned int evaluations() const { return evals; }
+
+  /// Largest distance between the best point and the other vertices
+  double spread() const;
+
+  /// Builds a new simplex around the best point (e.g. once it has collapsed)
+  void restart(double step);
+
+private:
+
+  enum nm_state { NM_INIT, NM_REFLECT, NM_EXPAND, NM_CONTRACT_OUT, NM_CONTRACT_IN, NM_SHRINK };
+
+  /// Sorts the vertices by value
+  void sort();
+  /// Sets the candidate to centroid + t * (centroid - worst), clamped to [0, 1]
+  void along(double t);
+  /// Starts a new iteration with the reflection of the worst vertex
+  void iterate();
+  /// Sets the candidate to the vertex being shrunk
+  void shrink_next();
+
+  size_t n;
+  std::vector<std::vector<double> > pts;
+  std::vector<double> vals;
+  std::vector<size_t> order;        ///< vertices sorted from the best to the worst
+  std::vector<double> centroid;     ///< centroid of all vertices but the worst
+  std::vector<double> cand;
+  std::vector<double> reflected;
+  double f_reflected;
+  nm_state state;
+  size_t pending;                   ///< vertex evaluated during NM_INIT and NM_SHRINK
+  unsigned int evals;
+
+};
+
+/** \brief Online optimizer of the gait parameters, maximizing the speed of
+  *   the robot. The parameters given as a range in the specification (as for
+  *   an lhs sweep) are optimized, the others are fixed. Each evaluation is
+  *   appended to a history file (Freq,Amp,Lag,Off,Speed), which is replayed
+  *   when the optimization is opened again.
+  */
+class CGaitOptimizer {
+
+public:
+
+  CGaitOptimizer();
+  ~CGaitOptimizer();
+
+  /** \brief Opens an optimization, replaying its history if it exists
+    * \param history The history file
+    * \param spec The ranges of the parameters (design opt or lhs)
+    * \return true on success, false if the history cannot be written or
+    *   was made with other settings
+    */
+  bool open(const char* history, const sweep_spec& spec);
+
+  /// Closes the history file
+  void close();
+
+  /// Gait to evaluate next, quantized as sent to the robot
+  gait_params next() const;
+
+  /** \brief Gives the speed measured with the gait returned by next()
+    * \param speed The speed [m/s], NAN if it could not be measured
+    * \return true on success, false if the history cannot be written
+    */
+  bool report(double speed);
+
+  /// Best gait so far and its speed
+  void best(gait_params& g, double& speed) const;
+
+  /// Number of evaluations, including the replayed ones
+  unsigned int evaluations() const { return nm.evaluations(); }
+
+  /// true once the simplex is smaller than the resolution of the registers
+  bool converged() const;
+
+private:
+
+  /// Converts optimizer coordinates to a gait
+  gait_params to_gait(const std::vector<double>& x) const;
+
+  sweep_spec spec;
+  std::vector<int> free_params;     ///< index (freq, amp, lag, off) of each coordinate
+  CNelderMead nm;
+  FILE* f;
+
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * predict.cc -- latency-compensated prediction of the state of the robot
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "predict.h"
+
+using namespace std;
+
+// Wraps an angle to [-pi, pi]
+static double wrap_angle(double a)
+{
+  return atan2(sin(a), cos(a));
+}
+
+CStatePredictor::CStatePredictor(const predict_settings& s) : s(s)
+{
+  reset();
+}
+
+void CStatePredictor::reset()
+{
+  hist.clear();
+  meas.t = meas.x = meas.y = meas.heading = meas.speed = meas.yaw_rate = 0;
+  pred = meas;
+  ok = false;
+  has_rate = false;
+}
+
+bool CStatePredictor::update(double t, bool detected, double x, double y)
+{
+  if (detected) {
+    pos p = { t, x, y };
+    hist.push_back(p);
+    while (hist.size() > 2 && t - hist.front().t > s.window) hist.pop_front();
+
+    const pos& a = hist.front();
+    double dt = t - a.t;
+    double dx = x - a.x, dy = y - a.y;
+    if (dt > 0 && dt <= 2 * s.window && dx * dx + dy * dy >= s.min_dist * s.min_dist) {
+      double h = atan2(dy, dx);
+      double tm = (t + a.t) / 2;
+
+      // the yaw rate is the change of the heading between two windows, filtered
+      if (ok && tm > meas.t) {
+        double rate = wrap_angle(h - meas.heading) / (tm - meas.t);
+        if (has_rate) {
+          double k = (tm - meas.t) / (s.rate_tau + tm - meas.t);
+          rate = meas.yaw_rate + k * (rate - meas.yaw_rate);
+        }
+        meas.yaw_rate = max(-s.max_rate, min(s.max_rate, rate));
+        has_rate = true;
+      }
+      meas.t = tm;
+      meas.x = (x + a.x) / 2;
+      meas.y = (y + a.y) / 2;
+      meas.heading = h;
+      meas.speed = sqrt(dx * dx + dy * dy) / dt;
+      ok = true;
+    }
+  }
+
+  // the prediction goes on from the last measurement while the robot is not seen
+  if (ok && t - meas.t > 2 * s.window) {
+    ok = false;
+    has_rate = false;
+    meas.yaw_rate = 0;
+  }
+  if (ok) pred = at(t + s.latency);
+  return ok;
+}
+
+robot_state CStatePredictor::at(double t) const
+{
+  robot_state r = meas;
+  double dt = t - meas.t;
+  double turn = meas.yaw_rate * dt;
+  r.t = t;
+  r.heading = wrap_angle(meas.heading + turn);
+  if (fabs(turn) < 1e-6) {
+    r.x += meas.speed * cos(meas.heading) * dt;
+    r.y += meas.speed * sin(meas.heading) * dt;
+  } else {
+    // along an arc of radius speed / yaw rate
+    double radius = meas.speed / meas.yaw_rate;
+    r.x += radius * (sin(meas.heading + turn) - sin(meas.heading));
+    r.y += radius * (cos(meas.heading) - cos(meas.heading + turn));
+  }
+  return r;
+}
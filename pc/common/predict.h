@@ -0,0 +1,81 @@
+#ifndef __PREDICT_H
+#define __PREDICT_H
+
+#include <deque>
+
+/// Settings of the state predictor
+struct predict_settings {
+  double window;        ///< time window of the velocity estimate, at least one gait period [s]
+  double min_dist;      ///< displacement required for a valid estimate [m]
+  double rate_tau;      ///< time constant of the low-pass filter of the yaw rate [s]
+  double max_rate;      ///< yaw rate limit, against the noise of short displacements [rad/s]
+  double latency;       ///< time from the capture of a frame to the effect of a command [s]
+
+  predict_settings()
+    : window(1.0), min_dist(0.05), rate_tau(0.5), max_rate(1.0), latency(0) {}
+};
+
+/// Planar state of the robot
+struct robot_state {
+  double t;             ///< time of the state [s]
+  double x, y;          ///< position [m]
+  double heading;       ///< heading [rad], 0 along x, positive towards y
+  double speed;         ///< forward speed [m/s]
+  double yaw_rate;      ///< rate of the heading [rad/s]
+};
+
+/** \brief Predicts the state of the robot at the time a command sent now
+  *   takes effect. The position the controllers see is old: the velocity and
+  *   the heading are measured over a time window and belong to its middle,
+  *   and the frame itself was captured one latency earlier than the command
+  *   acts (camera, network, radio and firmware, see CLatencyProbe). The state
+  *   measured in the middle of the window is propagated over this delay with
+  *   a constant speed and yaw rate, along an arc.
+  */
+class CStatePredictor {
+
+public:
+
+  CStatePredictor(const predict_settings& s = predict_settings());
+
+  /// Forgets all the positions
+  void reset();
+
+  /// Sets the latency to compensate [s]
+  void set_latency(double latency) { s.latency = latency; }
+
+  /// Latency compensated [s]
+  double latency() const { return s.latency; }
+
+  /** \brief Adds a position
+    * \param t Time of the frame [s]
+    * \param detected true if the robot was found, at (x, y)
+    * \return true if the state is valid
+    */
+  bool update(double t, bool detected, double x, double y);
+
+  /// true if enough displacement has been seen in the window
+  bool valid() const { return ok; }
+
+  /// State measured in the middle of the window
+  const robot_state& measured() const { return meas; }
+
+  /// State predicted at the time of the last frame plus the latency
+  const robot_state& predicted() const { return pred; }
+
+  /// State propagated from the measured one to a given time [s]
+  robot_state at(double t) const;
+
+private:
+
+  struct pos { double t, x, y; };
+
+  predict_settings s;
+  std::deque<pos> hist;
+  robot_state meas, pred;
+  bool ok;
+  bool has_rate;        ///< the yaw rate filter is initialised
+
+};
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * profmon.cc -- reading and printing of the profile of the head firmware
+ */
+
+#include "profmon.h"
+
+/// Duration of a system timer tic of the head [us]
+static const double TIC_US = 0.1;
+
+static const char* SECTION_NAMES[PROF_MAX] = {
+  "gait", "CAN", "I2C LED", "UART ISR", "timer1 ISR"
+};
+
+static uint32_t read_32(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+CProfileMonitor::CProfileMonitor()
+  : t_cur(0), t_prev(0)
+{
+  for (int i(0); i < PROF_MAX; i++) valid[i] = valid_prev[i] = false;
+}
+
+bool CProfileMonitor::decode(const uint8_t* data, uint8_t len, prof_record& r)
+{
+  if (len != sizeof(prof_record)) return false;
+  r.count = read_32(data);
+  r.min = read_32(data + 4);
+  r.max = read_32(data + 8);
+  r.mean = read_32(data + 12);
+  return true;
+}
+
+void CProfileMonitor::update(uint8_t section, const prof_record& r, double t)
+{
+  if (section >= PROF_MAX) return;
+  if (t != t_cur) {
+    // a new reading: the current one becomes the previous one
+    for (int i(0); i < PROF_MAX; i++) {
+      prev[i] = cur[i];
+      valid_prev[i] = valid[i];
+      valid[i] = false;
+    }
+    t_prev = t_cur;
+    t_cur = t;
+  }
+  cur[section] = r;
+  valid[section] = true;
+}
+
+bool CProfileMonitor::poll(CRemoteRegs& regs, double t)
+{
+  uint8_t data[29], len;
+  prof_record r;
+  bool ok(true);
+
+  for (int i(0); i < PROF_MAX; i++) {
+    if (regs.get_reg_mb(REGMB_PROFILE + i, data, len) && decode(data, len, r)) {
+      update(i, r, t);
+    } else {
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+bool CProfileMonitor::clear(CRemoteRegs& regs)
+{
+  uint8_t dummy(0);
+
+  for (int i(0); i < PROF_MAX; i++) valid[i] = valid_prev[i] = false;
+  return regs.set_reg_mb(REGMB_PROFILE, &dummy, 1);
+}
+
+const char* CProfileMonitor::name(uint8_t section)
+{
+  return section < PROF_MAX ? SECTION_NAMES[section] : "?";
+}
+
+void CProfileMonitor::print(FILE* f) const
+{
+  double dt = t_cur - t_prev;
+
+  fprintf(f, "%-12s %10s %10s %10s %10s %10s %8s\n", "section", "count", "min [us]", "mean [us]",
+          "max [us]", "rate [/s]", "time [%]");
+  for (int i(0); i < PROF_MAX; i++) {
+    const prof_record& r = cur[i];
+    if (!valid[i]) {
+      fprintf(f, "%-12s %10s\n", name(i), "no answer");
+      continue;
+    }
+    fprintf(f, "%-12s %10u %10.1f %10.1f %10.1f", name(i), (unsigned int) r.count,
+            r.min * TIC_US, r.mean * TIC_US, r.max * TIC_US);
+
+    // rate and share of the time since the previous reading, unless the
+    // records were cleared (or the head rebooted) in between
+    const prof_record& p = prev[i];
+    if (valid_prev[i] && dt > 0 && r.count >= p.count) {
+      double busy = (double) r.count * r.mean - (double) p.count * p.mean;
+      fprintf(f, " %10.1f %8.2f", (r.count - p.count) / dt, busy * TIC_US / (dt * 1e4));
+    }
+    fprintf(f, "\n");
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef __PROFMON_H
+#define __PROFMON_H
+
+#include <stdint.h>
+#include <cstdio>
+#include "regdefs.h"
+#include "remregs.h"
+
+/** \brief Profile of the head firmware (see robot/firmware/profile.h): reads
+  *   the record of each section from its multibyte register (REGMB_PROFILE
+  *   and up) and prints them as a table, with the rate of each section and
+  *   the share of the time it took since the previous reading.
+  *
+  *   The durations include the interrupts that fall in a section, and a
+  *   section may contain another (the timer1 interrupt the LED writes of its
+  *   user function): the shares may add up to more than the time spent.
+  */
+class CProfileMonitor {
+
+public:
+
+  CProfileMonitor();
+
+  /** \brief Reads all the sections
+    * \param t Time of the reading [s], e.g. time_d()
+    * \return true if all the reads suceeded, false if not
+    */
+  bool poll(CRemoteRegs& regs, double t);
+
+  /// Clears the records on the robot, and forgets the previous reading
+  bool clear(CRemoteRegs& regs);
+
+  /** \brief Decodes the answer to the read of a section register
+    * \return true if it is a record, false if its length is wrong (e.g.
+    *   firmware without profile)
+    */
+  static bool decode(const uint8_t* data, uint8_t len, prof_record& r);
+
+  /** \brief Sets the record of a section, as read by poll()
+    * \param t Time of the reading [s], the same for all the sections
+    */
+  void update(uint8_t section, const prof_record& r, double t);
+
+  /// Name of a section
+  static const char* name(uint8_t section);
+
+  /// Last record of a section
+  const prof_record& record(uint8_t section) const { return cur[section]; }
+
+  /// Prints the last records, with the rates and shares since the previous reading
+  void print(FILE* f = stdout) const;
+
+private:
+
+  prof_record cur[PROF_MAX], prev[PROF_MAX];
+  double t_cur, t_prev;
+  bool valid[PROF_MAX], valid_prev[PROF_MAX];
+
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef __REGOBS_H
+#define __REGOBS_H
+
+#include <stdint.h>
+#include <chrono>
+
+/** \brief Interface of the objects notified of the register operations of a
+  *   CRemoteRegs (see CRemoteRegs::set_observer())
+  */
+class CRegObserver {
+
+public:
+
+  virtual ~CRegObserver() {}
+
+  /** \brief Called after each register operation
+    * \param op Operation code (0-3: read 8/16/32-bit/multibyte, 4-7: write)
+    * \param addr The address of the register
+    * \param data The read or written data (NULL if a read failed)
+    * \param len Length of the data
+    * \param result true if the operation suceeded, false if not
+    * \param t_sent Time the request was sent to the radio interface
+    * \param t_done Time the answer was received (or the operation failed)
+    */
+  virtual void reg_op_done(uint8_t op, uint16_t addr, const uint8_t* data, uint8_t len,
+                           bool result, std::chrono::steady_clock::time_point t_sent,
+                           std::chrono::steady_clock::time_point t_done) = 0;
+
+};
+
+#endif
@@ -9,6 +9,8 @@
 
 #define ATEND(s)  (&s[strlen(s)])
 
+using std::chrono::steady_clock;
+
 #ifdef DEBUG
 const bool DEBUG = true;
 #else
@@ -19,6 +21,7 @@ CRemoteRegs::CRemoteRegs()
 {
   InitializeCriticalSection(&mutex);
   hSer = NULL;
+  observer = NULL;
 }
 
 CRemoteRegs::~CRemoteRegs()
@@ -136,24 +139,23 @@ bool CRemoteRegs::get_reg_b(const uint16_t addr, uint8_t& res)
   d.addr = addr;
   d.result = false;
   EnterCriticalSection(&mutex);
+  d.t_sent = steady_clock::now();
   if (!reg_op(0x00, addr, NULL, 0)) {
-    if (DEBUG) debug_dump(&d);
+    trace(&d);
     LeaveCriticalSection(&mutex);
     return false;
   }
   if (!ReadFile(hSer, &buf, 1, &l, NULL)) {
     wperror("ReadFile");
-    if (DEBUG) debug_dump(&d);
+    trace(&d);
     LeaveCriticalSection(&mutex);
     return false;
   }
   res = buf;
-  if (DEBUG) {
-    d.adata = (const void*) &res;
-    d.alen = 1;
-    d.result = true;
-    debug_dump(&d);
-  }
+  d.adata = (const void*) &res;
+  d.alen = 1;
+  d.result = true;
+  trace(&d);
   LeaveCriticalSection(&mutex);
   return true;
 }
@@ -167,24 +169,23 @@ bool CRemoteRegs::get_reg_w(const uint16_t addr, uint16_t& res)
   d.addr = addr;
   d.result = false;
   EnterCriticalSection(&mutex);
+  d.t_sent = steady_clock::now();
   if (!reg_op(0x01, addr, NULL, 0)) {
     LeaveCriticalSection(&mutex);
-    if (DEBUG) debug_dump(&d);
+    trace(&d);
     return false;
   }
   if (!ReadFile(hSer, &buf, 2, &l, NULL)) {
     wperror("ReadFile");
-    if (DEBUG) debug_dump(&d);
+    trace(&d);
     LeaveCriticalSection(&mutex);
     return false;
   }
   res = buf;
-  if (DEBUG) {
-    d.adata = (const void*) &res;
-    d.alen = 2;
-    d.result = true;
-    debug_dump(&d);
-  }
+  d.adata = (const void*) &res;
+  d.alen = 2;
+  d.result = true;
+  trace(&d);
   LeaveCriticalSection(&mutex);
   return true;
 }
@@ -198,24 +199,23 @@ bool CRemoteRegs::get_reg_dw(const uint16_t addr, uint32_t& res)
   d.addr = addr;
   d.result = false;
   EnterCriticalSection(&mutex);
+  d.t_sent = steady_clock::now();
   if (!reg_op(0x02, addr, NULL, 0)) {
-    if (DEBUG) debug_dump(&d);
+    trace(&d);
     LeaveCriticalSection(&mutex);
     return false;
   }
   if (!ReadFile(hSer, &buf, 4, &l, NULL)) {
     wperror("ReadFile");
-    if (DEBUG) debug_dump(&d);
+    trace(&d);
     LeaveCriticalSection(&mutex);
     return false;
   }
   res = buf;
-  if (DEBUG) {
-    d.adata = (const void*) &res;
-    d.alen = 4;
-    d.result = true;
-    debug_dump(&d);
-  }
+  d.adata = (const void*) &res;
+  d.alen = 4;
+  d.result = true;
+  trace(&d);
   LeaveCriticalSection(&mutex);
   return true;
 }
@@ -228,31 +228,30 @@ bool CRemoteRegs::get_reg_mb(const uint16_t addr, uint8_t* data, uint8_t& len)
   d.op = 3;
   d.addr = addr;
   d.result = false;
+  d.t_sent = steady_clock::now();
   if (!reg_op(0x03, addr, NULL, 0)) {
-    if (DEBUG) debug_dump(&d);
+    trace(&d);
     LeaveCriticalSection(&mutex);
     return false;
   }
   if (!ReadFile(hSer, &len, 1, &l, NULL)) {
     wperror("ReadFile");
-    if (DEBUG) debug_dump(&d);
+    trace(&d);
     LeaveCriticalSection(&mutex);
     len = 0;
     return false;
   }
   if (!ReadFile(hSer, data, len, &l, NULL)) {
     wperror("ReadFile");
-    if (DEBUG) debug_dump(&d);
+    trace(&d);
     LeaveCriticalSection(&mutex);
     len = 0;
     return false;
   }
-  if (DEBUG) {
-    d.adata = (const void*) data;
-    d.alen = len;
-    d.result = true;
-    debug_dump(&d);
-  }
+  d.adata = (const void*) data;
+  d.alen = len;
+  d.result = true;
+  trace(&d);
   LeaveCriticalSection(&mutex);
   return true;
 }
@@ -281,46 +280,46 @@ uint32_t CRemoteRegs::get_reg_dw(const uint16_t addr)
 
 bool CRemoteRegs::set_reg_b(const uint16_t addr, const uint8_t val)
 {
+  steady_clock::time_point t_sent = steady_clock::now();
   bool res = reg_op(0x04, addr, &val, 1, true);
-  if (DEBUG) {
-    wl_debug d;
-    d.addr = addr;
-    d.op = 4;
-    d.rdata = (const void*) &val;
-    d.rlen = 1;
-    d.result = res;
-    debug_dump(&d);
-  }
+  wl_debug d;
+  d.t_sent = t_sent;
+  d.addr = addr;
+  d.op = 4;
+  d.rdata = (const void*) &val;
+  d.rlen = 1;
+  d.result = res;
+  trace(&d);
   return res;
 }
 
 bool CRemoteRegs::set_reg_w(const uint16_t addr, const uint16_t val)
 {
+  steady_clock::time_point t_sent = steady_clock::now();
   bool res = reg_op(0x05, addr, (const uint8_t *) &val, 2, true);
-  if (DEBUG) {
-    wl_debug d;
-    d.addr = addr;
-    d.op = 5;
-    d.rdata = (const void*) &val;
-    d.rlen = 2;
-    d.result = res;
-    debug_dump(&d);
-  }
+  wl_debug d;
+  d.t_sent = t_sent;
+  d.addr = addr;
+  d.op = 5;
+  d.rdata = (const void*) &val;
+  d.rlen = 2;
+  d.result = res;
+  trace(&d);
   return res;
 }
 
 bool CRemoteRegs::set_reg_dw(const uint16_t addr, const uint32_t val)
 {
+  steady_clock::time_point t_sent = steady_clock::now();
   bool res = reg_op(0x06, addr, (const uint8_t*) &val, 4, true);
-  if (DEBUG) {
-    wl_debug d;
-    d.addr = addr;
-    d.op = 6;
-    d.rdata = (const void*) &val;
-    d.rlen = 4;
-    d.result = res;
-    debug_dump(&d);
-  }
+  wl_debug d;
+  d.t_sent = t_sent;
+  d.addr = addr;
+  d.op = 6;
+  d.rdata = (const void*) &val;
+  d.rlen = 4;
+  d.result = res;
+  trace(&d);
   return res;
 }
 
@@ -330,19 +329,35 @@ bool CRemoteRegs::set_reg_mb(const uint16_t addr, const uint8_t* data, const uin
   if (len>29) return false;
   buf[0] = len;
   for (int i(0); i<len; i++) buf[i+1] = data[i];
+  steady_clock::time_point t_sent = steady_clock::now();
   bool res = reg_op(0x07, addr, buf, len + 1, true);
-  if (DEBUG) {
-    wl_debug d;
-    d.addr = addr;
-    d.op = 7;
-    d.rdata = (const void*) data;
-    d.rlen = len;
-    d.result = res;
-    debug_dump(&d);
-  }
+  wl_debug d;
+  d.t_sent = t_sent;
+  d.addr = addr;
+  d.op = 7;
+  d.rdata = (const void*) data;
+  d.rlen = len;
+  d.result = res;
+  trace(&d);
   return res;
 }
 
+void CRemoteRegs::trace(const wl_debug* dbg)
+{
+  if (DEBUG) debug_dump(dbg);
+  if (!observer) return;
+  steady_clock::time_point t_done = steady_clock::now();
+  if (dbg->op >= 4) {
+    observer->reg_op_done(dbg->op, dbg->addr, (const uint8_t*) dbg->rdata, dbg->rlen, dbg->result,
+                          dbg->t_sent, t_done);
+  } else if (dbg->result) {
+    observer->reg_op_done(dbg->op, dbg->addr, (const uint8_t*) dbg->adata, dbg->alen, true,
+                          dbg->t_sent, t_done);
+  } else {
+    observer->reg_op_done(dbg->op, dbg->addr, NULL, 0, false, dbg->t_sent, t_done);
+  }
+}
+
 void CRemoteRegs::debug_dump(const wl_debug* dbg)
 {
   char buffer[128];
@@ -11,6 +11,8 @@ typedef unsigned __int16 uint16_t;
 typedef unsigned __int32 uint32_t;
 #endif
 
+#include "regobs.h"
+
 const uint8_t ACK = 6;
 const uint8_t NAK = 15;
 
@@ -109,6 +111,11 @@ public:
     */
   bool set_reg_mb(const uint16_t addr, const uint8_t* data, const uint8_t len);
 
+  /** \brief Sets an object notified after each register operation (e.g. to
+    *   record them in a timeline), NULL to remove it
+    */
+  void set_observer(CRegObserver* obs) { observer = obs; }
+
 private:
 
   struct wl_debug {
@@ -119,6 +126,7 @@ private:
     uint8_t alen;
     const void* adata;
     bool result;
+    std::chrono::steady_clock::time_point t_sent;
   };
 
   /// Internal function for register operations
@@ -127,12 +135,18 @@ private:
   /// Displays debug trace for a register operation
   void debug_dump(const wl_debug* dbg);
 
+  /// Passes a finished register operation to the debug trace and the observer
+  void trace(const wl_debug* dbg);
+
   /// Handle to the serial port
   HANDLE hSer;
   
   /// Mutex to avoid simulataneous accesses to the serial port
   CRITICAL_SECTION mutex;
 
+  /// Object notified of the register operations (may be NULL)
+  CRegObserver* observer;
+
 };
 
 #endif
@@ -0,0 +1,171 @@
+/*
+ * rtthread.cc -- periodic control thread with real-time scheduling and jitter statistics
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <pthread.h>
+  #include <sched.h>
+  #include <time.h>
+  #include <sys/mman.h>
+#endif
+
+#include "rtthread.h"
+
+using namespace std;
+
+typedef chrono::steady_clock clock_type;
+
+CRealtimeThread::CRealtimeThread(const rt_settings& s)
+  : jitter_hist(10, 200), cycles(0), misses(0), s(s), quit(false), active(false),
+    got_priority(false), got_cpu(false), got_lock(false), precise_timer(false), locked(false)
+{
+}
+
+CRealtimeThread::~CRealtimeThread()
+{
+  stop();
+}
+
+bool CRealtimeThread::start(const cycle_handler& h)
+{
+  if (active || th.joinable()) return false;
+  handler = h;
+  jitter.clear();
+  jitter_hist.clear();
+  cycle_time.clear();
+  cycles = misses = 0;
+  quit = false;
+
+#ifndef _WIN32
+  // locks the current and future pages (stack and heap growth included),
+  // once per start() as wait() unlocks them once
+  got_lock = s.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+  locked = got_lock;
+#endif
+  active = true;
+  th = thread(&CRealtimeThread::run, this);
+  return true;
+}
+
+void CRealtimeThread::stop()
+{
+  quit = true;
+  wait();
+}
+
+void CRealtimeThread::wait()
+{
+  if (th.joinable()) th.join();
+#ifndef _WIN32
+  if (locked) munlockall();
+#endif
+  locked = false;
+}
+
+void CRealtimeThread::setup_thread()
+{
+#ifdef _WIN32
+  got_priority = s.priority > 0 && SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+  got_cpu = s.cpu >= 0 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << s.cpu) != 0;
+#else
+  if (s.priority > 0) {
+    sched_param p;
+    memset(&p, 0, sizeof(p));
+    p.sched_priority = s.priority;
+    // fails without CAP_SYS_NICE or an rtprio limit, the thread then keeps the normal scheduling
+    got_priority = pthread_setschedparam(pthread_self(), SCHED_FIFO, &p) == 0;
+  }
+  if (s.cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(s.cpu, &set);
+    got_cpu = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+  }
+#endif
+}
+
+void CRealtimeThread::run()
+{
+  setup_thread();
+
+#ifdef _WIN32
+  HANDLE timer = NULL;
+#ifdef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+  timer = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+  precise_timer = (timer != NULL);
+  if (!timer) timer = CreateWaitableTimer(NULL, FALSE, NULL);
+#else
+  precise_timer = true;
+#endif
+
+  clock_type::duration period = chrono::duration_cast<clock_type::duration>(chrono::duration<double>(s.period));
+  clock_type::time_point next = clock_type::now() + period;
+
+  while (!quit) {
+    // sleeps until the deadline
+#ifdef _WIN32
+    clock_type::duration left = next - clock_type::now();
+    if (left.count() > 0) {
+      LARGE_INTEGER due;
+      due.QuadPart = -max((LONGLONG) (chrono::duration<double>(left).count() * 1e7), (LONGLONG) 1);
+      if (timer && SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) {
+        WaitForSingleObject(timer, INFINITE);
+      } else {
+        Sleep((DWORD) chrono::duration_cast<chrono::milliseconds>(left).count());
+      }
+    }
+#else
+    // the steady clock of the standard library is CLOCK_MONOTONIC
+    chrono::nanoseconds ns = chrono::duration_cast<chrono::nanoseconds>(next.time_since_epoch());
+    timespec ts;
+    ts.tv_sec = ns.count() / 1000000000;
+    ts.tv_nsec = ns.count() % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+#endif
+
+    clock_type::time_point woke = clock_type::now();
+    double late = chrono::duration<double, micro>(woke - next).count();
+    jitter.add(late);
+    jitter_hist.add(late);
+
+    bool go = handler();
+    clock_type::time_point done = clock_type::now();
+    cycle_time.add(chrono::duration<double, micro>(done - woke).count());
+    cycles++;
+
+    // skips the deadlines already passed
+    next += period;
+    while (next <= done) {
+      next += period;
+      misses++;
+    }
+    if (!go) break;
+  }
+
+#ifdef _WIN32
+  if (timer) CloseHandle(timer);
+#endif
+  active = false;
+}
+
+void CRealtimeThread::print_summary(FILE* f) const
+{
+  fprintf(f, "Control thread: %.3f ms period, %s, %s, %s%s\n", s.period * 1000,
+          got_priority ? "real-time priority" : "normal priority",
+          got_cpu ? "pinned" : "not pinned",
+          got_lock ? "memory locked" : "memory not locked",
+          precise_timer ? "" : ", low-resolution timer");
+  fprintf(f, "%llu cycle(s), %llu missed deadline(s)\n", (unsigned long long) cycles,
+          (unsigned long long) misses);
+  jitter.print("Wake-up jitter", f);
+  jitter_hist.print("Jitter distribution", f);
+  cycle_time.print("Cycle time", f);
+}
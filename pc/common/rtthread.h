@@ -0,0 +1,91 @@
+#ifndef __RTTHREAD_H
+#define __RTTHREAD_H
+
+#include <stdint.h>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include "timing.h"
+
+/// Settings of a real-time control thread
+struct rt_settings {
+  double period;        ///< cycle period [s]
+  int priority;         ///< real-time priority (SCHED_FIFO, 1 to 99), 0 for the normal scheduling
+  int cpu;              ///< CPU the thread is pinned to, -1 for any
+  bool lock_memory;     ///< locks the memory of the process, so that no page fault delays a cycle
+
+  rt_settings() : period(0.01), priority(80), cpu(-1), lock_memory(true) {}
+};
+
+/** \brief Runs a function periodically in a dedicated thread, waking up at
+  *   absolute deadlines so that the period does not drift with the time
+  *   taken by each cycle. The thread asks for a real-time priority, a fixed
+  *   CPU and locked memory, and runs anyway with what it was granted (e.g.
+  *   without privileges), which is reported by print_summary().
+  *
+  *   The wake-up delay after each deadline (jitter) is recorded, as well as
+  *   the deadlines missed because a cycle took longer than the period; the
+  *   missed cycles are skipped rather than run late in a burst.
+  *
+  *   On Windows, the thread runs at time-critical priority and sleeps on a
+  *   high-resolution waitable timer when available; the memory is not locked.
+  */
+class CRealtimeThread {
+
+public:
+
+  /// Function run at each cycle, returns false to stop the thread
+  typedef std::function<bool()> cycle_handler;
+
+  CRealtimeThread(const rt_settings& s = rt_settings());
+
+  /// Stops the thread
+  ~CRealtimeThread();
+
+  /// Starts the thread, returns false if it is already running
+  bool start(const cycle_handler& h);
+
+  /// Asks the thread to stop after the current cycle and waits for it
+  void stop();
+
+  /// Waits until the handler stops the thread, and unlocks the memory
+  void wait();
+
+  /// true until the thread has stopped
+  bool running() const { return active; }
+
+  /** \brief Prints the scheduling obtained, the jitter and the deadline
+    *   misses (once the thread has stopped)
+    */
+  void print_summary(FILE* f = stdout) const;
+
+  CTimingStats jitter;            ///< delay of the wake-ups after the deadlines
+  CTimingHistogram jitter_hist;   ///< distribution of the same delays
+  CTimingStats cycle_time;        ///< time spent in the handler
+  uint64_t cycles;                ///< number of cycles run
+  uint64_t misses;                ///< number of deadlines missed
+
+private:
+
+  void run();
+  /// Applies the priority and the CPU to the calling thread
+  void setup_thread();
+
+  rt_settings s;
+  cycle_handler handler;
+  std::thread th;
+  std::atomic<bool> quit;
+  std::atomic<bool> active;
+
+  // what was granted
+  bool got_priority;
+  bool got_cpu;
+  bool got_lock;
+  bool precise_timer;
+  /// the memory is locked for this thread, until wait() unlocks it
+  bool locked;
+
+};
+
+#endif
@@ -0,0 +1,340 @@
+/*
+ * runindex.cc -- on-disk catalog of the tracking logs with range queries
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "runindex.h"
+
+using namespace std;
+
+static const char INDEX_MAGIC[4] = { 'R', 'I', 'D', 'X' };
+static const uint32_t INDEX_VERSION = 1;
+
+/// File header of the index
+struct index_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t count;        ///< number of records
+  uint32_t names_size;   ///< size of the file name table following the records
+} __attribute__((__packed__));
+
+/// One run as stored on disk, the path is stored in the name table
+struct index_record {
+  uint64_t size;
+  int64_t mtime;
+  uint64_t stamp;
+  float freq, amp, lag, off;
+  uint32_t samples;
+  int64_t t_first;
+  float duration, speed, path_length, displacement;
+  uint32_t name_offset;
+  uint16_t name_length;
+} __attribute__((__packed__));
+
+run_query::run_query()
+{
+  freq_min = amp_min = lag_min = off_min = -1e30f;
+  freq_max = amp_max = lag_max = off_max = 1e30f;
+  stamp_min = 0;
+  stamp_max = UINT64_MAX;
+}
+
+// Parses "min:max" or "value~tol", either bound of min:max may be omitted
+static bool parse_range(const char* s, float& lo, float& hi)
+{
+  char* p;
+  const char* t = strchr(s, '~');
+  if (t) {
+    float v = strtof(s, &p);
+    float tol = strtof(t + 1, NULL);
+    if (p != t) return false;
+    lo = v - tol;
+    hi = v + tol;
+    return true;
+  }
+  const char* c = strchr(s, ':');
+  if (!c) {
+    lo = hi = strtof(s, NULL);
+    return true;
+  }
+  if (c != s) lo = strtof(s, NULL);
+  if (c[1] != 0) hi = strtof(c + 1, NULL);
+  return true;
+}
+
+// Converts a date YYYY-MM-DD[-hh[-mm[-ss]]] to YYYYMMDDhhmmss, the fields
+// being zero-padded (2024-3-5 is 2024-03-05) and the missing ones filled
+// with 'fill'. Returns false if a field is empty, too long or not a number.
+static bool parse_date(const string& s, char fill, uint64_t& stamp)
+{
+  static const size_t WIDTHS[] = { 4, 2, 2, 2, 2, 2 };
+  string d;
+  size_t i(0), f(0);
+  while (i < s.size()) {
+    if (f == 6) return false;
+    size_t e = s.find('-', i);
+    if (e == string::npos) e = s.size();
+    string field = s.substr(i, e - i);
+    if (field.empty() || field.size() > WIDTHS[f] ||
+        field.find_first_not_of("0123456789") != string::npos) return false;
+    d += string(WIDTHS[f] - field.size(), '0') + field;
+    f++;
+    i = e + 1;
+    if (e + 1 == s.size()) return false;
+  }
+  d.resize(14, fill);
+  stamp = strtoull(d.c_str(), NULL, 10);
+  return true;
+}
+
+static bool parse_date_range(const char* s, uint64_t& lo, uint64_t& hi)
+{
+  string str(s);
+  size_t c = str.find(':');
+  string from = str.substr(0, c);
+  string to = (c == string::npos) ? from : str.substr(c + 1);
+  if (!from.empty() && !parse_date(from, '0', lo)) return false;
+  if (!to.empty() && !parse_date(to, '9', hi)) return false;
+  return true;
+}
+
+bool parse_query_term(const char* arg, run_query& q)
+{
+  if (!strncmp(arg, "freq=", 5)) return parse_range(arg + 5, q.freq_min, q.freq_max);
+  if (!strncmp(arg, "amp=", 4)) return parse_range(arg + 4, q.amp_min, q.amp_max);
+  if (!strncmp(arg, "lag=", 4)) return parse_range(arg + 4, q.lag_min, q.lag_max);
+  if (!strncmp(arg, "off=", 4)) return parse_range(arg + 4, q.off_min, q.off_max);
+  if (!strncmp(arg, "date=", 5)) return parse_date_range(arg + 5, q.stamp_min, q.stamp_max);
+  return false;
+}
+
+static bool entry_less(const run_entry& a, const run_entry& b)
+{
+  if (a.info.stamp != b.info.stamp) return a.info.stamp < b.info.stamp;
+  return a.path < b.path;
+}
+
+static bool entry_stamp_less(const run_entry& e, uint64_t stamp)
+{
+  return e.info.stamp < stamp;
+}
+
+CRunIndex::CRunIndex()
+{
+}
+
+bool CRunIndex::load(const char* filename)
+{
+  FILE* f = fopen(filename, "rb");
+  if (!f) return false;
+
+  index_header h;
+  if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, INDEX_MAGIC, 4) != 0 ||
+      h.version != INDEX_VERSION) {
+    fprintf(stderr, "%s: not a valid run index.\n", filename);
+    fclose(f);
+    return false;
+  }
+
+  vector<index_record> rec(h.count);
+  vector<char> names(h.names_size);
+  if ((h.count > 0 && fread(&rec[0], sizeof(index_record), h.count, f) != h.count) ||
+      (h.names_size > 0 && fread(&names[0], 1, h.names_size, f) != h.names_size)) {
+    fprintf(stderr, "%s: truncated run index.\n", filename);
+    fclose(f);
+    return false;
+  }
+  fclose(f);
+
+  entries.resize(h.count);
+  for (uint32_t i(0); i < h.count; i++) {
+    const index_record& r = rec[i];
+    run_entry& e = entries[i];
+    if ((uint64_t) r.name_offset + r.name_length > h.names_size) {
+      fprintf(stderr, "%s: corrupted run index.\n", filename);
+      entries.clear();
+      return false;
+    }
+    e.path.assign(&names[r.name_offset], r.name_length);
+    e.size = r.size;
+    e.mtime = r.mtime;
+    e.info.stamp = r.stamp;
+    e.info.freq = r.freq;
+    e.info.amp = r.amp;
+    e.info.lag = r.lag;
+    e.info.off = r.off;
+    e.sum.samples = r.samples;
+    e.sum.t_first = r.t_first;
+    e.sum.duration = r.duration;
+    e.sum.speed = r.speed;
+    e.sum.path_length = r.path_length;
+    e.sum.displacement = r.displacement;
+  }
+  sort_entries();
+
+  return true;
+}
+
+bool CRunIndex::save(const char* filename) const
+{
+  vector<index_record> rec(entries.size());
+  string names;
+
+  for (size_t i(0); i < entries.size(); i++) {
+    const run_entry& e = entries[i];
+    index_record& r = rec[i];
+    r.size = e.size;
+    r.mtime = e.mtime;
+    r.stamp = e.info.stamp;
+    r.freq = e.info.freq;
+    r.amp = e.info.amp;
+    r.lag = e.info.lag;
+    r.off = e.info.off;
+    r.samples = e.sum.samples;
+    r.t_first = e.sum.t_first;
+    r.duration = e.sum.duration;
+    r.speed = e.sum.speed;
+    r.path_length = e.sum.path_length;
+    r.displacement = e.sum.displacement;
+    r.name_offset = names.size();
+    r.name_length = e.path.size();
+    names += e.path;
+  }
+
+  index_header h;
+  memcpy(h.magic, INDEX_MAGIC, 4);
+  h.version = INDEX_VERSION;
+  h.count = rec.size();
+  h.names_size = names.size();
+
+  string tmp = string(filename) + ".tmp";
+  FILE* f = fopen(tmp.c_str(), "wb");
+  if (!f) {
+    perror(tmp.c_str());
+    return false;
+  }
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+  if (ok && !rec.empty()) ok = fwrite(&rec[0], sizeof(index_record), rec.size(), f) == rec.size();
+  if (ok && !names.empty()) ok = fwrite(names.data(), 1, names.size(), f) == names.size();
+  if (fclose(f) != 0) ok = false;
+  if (!ok) {
+    fprintf(stderr, "Error while writing %s.\n", tmp.c_str());
+    remove(tmp.c_str());
+    return false;
+  }
+
+  // rename() does not replace an existing file on Windows
+  remove(filename);
+  if (rename(tmp.c_str(), filename) != 0) {
+    perror(filename);
+    return false;
+  }
+  return true;
+}
+
+bool CRunIndex::index_file(const string& path, run_entry& e)
+{
+  vector<track_sample> samples;
+
+  if (!load_run_log(path, samples)) return false;
+  summarize_run(samples, e.sum);
+  return true;
+}
+
+int CRunIndex::scan(const char* dirname)
+{
+  DIR* dir = opendir(dirname);
+  if (!dir) {
+    perror(dirname);
+    return -1;
+  }
+
+  map<string, size_t> known;
+  for (size_t i(0); i < entries.size(); i++) known[entries[i].path] = i;
+
+  string prefix(dirname);
+  if (!prefix.empty() && prefix[prefix.size() - 1] != '/' && prefix[prefix.size() - 1] != '\\') {
+    prefix += '/';
+  }
+
+  int count(0);
+  struct dirent* de;
+  while ((de = readdir(dir)) != NULL) {
+    run_entry e;
+    if (!parse_run_name(de->d_name, e.info)) continue;
+
+    e.path = prefix + de->d_name;
+    struct stat st;
+    if (stat(e.path.c_str(), &st) != 0) continue;
+    e.size = st.st_size;
+    e.mtime = st.st_mtime;
+
+    map<string, size_t>::const_iterator it = known.find(e.path);
+    if (it != known.end() && entries[it->second].size == e.size &&
+        entries[it->second].mtime == e.mtime) {
+      continue;
+    }
+    if (!index_file(e.path, e)) {
+      fprintf(stderr, "Unable to read %s.\n", e.path.c_str());
+      continue;
+    }
+
+    if (it != known.end()) {
+      entries[it->second] = e;
+    } else {
+      known[e.path] = entries.size();
+      entries.push_back(e);
+    }
+    count++;
+  }
+  closedir(dir);
+
+  if (count > 0) sort_entries();
+  return count;
+}
+
+int CRunIndex::prune()
+{
+  size_t j(0);
+  struct stat st;
+
+  for (size_t i(0); i < entries.size(); i++) {
+    if (stat(entries[i].path.c_str(), &st) == 0) {
+      if (i != j) entries[j] = entries[i];
+      j++;
+    }
+  }
+  int removed = entries.size() - j;
+  entries.resize(j);
+  return removed;
+}
+
+void CRunIndex::query(const run_query& q, vector<const run_entry*>& res) const
+{
+  res.clear();
+
+  // the entries are sorted by date, so the date range is found by bisection
+  vector<run_entry>::const_iterator it = lower_bound(entries.begin(), entries.end(),
+    q.stamp_min, entry_stamp_less);
+
+  for (; it != entries.end() && it->info.stamp <= q.stamp_max; ++it) {
+    const run_info& r = it->info;
+    if (r.freq >= q.freq_min && r.freq <= q.freq_max &&
+        r.amp >= q.amp_min && r.amp <= q.amp_max &&
+        r.lag >= q.lag_min && r.lag <= q.lag_max &&
+        r.off >= q.off_min && r.off <= q.off_max) {
+      res.push_back(&*it);
+    }
+  }
+}
+
+void CRunIndex::sort_entries()
+{
+  sort(entries.begin(), entries.end(), entry_less);
+}
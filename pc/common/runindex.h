@@ -0,0 +1,94 @@
+#ifndef __RUNINDEX_H
+#define __RUNINDEX_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "runlog.h"
+
+/// One indexed run: where its log is and what it contains
+struct run_entry {
+  std::string path;   ///< path of the log file
+  uint64_t size;      ///< file size when indexed [bytes]
+  int64_t mtime;      ///< modification time when indexed [s]
+  run_info info;      ///< parameters parsed from the file name
+  run_summary sum;    ///< precomputed metrics
+};
+
+/// Range query over the indexed runs, all bounds are inclusive
+struct run_query {
+  float freq_min, freq_max;
+  float amp_min, amp_max;
+  float lag_min, lag_max;
+  float off_min, off_max;
+  uint64_t stamp_min, stamp_max;   ///< dates as YYYYMMDDhhmmss
+
+  /// Initializes a query that matches all the runs
+  run_query();
+};
+
+/** \brief Parses one query term of the form "param=min:max" or "param=value~tol"
+  *   (param is freq, amp, lag or off), or "date=from:to" with dates written as
+  *   YYYY-MM-DD[-hh[-mm[-ss]]]. Either bound of a range may be omitted.
+  * \return true if the term was valid, false if not
+  */
+bool parse_query_term(const char* arg, run_query& q);
+
+/** \brief Catalog of the tracking logs of all experiments, kept in a compact
+  *   binary file so that analysis tools do not have to list and parse
+  *   directories each time.
+  */
+class CRunIndex {
+
+public:
+
+  CRunIndex();
+
+  /** \brief Loads the index from a file
+    * \return true on success, false if the file does not exist or is invalid
+    */
+  bool load(const char* filename);
+
+  /** \brief Writes the index to a file (through a temporary file, so that an
+    *   existing index is never left half-written)
+    * \return true on success, false if not
+    */
+  bool save(const char* filename) const;
+
+  /** \brief Indexes the log files of a directory. Files that are already
+    *   indexed with the same size and modification time are skipped.
+    * \return The number of files that were (re)indexed, or -1 if the directory
+    *   could not be opened
+    */
+  int scan(const char* dirname);
+
+  /// Removes the entries whose file does not exist anymore, returns their number
+  int prune();
+
+  /** \brief Finds all the runs matching a query, sorted by start date
+    * \param q The query
+    * \param res Vector receiving pointers to the matching entries (valid until
+    *   the next modification of the index)
+    */
+  void query(const run_query& q, std::vector<const run_entry*>& res) const;
+
+  /// Number of indexed runs
+  size_t size() const { return entries.size(); }
+
+  /// Direct access to an entry (sorted by start date)
+  const run_entry& operator[](size_t i) const { return entries[i]; }
+
+private:
+
+  /// Indexes one file, returns false if it is not a valid log
+  bool index_file(const std::string& path, run_entry& e);
+
+  /// Keeps the entries sorted by start date, for the date range lookup
+  void sort_entries();
+
+  /// All the entries, sorted by (stamp, path)
+  std::vector<run_entry> entries;
+
+};
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * runlog.cc -- parsing and summary metrics of the ex7 tracking logs
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "runlog.h"
+#include "trkcodec.h"
+
+using namespace std;
+
+string make_run_name(float freq, float amp, float lag, float off)
+{
+  time_t now = time(0);
+  tm *ltm = localtime(&now);
+  return "robot_position_" + to_string(ltm->tm_year + 1900) + "_" + to_string(ltm->tm_mon + 1) +
+    "_" + to_string(ltm->tm_mday) + "_" + to_string(ltm->tm_hour) + "_" +
+    to_string(ltm->tm_min) + "_" + to_string(ltm->tm_sec) + "_freq_" + to_string(freq) +
+    "_amp_" + to_string(amp) + "_lag_" + to_string(lag) + "_off_" + to_string(off);
+}
+
+bool parse_run_name(const string& name, run_info& info)
+{
+  int y, mo, d, h, mi, s, n(-1);
+
+  if (sscanf(name.c_str(), "robot_position_%d_%d_%d_%d_%d_%d_freq_%f_amp_%f_lag_%f_off_%f%n",
+      &y, &mo, &d, &h, &mi, &s, &info.freq, &info.amp, &info.lag, &info.off, &n) != 10) {
+    return false;
+  }
+  // %f takes the dot of the extension after an integer offset (e.g. "off_0.csv")
+  if (name[n - 1] == '.') n--;
+  if (name.compare(n, string::npos, ".csv") != 0 && name.compare(n, string::npos, ".trk") != 0) {
+    return false;
+  }
+
+  info.stamp = (uint64_t) y * 10000000000ULL + (uint64_t) mo * 100000000ULL +
+    (uint64_t) d * 1000000ULL + (uint64_t) h * 10000ULL + (uint64_t) mi * 100ULL + s;
+  return true;
+}
+
+bool load_run_csv(const string& path, vector<track_sample>& samples)
+{
+  FILE* f = fopen(path.c_str(), "r");
+  if (!f) return false;
+
+  char line[128];
+  samples.clear();
+
+  // skips the "Timestamp,X,Y" header
+  if (!fgets(line, sizeof(line), f)) {
+    fclose(f);
+    return true;
+  }
+
+  while (fgets(line, sizeof(line), f)) {
+    track_sample ts;
+    char* p;
+    ts.t = strtoll(line, &p, 10);
+    if (*p++ != ',') continue;
+    ts.x = strtof(p, &p);
+    if (*p++ != ',') continue;
+    ts.y = strtof(p, &p);
+    samples.push_back(ts);
+  }
+
+  fclose(f);
+  return true;
+}
+
+bool load_run_log(const string& path, vector<track_sample>& samples, vector<track_event>* events)
+{
+  size_t l = path.size();
+  if (events) events->clear();
+  if (l > 4 && path.compare(l - 4, 4, ".trk") == 0) {
+    CTrackReader r;
+    samples.clear();
+    return r.open(path.c_str()) && r.read_all(samples, events);
+  }
+  return load_run_csv(path, samples);
+}
+
+double window_speed(const vector<track_sample>& samples, int64_t t1, int64_t t2)
+{
+  double sum(0);
+  int count(0);
+  const track_sample* prev = NULL;
+
+  for (size_t i(0); i < samples.size(); i++) {
+    const track_sample& s = samples[i];
+    if (s.t < t1) continue;
+    if (s.t > t2) break;
+    if (prev && s.t != prev->t) {
+      double dx = s.x - prev->x;
+      double dy = s.y - prev->y;
+      sum += sqrt(dx * dx + dy * dy) / ((s.t - prev->t) / 1000.0);
+      count++;
+    }
+    prev = &s;
+  }
+
+  return count > 0 ? sum / count : NAN;
+}
+
+void summarize_run(const vector<track_sample>& samples, run_summary& sum)
+{
+  sum.samples = samples.size();
+  sum.t_first = 0;
+  sum.duration = 0;
+  sum.speed = NAN;
+  sum.path_length = 0;
+  sum.displacement = 0;
+
+  if (samples.empty()) return;
+
+  const track_sample& first = samples.front();
+  const track_sample& last = samples.back();
+
+  sum.t_first = first.t;
+  sum.duration = (last.t - first.t) / 1000.0f;
+  sum.speed = window_speed(samples, first.t + SPEED_WINDOW_START, first.t + SPEED_WINDOW_END);
+  for (size_t i(1); i < samples.size(); i++) {
+    sum.path_length += hypotf(samples[i].x - samples[i-1].x, samples[i].y - samples[i-1].y);
+  }
+  sum.displacement = hypotf(last.x - first.x, last.y - first.y);
+}
+
+CRunLogger::CRunLogger() : csv(NULL), evt(NULL), trk(NULL)
+{
+}
+
+CRunLogger::~CRunLogger()
+{
+  close();
+}
+
+bool CRunLogger::open(const string& base, bool compressed)
+{
+  close();
+  this->base = base;
+  if (compressed) {
+    name = base + ".trk";
+    trk = new CTrackWriter;
+    if (!trk->open(name.c_str())) {
+      delete trk;
+      trk = NULL;
+      return false;
+    }
+    return true;
+  }
+
+  name = base + ".csv";
+  csv = fopen(name.c_str(), "w");
+  if (!csv) {
+    perror(name.c_str());
+    return false;
+  }
+  fprintf(csv, "Timestamp,X,Y\n");
+  return fflush(csv) == 0;
+}
+
+bool CRunLogger::add(const track_sample& s)
+{
+  if (trk) return trk->add(s);
+  if (!csv) return false;
+  // flushed at each line so that nothing is lost if the program dies
+  fprintf(csv, "%lld,%.3f,%.3f\n", (long long) s.t, s.x, s.y);
+  return fflush(csv) == 0;
+}
+
+bool CRunLogger::add_event(int64_t t, uint32_t code)
+{
+  if (trk) return trk->add_event(t, code);
+  if (!csv) return false;
+  if (!evt) {
+    string evt_name = base + ".evt";
+    evt = fopen(evt_name.c_str(), "w");
+    if (!evt) {
+      perror(evt_name.c_str());
+      return false;
+    }
+    fprintf(evt, "Timestamp,Event\n");
+  }
+  fprintf(evt, "%lld,%u\n", (long long) t, code);
+  return fflush(evt) == 0;
+}
+
+bool CRunLogger::close()
+{
+  bool ok(true);
+  if (trk) {
+    ok = trk->close();
+    delete trk;
+    trk = NULL;
+  }
+  if (csv && fclose(csv) != 0) ok = false;
+  if (evt && fclose(evt) != 0) ok = false;
+  csv = evt = NULL;
+  return ok;
+}
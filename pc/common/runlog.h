@@ -0,0 +1,122 @@
+#ifndef __RUNLOG_H
+#define __RUNLOG_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class CTrackWriter;
+struct track_event;
+
+/// One tracking sample as logged by ex7 (Timestamp,X,Y)
+struct track_sample {
+  int64_t t;    ///< time since epoch [ms]
+  float x;      ///< position along the tank [m]
+  float y;      ///< position across the tank [m]
+};
+
+/// Gait parameters and start date of a run, as encoded in its log file name
+struct run_info {
+  uint64_t stamp;   ///< local start date as YYYYMMDDhhmmss
+  float freq;       ///< oscillation frequency [Hz]
+  float amp;        ///< amplitude [deg]
+  float lag;        ///< lag between elements
+  float off;        ///< offset
+};
+
+/// Summary metrics computed from the samples of one run
+struct run_summary {
+  uint32_t samples;     ///< number of logged samples
+  int64_t t_first;      ///< timestamp of the first sample [ms]
+  float duration;       ///< time between first and last sample [s]
+  float speed;          ///< mean speed in the analysis window [m/s], NAN if too short
+  float path_length;    ///< length of the whole trajectory [m]
+  float displacement;   ///< distance between first and last position [m]
+};
+
+/// Start of the speed analysis window after the first sample [ms] (as in ana.py)
+const int64_t SPEED_WINDOW_START = 3000;
+/// End of the speed analysis window after the first sample [ms]
+const int64_t SPEED_WINDOW_END = 5000;
+
+/** \brief Builds the name of a log file (without extension) from the current
+  *   local time and the gait parameters
+  */
+std::string make_run_name(float freq, float amp, float lag, float off);
+
+/** \brief Parses a log file name of the form
+  *   robot_position_Y_M_D_h_m_s_freq_F_amp_A_lag_L_off_O.csv (or .trk)
+  * \param name File name (without directory)
+  * \param info Structure receiving the parsed fields
+  * \return true if the name matched the pattern, false if not
+  */
+bool parse_run_name(const std::string& name, run_info& info);
+
+/** \brief Reads all the samples of a CSV log file
+  * \return true if the file could be read, false if not
+  */
+bool load_run_csv(const std::string& path, std::vector<track_sample>& samples);
+
+/** \brief Reads all the samples of a log file, either CSV or encoded (.trk)
+  * \param events If not NULL, receives the events of the run (encoded logs only)
+  * \return true if the file could be read, false if not
+  */
+bool load_run_log(const std::string& path, std::vector<track_sample>& samples,
+                  std::vector<track_event>* events = NULL);
+
+/** \brief Mean of the instantaneous speed between two times
+  * \param t1 Start of the window [ms]
+  * \param t2 End of the window [ms]
+  * \return The mean speed in m/s, or NAN if there are less than two samples
+  */
+double window_speed(const std::vector<track_sample>& samples, int64_t t1, int64_t t2);
+
+/// Computes the summary metrics of a run
+void summarize_run(const std::vector<track_sample>& samples, run_summary& sum);
+
+/** \brief Writes the samples of a run as they arrive, either as CSV (the
+  *   format read by ana.py) or encoded with trkcodec (several times smaller)
+  */
+class CRunLogger {
+
+public:
+
+  CRunLogger();
+  ~CRunLogger();
+
+  /** \brief Creates the log file
+    * \param base File name without extension (see make_run_name())
+    * \param compressed true for an encoded .trk log, false for CSV
+    * \return true on success, false if the file cannot be created
+    */
+  bool open(const std::string& base, bool compressed);
+
+  /// Appends a sample, returns false on write error
+  bool add(const track_sample& s);
+
+  /** \brief Marks the run with an event. In CSV mode, the events are written
+    *   to a separate .evt file so that the CSV stays readable by ana.py.
+    */
+  bool add_event(int64_t t, uint32_t code);
+
+  /// Closes the log, returns false if some data could not be written
+  bool close();
+
+  /// true while a log is open
+  bool is_open() const { return csv != NULL || trk != NULL; }
+
+  /// Name of the log file
+  const std::string& filename() const { return name; }
+
+private:
+
+  std::string base;
+  std::string name;
+  FILE* csv;
+  FILE* evt;
+  CTrackWriter* trk;
+
+};
+
+#endif
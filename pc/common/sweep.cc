@@ -0,0 +1,291 @@
+/*
+ * sweep.cc -- gait parameter sweep specification, planning and progress
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "sweep.h"
+
+using namespace std;
+
+static const char* PARAM_NAMES[4] = { "freq", "amp", "lag", "off" };
+
+sweep_spec::sweep_spec()
+{
+  design = SWEEP_GRID;
+  samples = 0;
+  repeat = 1;
+  shuffle = false;
+  seed = 1;
+  duration = 10;
+  settle = 5;
+  has_start = false;
+  start_x = start_y = start_heading = 0;
+  return_timeout = 60;
+}
+
+// Parses "v", "v1,v2,..." or "min:max[:count]"
+static bool parse_values(const char* s, sweep_design design, vector<float>& values)
+{
+  char* p;
+  values.clear();
+
+  if (strchr(s, ':')) {
+    float lo = strtof(s, &p);
+    if (*p++ != ':') return false;
+    float hi = strtof(p, &p);
+    if (design == SWEEP_LHS || design == SWEEP_OPT) {
+      values.push_back(lo);
+      values.push_back(hi);
+      return *p == 0 && hi >= lo;
+    }
+    if (*p++ != ':') return false;
+    int n = strtol(p, &p, 10);
+    if (*p != 0 || n < 1) return false;
+    for (int i(0); i < n; i++) values.push_back(n == 1 ? lo : lo + (hi - lo) * i / (n - 1));
+    return true;
+  }
+
+  for (;;) {
+    values.push_back(strtof(s, &p));
+    if (p == s) return false;
+    if (*p == 0) break;
+    if (*p != ',') return false;
+    s = p + 1;
+  }
+  // a list in an lhs design is a single fixed value
+  return (design != SWEEP_LHS && design != SWEEP_OPT) || values.size() == 1;
+}
+
+bool load_sweep_spec(const char* filename, sweep_spec& spec)
+{
+  FILE* f = fopen(filename, "r");
+  if (!f) {
+    perror(filename);
+    return false;
+  }
+
+  spec = sweep_spec();
+  vector<string> ranges[4];
+  char line[256];
+  int n(0);
+  bool ok(true);
+
+  while (ok && fgets(line, sizeof(line), f)) {
+    n++;
+    char* c = strchr(line, '#');
+    if (c) *c = 0;
+    char key[32], arg[200];
+    int k = sscanf(line, "%31s %199[^\r\n]", key, arg);
+    if (k < 1) continue;
+
+    int param(-1);
+    for (int i(0); i < 4; i++) if (!strcmp(key, PARAM_NAMES[i])) param = i;
+
+    if (param >= 0 && k == 2) {
+      // the values are parsed once the design is known
+      ranges[param].push_back(arg);
+    } else if (!strcmp(key, "design") && k == 2) {
+      if (!strcmp(arg, "grid")) spec.design = SWEEP_GRID;
+      else if (!strcmp(arg, "lhs")) spec.design = SWEEP_LHS;
+      else if (!strcmp(arg, "list")) spec.design = SWEEP_LIST;
+      else if (!strcmp(arg, "opt")) spec.design = SWEEP_OPT;
+      else ok = false;
+    } else if (!strcmp(key, "trial") && k == 2) {
+      gait_params g;
+      ok = sscanf(arg, "%f %f %f %f", &g.freq, &g.amp, &g.lag, &g.off) == 4;
+      spec.trials.push_back(g);
+    } else if (!strcmp(key, "samples") && k == 2) {
+      spec.samples = atoi(arg);
+    } else if (!strcmp(key, "repeat") && k == 2) {
+      spec.repeat = atoi(arg);
+    } else if (!strcmp(key, "seed") && k == 2) {
+      spec.seed = strtoull(arg, NULL, 10);
+    } else if (!strcmp(key, "shuffle") && k == 1) {
+      spec.shuffle = true;
+    } else if (!strcmp(key, "duration") && k == 2) {
+      spec.duration = atof(arg);
+    } else if (!strcmp(key, "settle") && k == 2) {
+      spec.settle = atof(arg);
+    } else if (!strcmp(key, "start") && k == 2) {
+      double deg;
+      ok = spec.has_start = sscanf(arg, "%lf %lf %lf", &spec.start_x, &spec.start_y, &deg) == 3;
+      spec.start_heading = deg * M_PI / 180;
+    } else if (!strcmp(key, "return_timeout") && k == 2) {
+      spec.return_timeout = atof(arg);
+    } else {
+      ok = false;
+    }
+    if (!ok) fprintf(stderr, "%s:%d: invalid line.\n", filename, n);
+  }
+  fclose(f);
+  if (!ok) return false;
+
+  if (spec.design == SWEEP_LIST) {
+    if (spec.trials.empty()) {
+      fprintf(stderr, "%s: no trial in the list.\n", filename);
+      return false;
+    }
+    return true;
+  }
+
+  for (int i(0); i < 4; i++) {
+    if (ranges[i].size() != 1 || !parse_values(ranges[i][0].c_str(), spec.design, spec.values[i])) {
+      fprintf(stderr, "%s: missing or invalid values for %s.\n", filename, PARAM_NAMES[i]);
+      return false;
+    }
+  }
+  if ((spec.design == SWEEP_LHS || spec.design == SWEEP_OPT) && spec.samples == 0) {
+    fprintf(stderr, "%s: the number of samples is required for lhs and opt.\n", filename);
+    return false;
+  }
+  return true;
+}
+
+// Accesses the parameters of a trial by index (same order as PARAM_NAMES)
+static float& param(gait_params& g, int i)
+{
+  switch (i) {
+    case 0: return g.freq;
+    case 1: return g.amp;
+    case 2: return g.lag;
+    default: return g.off;
+  }
+}
+
+void plan_sweep(const sweep_spec& spec, vector<gait_params>& trials)
+{
+  mt19937_64 rng(spec.seed);
+  vector<gait_params> points;
+
+  if (spec.design == SWEEP_LIST) {
+    points = spec.trials;
+  } else if (spec.design == SWEEP_OPT) {
+    // the trials are chosen on line by the optimizer
+  } else if (spec.design == SWEEP_GRID) {
+    // odometer over the values, the offset varying fastest
+    size_t total(1);
+    for (int i(0); i < 4; i++) total *= spec.values[i].size();
+    for (size_t k(0); k < total; k++) {
+      gait_params g;
+      size_t r = k;
+      for (int i(3); i >= 0; i--) {
+        const vector<float>& v = spec.values[i];
+        param(g, i) = v[r % v.size()];
+        r /= v.size();
+      }
+      points.push_back(g);
+    }
+  } else {
+    // each range is cut into as many strata as samples, and each stratum is
+    // used exactly once per parameter, in a random order
+    unsigned int n = spec.samples;
+    uniform_real_distribution<double> u(0.0, 1.0);
+    points.resize(n);
+    for (int i(0); i < 4; i++) {
+      const vector<float>& v = spec.values[i];
+      vector<unsigned int> perm(n);
+      for (unsigned int k(0); k < n; k++) perm[k] = k;
+      shuffle(perm.begin(), perm.end(), rng);
+      for (unsigned int k(0); k < n; k++) {
+        float lo = v.front(), hi = v.back();
+        param(points[k], i) = lo + (hi - lo) * (perm[k] + u(rng)) / n;
+      }
+    }
+  }
+
+  trials.clear();
+  for (unsigned int r(0); r < spec.repeat; r++) {
+    trials.insert(trials.end(), points.begin(), points.end());
+  }
+  if (spec.shuffle) shuffle(trials.begin(), trials.end(), rng);
+}
+
+// FNV-1a hash of the trial list
+static uint64_t fingerprint(const vector<gait_params>& trials)
+{
+  uint64_t h = 14695981039346656037ULL;
+  const uint8_t* p = (const uint8_t*) trials.data();
+  for (size_t i(0); i < trials.size() * sizeof(gait_params); i++) {
+    h = (h ^ p[i]) * 1099511628211ULL;
+  }
+  return h;
+}
+
+CSweepProgress::CSweepProgress() : f(NULL), count(0)
+{
+}
+
+CSweepProgress::~CSweepProgress()
+{
+  close();
+}
+
+bool CSweepProgress::open(const char* filename, const vector<gait_params>& trials,
+                          bool read_only)
+{
+  close();
+  done.assign(trials.size(), false);
+  count = 0;
+
+  char header[64];
+  snprintf(header, sizeof(header), "sweep %u %016llx", (unsigned int) trials.size(),
+           (unsigned long long) fingerprint(trials));
+
+  bool cut(false);
+  FILE* in = fopen(filename, "r");
+  if (in) {
+    char line[512];
+    if (fgets(line, sizeof(line), in) && strncmp(line, header, strlen(header)) != 0) {
+      fprintf(stderr, "%s: progress of another sweep.\n", filename);
+      fclose(in);
+      return false;
+    }
+    while (fgets(line, sizeof(line), in)) {
+      // a line cut by a crash has no newline and is ignored
+      unsigned int i;
+      int k(0);
+      cut = !strchr(line, '\n');
+      if (cut || sscanf(line, "done %u%n", &i, &k) != 1 || line[k] != ' ') continue;
+      if (i < done.size() && !done[i]) {
+        done[i] = true;
+        count++;
+      }
+    }
+    fclose(in);
+  }
+  if (read_only) return true;
+
+  f = fopen(filename, "a");
+  if (!f) {
+    perror(filename);
+    return false;
+  }
+  // the position after opening in append mode is not the end on all systems
+  fseek(f, 0, SEEK_END);
+  if (ftell(f) == 0) fprintf(f, "%s\n", header);
+  // terminates a cut line so that it cannot be mistaken for a valid one
+  else if (cut) fprintf(f, "!\n");
+  return fflush(f) == 0;
+}
+
+void CSweepProgress::close()
+{
+  if (f) fclose(f);
+  f = NULL;
+}
+
+bool CSweepProgress::mark_done(size_t trial, const string& log)
+{
+  if (!f || trial >= done.size()) return false;
+  fprintf(f, "done %u %s\n", (unsigned int) trial, log.c_str());
+  if (fflush(f) != 0) return false;
+  if (!done[trial]) {
+    done[trial] = true;
+    count++;
+  }
+  return true;
+}
@@ -0,0 +1,111 @@
+#ifndef __SWEEP_H
+#define __SWEEP_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "gait.h"
+
+/// How the trials of a sweep are chosen
+enum sweep_design {
+  SWEEP_GRID,   ///< all the combinations of the listed values
+  SWEEP_LHS,    ///< Latin hypercube sampling of the parameter ranges
+  SWEEP_LIST,   ///< explicit list of trials
+  SWEEP_OPT     ///< ranges searched by the optimizer (see CGaitOptimizer)
+};
+
+/** \brief Specification of a parameter sweep, as read from a text file, e.g.
+  *
+  *   design grid        # grid, lhs, list or opt
+  *   freq 0.8           # fixed value
+  *   amp 20,40,60       # list of values
+  *   lag 0.5:1.5:11     # min:max:count, evenly spaced (lhs, opt: min:max)
+  *   off 0
+  *   samples 50         # number of trials (lhs, opt)
+  *   trial 0.8 40 0.75 0  # one trial: freq amp lag off (list only)
+  *   repeat 2           # number of runs of each trial
+  *   shuffle            # randomizes the order of the trials
+  *   seed 1             # seed of lhs and shuffle
+  *   duration 10        # swimming time of each trial [s]
+  *   settle 5           # time in ready mode before each trial [s]
+  *   start 0.8 1.0 0    # pose to return to after each trial: x y [m] heading [deg]
+  *   return_timeout 60  # longest time to return to the start pose [s]
+  */
+struct sweep_spec {
+  sweep_design design;
+  std::vector<float> values[4];     ///< values (grid) or range (lhs) of freq, amp, lag, off
+  std::vector<gait_params> trials;  ///< trials of a list design
+  unsigned int samples;
+  unsigned int repeat;
+  bool shuffle;
+  uint64_t seed;
+  float duration;
+  float settle;
+  bool has_start;                   ///< the robot returns to the start pose between trials
+  double start_x, start_y;          ///< start position [m]
+  double start_heading;             ///< start heading [rad]
+  float return_timeout;
+
+  sweep_spec();
+};
+
+/** \brief Reads a sweep specification
+  * \return true on success, false if the file cannot be read or is invalid
+  *   (the error is printed on stderr)
+  */
+bool load_sweep_spec(const char* filename, sweep_spec& spec);
+
+/** \brief Expands a specification into the ordered list of trials, which is
+  *   the same for each call with the same specification
+  */
+void plan_sweep(const sweep_spec& spec, std::vector<gait_params>& trials);
+
+/** \brief Record of the completed trials of a sweep, appended after each trial
+  *   so that an interrupted sweep can be resumed where it stopped. The file
+  *   starts with a fingerprint of the trial list, so that the progress of
+  *   another sweep is not applied by mistake.
+  */
+class CSweepProgress {
+
+public:
+
+  CSweepProgress();
+  ~CSweepProgress();
+
+  /** \brief Opens the progress file of a sweep, creating it if needed
+    * \param filename The progress file
+    * \param trials The trials of the sweep (see plan_sweep())
+    * \param read_only true to only read the completed trials: the file is
+    *   neither created nor written, and mark_done() fails
+    * \return true on success, false if the file cannot be opened or belongs
+    *   to another sweep
+    */
+  bool open(const char* filename, const std::vector<gait_params>& trials,
+            bool read_only = false);
+
+  /// Closes the file
+  void close();
+
+  /// true if a trial has been completed
+  bool is_done(size_t trial) const { return trial < done.size() && done[trial]; }
+
+  /// Number of completed trials
+  size_t completed() const { return count; }
+
+  /** \brief Marks a trial as completed
+    * \param trial Index of the trial
+    * \param log Name of the log of the trial
+    * \return true on success, false on write error
+    */
+  bool mark_done(size_t trial, const std::string& log);
+
+private:
+
+  FILE* f;
+  std::vector<bool> done;
+  size_t count;
+
+};
+
+#endif
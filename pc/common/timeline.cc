@@ -0,0 +1,284 @@
+/*
+ * timeline.cc -- time-ordered record of the commands, register reads and tracking frames
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "timeline.h"
+
+using namespace std;
+using namespace std::chrono;
+
+static const char TIMELINE_MAGIC[4] = { 'T', 'L', 'I', 'N' };
+static const uint32_t TIMELINE_VERSION = 2;
+
+/// File header of a saved timeline, followed by the events
+struct timeline_header {
+  char magic[4];
+  uint32_t version;
+  int64_t epoch;       ///< wall clock time of the start [ms since epoch]
+  uint32_t count;      ///< number of events
+} __attribute__((__packed__));
+
+static const char* KIND_NAMES[] = { "write", "read", "frame", "mark" };
+
+CTimeline::CTimeline()
+{
+  clear();
+}
+
+void CTimeline::clear()
+{
+  lock_guard<std::mutex> lock(guard);
+  events.clear();
+  t0 = steady_clock::now();
+  epoch = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+int64_t CTimeline::now() const
+{
+  return duration_cast<microseconds>(steady_clock::now() - t0).count();
+}
+
+timeline_event& CTimeline::append(timeline_kind kind)
+{
+  // the time is taken with the lock held, so that the events stay sorted
+  timeline_event e;
+  memset(&e, 0, sizeof(e));
+  e.t = e.t_done = now();
+  e.kind = kind;
+  events.push_back(e);
+  return events.back();
+}
+
+void CTimeline::add_frame(uint32_t frame_time, bool detected, double x, double y)
+{
+  lock_guard<std::mutex> lock(guard);
+  timeline_event& e = append(TL_FRAME);
+  e.ok = detected;
+  e.value = frame_time;
+  e.x = x;
+  e.y = y;
+}
+
+void CTimeline::add_mark(uint32_t code)
+{
+  lock_guard<std::mutex> lock(guard);
+  timeline_event& e = append(TL_MARK);
+  e.ok = 1;
+  e.value = code;
+}
+
+void CTimeline::reg_op_done(uint8_t op, uint16_t addr, const uint8_t* data, uint8_t len, bool result,
+                            steady_clock::time_point t_sent, steady_clock::time_point t_done)
+{
+  // the length byte of multibyte writes is not part of the value
+  uint32_t v(0);
+  for (int i(0); data && i < len && i < 4; i++) v |= (uint32_t) data[i] << (8 * i);
+
+  timeline_event e;
+  memset(&e, 0, sizeof(e));
+  e.kind = op >= 4 ? TL_REG_WRITE : TL_REG_READ;
+  e.ok = result;
+  e.addr = addr;
+  e.value = v;
+
+  // the operation is stamped when it was sent, the frames received while
+  // waiting for the answer may thus come after it
+  lock_guard<std::mutex> lock(guard);
+  e.t = duration_cast<microseconds>(t_sent - t0).count();
+  e.t_done = duration_cast<microseconds>(t_done - t0).count();
+  size_t i(events.size());
+  while (i > 0 && events[i - 1].t > e.t) i--;
+  events.insert(events.begin() + i, e);
+}
+
+size_t CTimeline::lower_bound(int64_t t) const
+{
+  lock_guard<std::mutex> lock(guard);
+  size_t lo(0), hi(events.size());
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (events[mid].t < t) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+size_t CTimeline::find_next(size_t from, timeline_kind kind, int addr) const
+{
+  lock_guard<std::mutex> lock(guard);
+  bool reg = (kind == TL_REG_WRITE || kind == TL_REG_READ) && addr >= 0;
+  for (size_t i(from); i < events.size(); i++) {
+    if (events[i].kind == kind && (!reg || events[i].addr == addr)) return i;
+  }
+  return events.size();
+}
+
+// Path length over elapsed time of the detected frames in [t1, t2], the
+// events being sorted by time (lock held by the caller)
+static double frames_speed(const vector<timeline_event>& ev, int64_t t1, int64_t t2)
+{
+  const timeline_event* first = NULL;
+  const timeline_event* prev = NULL;
+  double path(0);
+
+  vector<timeline_event>::const_iterator it = lower_bound(ev.begin(), ev.end(), t1,
+    [](const timeline_event& e, int64_t t) { return e.t < t; });
+  for (; it != ev.end() && it->t <= t2; ++it) {
+    if (it->kind != TL_FRAME || !it->ok) continue;
+    if (prev) path += hypot(it->x - prev->x, it->y - prev->y);
+    else first = &*it;
+    prev = &*it;
+  }
+
+  if (!first || prev->t == first->t) return NAN;
+  return path / ((prev->t - first->t) / 1e6);
+}
+
+double CTimeline::speed(int64_t t1, int64_t t2) const
+{
+  lock_guard<std::mutex> lock(guard);
+  return frames_speed(events, t1, t2);
+}
+
+void CTimeline::command_effects(uint16_t addr, const effect_query& q,
+                                vector<command_effect>& out) const
+{
+  lock_guard<std::mutex> lock(guard);
+  uint32_t last(0);
+  bool known(false);
+
+  out.clear();
+  for (size_t i(0); i < events.size(); i++) {
+    const timeline_event& e = events[i];
+    if ((e.kind != TL_REG_WRITE && e.kind != TL_REG_READ) || e.addr != addr || !e.ok) continue;
+    if (e.kind == TL_REG_READ) {
+      last = e.value;
+      known = true;
+      continue;
+    }
+
+    command_effect c;
+    c.index = i;
+    c.t = e.t;
+    c.old_value = known ? last : e.value;
+    c.new_value = e.value;
+    c.speed_before = frames_speed(events, e.t - q.before, e.t);
+    c.speed_after = frames_speed(events, e.t, e.t + q.after);
+    c.latency = -1;
+
+    // slides a window over the frames following the command, the response
+    // time is the middle of the first window whose speed departs from the
+    // reference level
+    if (!std::isnan(c.speed_before)) {
+      for (size_t j(i + 1); j < events.size() && events[j].t <= e.t + q.after; j++) {
+        const timeline_event& f = events[j];
+        if (f.kind != TL_FRAME || !f.ok || f.t < e.t + q.window) continue;
+        double v = frames_speed(events, f.t - q.window, f.t);
+        if (!std::isnan(v) && fabs(v - c.speed_before) > q.threshold) {
+          c.latency = f.t - q.window / 2 - e.t;
+          break;
+        }
+      }
+    }
+
+    out.push_back(c);
+    last = e.value;
+    known = true;
+  }
+}
+
+bool CTimeline::save(const char* filename) const
+{
+  lock_guard<std::mutex> lock(guard);
+
+  timeline_header h;
+  memcpy(h.magic, TIMELINE_MAGIC, 4);
+  h.version = TIMELINE_VERSION;
+  h.epoch = epoch;
+  h.count = events.size();
+
+  string tmp = string(filename) + ".tmp";
+  FILE* f = fopen(tmp.c_str(), "wb");
+  if (!f) {
+    perror(tmp.c_str());
+    return false;
+  }
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+  if (ok && !events.empty()) ok = fwrite(&events[0], sizeof(timeline_event), events.size(), f) == events.size();
+  if (fclose(f) != 0) ok = false;
+  if (!ok) {
+    fprintf(stderr, "Error while writing %s.\n", tmp.c_str());
+    remove(tmp.c_str());
+    return false;
+  }
+
+  // rename() does not replace an existing file on Windows
+  remove(filename);
+  if (rename(tmp.c_str(), filename) != 0) {
+    perror(filename);
+    return false;
+  }
+  return true;
+}
+
+bool CTimeline::load(const char* filename)
+{
+  FILE* f = fopen(filename, "rb");
+  if (!f) {
+    perror(filename);
+    return false;
+  }
+
+  timeline_header h;
+  if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, TIMELINE_MAGIC, 4) != 0 ||
+      h.version != TIMELINE_VERSION) {
+    fprintf(stderr, "%s: not a timeline file.\n", filename);
+    fclose(f);
+    return false;
+  }
+
+  vector<timeline_event> ev(h.count);
+  bool ok = h.count == 0 || fread(&ev[0], sizeof(timeline_event), h.count, f) == h.count;
+  fclose(f);
+  if (!ok) {
+    fprintf(stderr, "%s: truncated timeline.\n", filename);
+    return false;
+  }
+
+  lock_guard<std::mutex> lock(guard);
+  events.swap(ev);
+  epoch = h.epoch;
+  return true;
+}
+
+bool CTimeline::write_csv(const char* filename) const
+{
+  FILE* f = fopen(filename, "w");
+  if (!f) {
+    perror(filename);
+    return false;
+  }
+
+  lock_guard<std::mutex> lock(guard);
+  fprintf(f, "Time,Kind,Addr,Value,OK,X,Y,Done\n");
+  for (size_t i(0); i < events.size(); i++) {
+    const timeline_event& e = events[i];
+    fprintf(f, "%lld,%s,%u,%u,%u", (long long) e.t, KIND_NAMES[e.kind & 3], e.addr, e.value, e.ok);
+    if (e.kind == TL_FRAME && e.ok) {
+      fprintf(f, ",%.3f,%.3f", e.x, e.y);
+    } else {
+      fprintf(f, ",,");
+    }
+    if (e.kind == TL_REG_WRITE || e.kind == TL_REG_READ) {
+      fprintf(f, ",%lld\n", (long long) e.t_done);
+    } else {
+      fprintf(f, ",\n");
+    }
+  }
+
+  return fclose(f) == 0;
+}
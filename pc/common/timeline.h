@@ -0,0 +1,145 @@
+#ifndef __TIMELINE_H
+#define __TIMELINE_H
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include "regobs.h"
+
+/// Kinds of timeline events
+enum timeline_kind {
+  TL_REG_WRITE = 0,   ///< register write sent to the robot (a command)
+  TL_REG_READ = 1,    ///< register read and its result
+  TL_FRAME = 2,       ///< tracking frame
+  TL_MARK = 3         ///< user defined marker
+};
+
+/// One event of a timeline
+struct timeline_event {
+  int64_t t;          ///< monotonic time since the start of the timeline [us], send time of register operations
+  int64_t t_done;     ///< completion time of a register operation [us] (t for frames and markers)
+  uint8_t kind;       ///< see timeline_kind
+  uint8_t ok;         ///< operation succeeded / spot detected
+  uint16_t addr;      ///< register address (0 for frames and markers)
+  uint32_t value;     ///< register value (first 4 bytes for multibyte), frame time or mark code
+  float x;            ///< spot position along the tank [m] (frames only)
+  float y;            ///< spot position across the tank [m] (frames only)
+} __attribute__((__packed__));
+
+/// Effect of a command on the motion of the robot (see CTimeline::command_effects())
+struct command_effect {
+  size_t index;         ///< index of the command in the timeline
+  int64_t t;            ///< time of the command [us]
+  uint32_t old_value;   ///< last known value of the register before the command
+  uint32_t new_value;   ///< written value
+  double speed_before;  ///< mean speed in the window before the command [m/s]
+  double speed_after;   ///< mean speed in the window after the command [m/s]
+  int64_t latency;      ///< time until the speed left its previous level [us], -1 if it did not
+};
+
+/// Parameters of CTimeline::command_effects() (all times in us)
+struct effect_query {
+  int64_t before;       ///< length of the reference window before the command
+  int64_t after;        ///< length of the window after the command
+  int64_t window;       ///< length of the sliding window used to detect the response
+  double threshold;     ///< speed change considered as a response [m/s]
+
+  effect_query() : before(2000000), after(2000000), window(500000), threshold(0.03) {}
+};
+
+/** \brief Time-ordered record of everything that happens during a run: the
+  *   commands sent to the robot, the register reads and the tracking frames,
+  *   all stamped with the same monotonic clock. It can be attached to a
+  *   CRemoteRegs with set_observer() to record the register operations.
+  */
+class CTimeline : public CRegObserver {
+
+public:
+
+  CTimeline();
+
+  /// Removes all the events and restarts the clock
+  void clear();
+
+  /// Current time of the timeline clock [us]
+  int64_t now() const;
+
+  /// Wall clock time of the start of the timeline [ms since epoch]
+  int64_t start_epoch() const { return epoch; }
+
+  /** \brief Records a tracking frame
+    * \param frame_time Time stamp of the frame given by the tracking PC
+    * \param detected true if the spot was found, in which case x and y are its position
+    */
+  void add_frame(uint32_t frame_time, bool detected, double x = 0, double y = 0);
+
+  /// Records a user defined marker
+  void add_mark(uint32_t code);
+
+  /// Records a register operation (CRegObserver interface)
+  void reg_op_done(uint8_t op, uint16_t addr, const uint8_t* data, uint8_t len, bool result,
+                   std::chrono::steady_clock::time_point t_sent,
+                   std::chrono::steady_clock::time_point t_done);
+
+  /// Number of events
+  size_t size() const { return events.size(); }
+
+  /// Event access (the events are sorted by time)
+  const timeline_event& operator[](size_t i) const { return events[i]; }
+
+  /// Index of the first event at or after a given time
+  size_t lower_bound(int64_t t) const;
+
+  /** \brief Finds the next event of a kind
+    * \param from Index where the search starts (included)
+    * \param kind The event kind
+    * \param addr Register address (ignored if negative or for frames and markers)
+    * \return The index of the event, or size() if there is none
+    */
+  size_t find_next(size_t from, timeline_kind kind, int addr = -1) const;
+
+  /** \brief Mean speed of the spot between two times, as the path length
+    *   divided by the time between the first and last detected frames
+    * \return The speed in m/s, or NAN if there are less than two detected frames
+    */
+  double speed(int64_t t1, int64_t t2) const;
+
+  /** \brief Joins each successful write to a register with the motion of the
+    *   robot around it
+    * \param addr The address of the register
+    * \param q Windows and threshold used to measure the effect
+    * \param out Receives one entry per command, in time order
+    */
+  void command_effects(uint16_t addr, const effect_query& q,
+                       std::vector<command_effect>& out) const;
+
+  /** \brief Saves the timeline to a binary file
+    * \return true on success, false if the file cannot be written
+    */
+  bool save(const char* filename) const;
+
+  /** \brief Loads a timeline saved with save()
+    * \return true on success, false if the file cannot be read
+    */
+  bool load(const char* filename);
+
+  /** \brief Writes the events as CSV (Time,Kind,Addr,Value,OK,X,Y,Done)
+    * \return true on success, false if the file cannot be written
+    */
+  bool write_csv(const char* filename) const;
+
+private:
+
+  /// Appends an event stamped with the current time (lock held by the caller)
+  timeline_event& append(timeline_kind kind);
+
+  std::chrono::steady_clock::time_point t0;
+  int64_t epoch;
+  std::vector<timeline_event> events;
+  /// protects the events, as the register operations may come from several threads
+  mutable std::mutex guard;
+
+};
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * timing.cc -- statistics and histograms of loop periods and processing times
+ */
+
+#include <cmath>
+#include "timing.h"
+
+void CTimingStats::clear()
+{
+  n = 0;
+  sum = sum2 = lo = hi = 0;
+}
+
+void CTimingStats::add(double us)
+{
+  if (n == 0 || us < lo) lo = us;
+  if (n == 0 || us > hi) hi = us;
+  n++;
+  sum += us;
+  sum2 += us * us;
+}
+
+double CTimingStats::std_dev() const
+{
+  if (n < 2) return 0;
+  double v = (sum2 - sum * sum / n) / (n - 1);
+  return v > 0 ? sqrt(v) : 0;
+}
+
+void CTimingStats::print(const char* name, FILE* f) const
+{
+  fprintf(f, "%s: %llu, mean %.3f ms, std %.3f ms, min %.3f ms, max %.3f ms\n", name,
+          (unsigned long long) n, mean() / 1000, std_dev() / 1000, min() / 1000, max() / 1000);
+}
+
+CTimingHistogram::CTimingHistogram(double bin_width, size_t bins)
+  : width(bin_width), counts(bins > 0 ? bins : 1)
+{
+  clear();
+}
+
+void CTimingHistogram::clear()
+{
+  for (size_t i(0); i < counts.size(); i++) counts[i] = 0;
+  n = 0;
+}
+
+void CTimingHistogram::add(double us)
+{
+  size_t i = us > 0 ? (size_t) (us / width) : 0;
+  if (i >= counts.size()) i = counts.size() - 1;
+  counts[i]++;
+  n++;
+}
+
+double CTimingHistogram::percentile(double q) const
+{
+  uint64_t k(0);
+  for (size_t i(0); i < counts.size(); i++) {
+    k += counts[i];
+    if (k > 0 && k >= q * n) return (i + 1) * width;
+  }
+  return counts.size() * width;
+}
+
+void CTimingHistogram::print(const char* name, FILE* f) const
+{
+  fprintf(f, "%s: %llu, 50%% < %.3f ms, 99%% < %.3f ms, 99.9%% < %.3f ms\n", name,
+          (unsigned long long) n, percentile(0.5) / 1000, percentile(0.99) / 1000,
+          percentile(0.999) / 1000);
+  // groups the bins by powers of two (1, 1, 2, 4, 8... bins), to keep the tail readable
+  for (size_t lo(0), hi(1); lo < counts.size(); lo = hi, hi *= 2) {
+    uint64_t k(0);
+    for (size_t i(lo); i < hi && i < counts.size(); i++) k += counts[i];
+    if (k == 0) continue;
+    if (hi < counts.size()) {
+      fprintf(f, "  %8.3f - %8.3f ms: %llu\n", lo * width / 1000, hi * width / 1000, (unsigned long long) k);
+    } else {
+      fprintf(f, "  %8.3f ms and more: %llu\n", lo * width / 1000, (unsigned long long) k);
+    }
+  }
+}
@@ -0,0 +1,78 @@
+#ifndef __TIMING_H
+#define __TIMING_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <vector>
+
+/// Running statistics of a duration (loop period, processing time, ...)
+class CTimingStats {
+
+public:
+
+  CTimingStats() { clear(); }
+
+  /// Clears the statistics
+  void clear();
+
+  /// Adds a measurement [us]
+  void add(double us);
+
+  /// Number of measurements
+  uint64_t count() const { return n; }
+  /// Mean [us] (0 if no measurement)
+  double mean() const { return n > 0 ? sum / n : 0; }
+  /// Standard deviation [us]
+  double std_dev() const;
+  /// Smallest measurement [us]
+  double min() const { return n > 0 ? lo : 0; }
+  /// Largest measurement [us]
+  double max() const { return n > 0 ? hi : 0; }
+
+  /// Prints a one-line summary, in ms
+  void print(const char* name, FILE* f = stdout) const;
+
+private:
+
+  uint64_t n;
+  double sum, sum2, lo, hi;
+
+};
+
+/** \brief Histogram of durations with bins of equal width, for the shape of
+  *   the distribution (jitter tails) that the mean and deviation hide
+  */
+class CTimingHistogram {
+
+public:
+
+  /** \brief Constructor
+    * \param bin_width Width of a bin [us]
+    * \param bins Number of bins, the last one also counts the larger durations
+    */
+  CTimingHistogram(double bin_width = 10, size_t bins = 100);
+
+  /// Clears the counts
+  void clear();
+
+  /// Adds a measurement [us] (negative ones go to the first bin)
+  void add(double us);
+
+  /// Number of measurements
+  uint64_t count() const { return n; }
+
+  /// Duration below which a fraction q of the measurements are [us], at the bin resolution
+  double percentile(double q) const;
+
+  /// Prints the counts in ranges doubling in width, in ms
+  void print(const char* name, FILE* f = stdout) const;
+
+private:
+
+  double width;
+  std::vector<uint64_t> counts;
+  uint64_t n;
+
+};
+
+#endif
@@ -139,9 +139,14 @@ bool CTrackingClient::stop_tracking_file()
 }
   
 bool CTrackingClient::update(uint32_t& time)
+{
+  return request() && receive(time);
+}
+
+bool CTrackingClient::request()
 {
   if (!connected) return false;
-  
+
   char c('U');
   if (send(sock, &c, 1, 0)!=1) {
     perror("send");
@@ -149,7 +154,15 @@ bool CTrackingClient::update(uint32_t& time)
     connected = false;
     return false;
   }
-  if (recv(sock, (char*) &time, 4, 0)!=4) {
+  return true;
+}
+
+bool CTrackingClient::receive(uint32_t& time)
+{
+  if (!connected) return false;
+
+  char c;
+  if (block_recv(sock, (uint8_t*) &time, 4)!=4) {
     perror("recv");
     closesocket(sock);
     connected = false;
@@ -24,6 +24,13 @@ public:
   bool stop_tracking_file(void);
   
   bool update(uint32_t& time);
+
+  /// Asks the server for the current frame (first half of update())
+  bool request();
+  /// Reads the answer to request(), once the socket is readable (second half of update())
+  bool receive(uint32_t& time);
+  /// Socket connected to the server, -1 if not connected
+  int get_socket() const { return connected ? sock : -1; }
   bool get_pos(const int id, double& x, double& y);
   int get_first_id();
   const track_point* get_pos_table(int& count) const;
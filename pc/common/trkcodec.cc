@@ -0,0 +1,434 @@
+/*
+ * trkcodec.cc -- delta/varint encoding of tracking logs (see trkcodec.h)
+ */
+
+#include <cmath>
+#include <cstring>
+#include "trkcodec.h"
+
+using namespace std;
+
+static const uint8_t STREAM_MAGIC[3] = { 'T', 'R', 'K' };
+static const uint8_t STREAM_VERSION = 1;
+static const uint8_t FOOTER_MAGIC[4] = { 'T', 'R', 'K', 'I' };
+static const size_t HEADER_SIZE = 4;
+static const size_t FOOTER_SIZE = 12;
+
+/// Record kinds, stored in the LSB of the first varint of each record
+enum { REC_SAMPLE = 0, REC_EVENT = 1 };
+
+/// Records per block when writing files, a killed logger loses at most this many
+static const unsigned int FILE_BLOCK_RECORDS = 64;
+
+static inline uint64_t zigzag(int64_t v)
+{
+  return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+  return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+static inline void put_varint(vector<uint8_t>& out, uint64_t v)
+{
+  while (v >= 0x80) {
+    out.push_back((uint8_t) (v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((uint8_t) v);
+}
+
+/// Reads a varint, returns false if the buffer ends before it does
+static inline bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+{
+  v = 0;
+  for (int shift(0); p < end && shift < 64; shift += 7) {
+    uint8_t b = *p++;
+    v |= (uint64_t) (b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+static inline int32_t quantize(float v)
+{
+  return (int32_t) lround(v * TRK_UNITS_PER_M);
+}
+
+// Decodes the payload of a block (everything after its length)
+static bool decode_records(const uint8_t* p, const uint8_t* end, vector<track_sample>& samples,
+                           vector<track_event>* events)
+{
+  uint64_t count, u, a, b;
+
+  if (!get_varint(p, end, count) || !get_varint(p, end, u)) return false;
+  int64_t t = unzigzag(u);
+  int32_t x(0), y(0);
+
+  for (uint64_t i(0); i < count; i++) {
+    if (!get_varint(p, end, u)) return false;
+    t += unzigzag(u >> 1);
+    if ((u & 1) == REC_SAMPLE) {
+      if (!get_varint(p, end, a) || !get_varint(p, end, b)) return false;
+      x += unzigzag(a);
+      y += unzigzag(b);
+      track_sample s;
+      s.t = t;
+      s.x = x / TRK_UNITS_PER_M;
+      s.y = y / TRK_UNITS_PER_M;
+      samples.push_back(s);
+    } else {
+      if (!get_varint(p, end, a)) return false;
+      if (events) {
+        track_event e;
+        e.t = t;
+        e.code = a;
+        events->push_back(e);
+      }
+    }
+  }
+  return p == end;
+}
+
+CTrackEncoder::CTrackEncoder(unsigned int block_records)
+  : block_records(block_records ? block_records : 1), block_count(0), t_base(0), t_prev(0),
+    x_prev(0), y_prev(0), produced(0), header_done(false)
+{
+}
+
+void CTrackEncoder::begin_record(int64_t t, int kind)
+{
+  if (block_count == 0) {
+    t_base = t_prev = t;
+    x_prev = y_prev = 0;
+  }
+  put_varint(block, (zigzag(t - t_prev) << 1) | kind);
+  t_prev = t;
+  block_count++;
+}
+
+void CTrackEncoder::add(const track_sample& s)
+{
+  int32_t x = quantize(s.x);
+  int32_t y = quantize(s.y);
+
+  begin_record(s.t, REC_SAMPLE);
+  put_varint(block, zigzag(x - x_prev));
+  put_varint(block, zigzag(y - y_prev));
+  x_prev = x;
+  y_prev = y;
+
+  if (block_count >= block_records) flush();
+}
+
+void CTrackEncoder::add_event(int64_t t, uint32_t code)
+{
+  begin_record(t, REC_EVENT);
+  put_varint(block, code);
+
+  if (block_count >= block_records) flush();
+}
+
+void CTrackEncoder::flush()
+{
+  if (!header_done) {
+    out.insert(out.end(), STREAM_MAGIC, STREAM_MAGIC + 3);
+    out.push_back(STREAM_VERSION);
+    header_done = true;
+  }
+  if (block_count == 0) return;
+
+  track_block tb;
+  tb.offset = stream_size();
+  tb.t_first = t_base;
+  tb.count = block_count;
+  index.push_back(tb);
+
+  vector<uint8_t> head;
+  put_varint(head, block_count);
+  put_varint(head, zigzag(t_base));
+
+  out.push_back('B');
+  put_varint(out, head.size() + block.size());
+  out.insert(out.end(), head.begin(), head.end());
+  out.insert(out.end(), block.begin(), block.end());
+
+  block.clear();
+  block_count = 0;
+}
+
+void CTrackEncoder::finish()
+{
+  flush();
+
+  uint64_t index_offset = stream_size();
+  uint64_t prev_offset(0);
+  int64_t prev_t(0);
+
+  out.push_back('I');
+  put_varint(out, index.size());
+  for (size_t i(0); i < index.size(); i++) {
+    put_varint(out, index[i].offset - prev_offset);
+    put_varint(out, zigzag(index[i].t_first - prev_t));
+    put_varint(out, index[i].count);
+    prev_offset = index[i].offset;
+    prev_t = index[i].t_first;
+  }
+  for (int i(0); i < 8; i++) out.push_back((uint8_t) (index_offset >> (8 * i)));
+  out.insert(out.end(), FOOTER_MAGIC, FOOTER_MAGIC + 4);
+}
+
+void CTrackEncoder::drain(vector<uint8_t>& dest)
+{
+  produced += out.size();
+  dest.swap(out);
+  out.clear();
+}
+
+CTrackDecoder::CTrackDecoder() : header_done(false), ended(false)
+{
+}
+
+bool CTrackDecoder::feed(const uint8_t* data, size_t len, vector<track_sample>& samples,
+                         vector<track_event>* events)
+{
+  if (ended) return true;
+  buf.insert(buf.end(), data, data + len);
+
+  const uint8_t* p = buf.data();
+  const uint8_t* end = p + buf.size();
+
+  if (!header_done) {
+    if (buf.size() < HEADER_SIZE) return true;
+    if (memcmp(p, STREAM_MAGIC, 3) != 0 || p[3] != STREAM_VERSION) return false;
+    p += HEADER_SIZE;
+    header_done = true;
+  }
+
+  while (p < end) {
+    if (*p == 'I') {
+      // the index and footer are only useful for seeking in files
+      ended = true;
+      break;
+    }
+    if (*p != 'B') return false;
+    const uint8_t* q = p + 1;
+    uint64_t size;
+    if (!get_varint(q, end, size)) break;   // incomplete block header
+    if ((uint64_t) (end - q) < size) break;  // incomplete block
+    if (!decode_records(q, q + size, samples, events)) return false;
+    p = q + size;
+  }
+
+  buf.erase(buf.begin(), buf.begin() + (p - buf.data()));
+  return true;
+}
+
+CTrackWriter::CTrackWriter() : enc(FILE_BLOCK_RECORDS), f(NULL)
+{
+}
+
+CTrackWriter::~CTrackWriter()
+{
+  if (f) close();
+}
+
+bool CTrackWriter::open(const char* filename)
+{
+  if (f) return false;
+  f = fopen(filename, "wb");
+  if (!f) {
+    perror(filename);
+    return false;
+  }
+  enc = CTrackEncoder(FILE_BLOCK_RECORDS);
+  enc.flush();   // writes the header
+  return write_pending();
+}
+
+bool CTrackWriter::write_pending()
+{
+  if (enc.pending() == 0) return true;
+  vector<uint8_t> data;
+  enc.drain(data);
+  if (fwrite(&data[0], 1, data.size(), f) != data.size()) return false;
+  return fflush(f) == 0;
+}
+
+bool CTrackWriter::add(const track_sample& s)
+{
+  if (!f) return false;
+  enc.add(s);
+  return write_pending();
+}
+
+bool CTrackWriter::add_event(int64_t t, uint32_t code)
+{
+  if (!f) return false;
+  enc.add_event(t, code);
+  enc.flush();
+  return write_pending();
+}
+
+bool CTrackWriter::close()
+{
+  if (!f) return false;
+  enc.finish();
+  bool ok = write_pending();
+  if (fclose(f) != 0) ok = false;
+  f = NULL;
+  return ok;
+}
+
+CTrackReader::CTrackReader() : f(NULL), data_end(0)
+{
+}
+
+CTrackReader::~CTrackReader()
+{
+  close();
+}
+
+void CTrackReader::close()
+{
+  if (f) fclose(f);
+  f = NULL;
+  index.clear();
+}
+
+bool CTrackReader::open(const char* filename)
+{
+  close();
+  f = fopen(filename, "rb");
+  if (!f) return false;
+
+  uint8_t h[HEADER_SIZE];
+  if (fread(h, 1, HEADER_SIZE, f) != HEADER_SIZE || memcmp(h, STREAM_MAGIC, 3) != 0 ||
+      h[3] != STREAM_VERSION) {
+    fprintf(stderr, "%s: not a tracking log.\n", filename);
+    close();
+    return false;
+  }
+
+  fseek(f, 0, SEEK_END);
+  uint64_t size = ftell(f);
+
+  // tries the index at the end of the file first
+  uint8_t foot[FOOTER_SIZE];
+  if (size >= HEADER_SIZE + FOOTER_SIZE && fseek(f, size - FOOTER_SIZE, SEEK_SET) == 0 &&
+      fread(foot, 1, FOOTER_SIZE, f) == FOOTER_SIZE && !memcmp(foot + 8, FOOTER_MAGIC, 4)) {
+    uint64_t offset(0);
+    for (int i(0); i < 8; i++) offset |= (uint64_t) foot[i] << (8 * i);
+    if (offset >= HEADER_SIZE && offset < size - FOOTER_SIZE) {
+      vector<uint8_t> data(size - FOOTER_SIZE - offset);
+      fseek(f, offset, SEEK_SET);
+      if (fread(&data[0], 1, data.size(), f) == data.size() && data[0] == 'I') {
+        const uint8_t* p = &data[1];
+        const uint8_t* end = &data[0] + data.size();
+        uint64_t n, a, b, c;
+        bool ok = get_varint(p, end, n);
+        track_block tb;
+        tb.offset = 0;
+        tb.t_first = 0;
+        for (uint64_t i(0); ok && i < n; i++) {
+          ok = get_varint(p, end, a) && get_varint(p, end, b) && get_varint(p, end, c);
+          if (!ok) break;
+          tb.offset += a;
+          tb.t_first += unzigzag(b);
+          tb.count = c;
+          index.push_back(tb);
+        }
+        if (ok) {
+          data_end = offset;
+          return true;
+        }
+        index.clear();
+      }
+    }
+  }
+
+  return rebuild_index(size);
+}
+
+bool CTrackReader::rebuild_index(uint64_t size)
+{
+  uint64_t offset = HEADER_SIZE;
+  uint8_t head[32];
+
+  index.clear();
+  while (offset < size) {
+    fseek(f, offset, SEEK_SET);
+    size_t n = fread(head, 1, sizeof(head), f);
+    if (n < 2 || head[0] != 'B') break;
+    const uint8_t* p = head + 1;
+    const uint8_t* end = head + n;
+    uint64_t len, count, t;
+    if (!get_varint(p, end, len)) break;
+    uint64_t next = offset + (p - head) + len;
+    if (next > size) break;   // truncated last block
+    if (!get_varint(p, end, count) || !get_varint(p, end, t)) break;
+    track_block tb;
+    tb.offset = offset;
+    tb.t_first = unzigzag(t);
+    tb.count = count;
+    index.push_back(tb);
+    offset = next;
+  }
+  data_end = offset;
+  return true;
+}
+
+bool CTrackReader::read_block(size_t i, vector<track_sample>& samples, vector<track_event>* events)
+{
+  uint64_t start = index[i].offset;
+  uint64_t stop = (i + 1 < index.size()) ? index[i + 1].offset : data_end;
+  if (stop <= start) return false;
+
+  vector<uint8_t> data(stop - start);
+  if (fseek(f, start, SEEK_SET) != 0 || fread(&data[0], 1, data.size(), f) != data.size()) {
+    return false;
+  }
+  const uint8_t* p = &data[1];
+  const uint8_t* end = &data[0] + data.size();
+  uint64_t len;
+  if (data[0] != 'B' || !get_varint(p, end, len) || (uint64_t) (end - p) != len) return false;
+  return decode_records(p, end, samples, events);
+}
+
+bool CTrackReader::read_range(int64_t t1, int64_t t2, vector<track_sample>& samples,
+                              vector<track_event>* events)
+{
+  if (!f) return false;
+
+  // last block starting at or before t1 (records are in time order)
+  size_t lo(0), hi(index.size());
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (index[mid].t_first <= t1) lo = mid; else hi = mid;
+  }
+
+  vector<track_sample> s;
+  vector<track_event> e;
+  for (size_t i(lo); i < index.size() && index[i].t_first <= t2; i++) {
+    s.clear();
+    e.clear();
+    if (!read_block(i, s, events ? &e : NULL)) return false;
+    for (size_t j(0); j < s.size(); j++) {
+      if (s[j].t >= t1 && s[j].t <= t2) samples.push_back(s[j]);
+    }
+    for (size_t j(0); j < e.size(); j++) {
+      if (e[j].t >= t1 && e[j].t <= t2) events->push_back(e[j]);
+    }
+  }
+  return true;
+}
+
+bool CTrackReader::read_all(vector<track_sample>& samples, vector<track_event>* events)
+{
+  if (!f) return false;
+  for (size_t i(0); i < index.size(); i++) {
+    if (!read_block(i, samples, events)) return false;
+  }
+  return true;
+}
@@ -0,0 +1,194 @@
+#ifndef __TRKCODEC_H
+#define __TRKCODEC_H
+
+/**
+ * \file   trkcodec.h
+ * \brief  Compact streaming encoding of tracking logs
+ *
+ * Samples are grouped in blocks. Inside a block, each record stores the
+ * difference with the previous one: time in ms and positions quantized to
+ * ::TRK_UNITS_PER_M, zigzag mapped and packed as varints. A typical frame
+ * then takes 3 bytes instead of ~26 in the CSV logs. Records can also be
+ * events (an integer code with a timestamp) used to annotate a run.
+ *
+ * Stream layout (the same bytes are used for files and network transfers):
+ *   header:  "TRK" version
+ *   blocks:  'B' varint(payload length) varint(record count) zigzag(t base)
+ *            records...
+ *   index:   'I' varint(block count) then per block varint(offset delta)
+ *            zigzag(first time delta) varint(record count)   (files only)
+ *   footer:  uint64 LE offset of the index, "TRKI"             (files only)
+ * A file without index (e.g. the logger was killed) can still be read
+ * sequentially, and its index is rebuilt when opened.
+ */
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "runlog.h"
+
+/// Position quantization (1 mm, the resolution of the CSV logs)
+const double TRK_UNITS_PER_M = 1000.0;
+
+/// Event attached to a run (e.g. a safety intervention)
+struct track_event {
+  int64_t t;       ///< time since epoch [ms]
+  uint32_t code;   ///< application-defined code
+};
+
+/// Location of a block in an encoded stream
+struct track_block {
+  uint64_t offset;   ///< offset of the block from the beginning of the stream
+  int64_t t_first;   ///< time of its first record [ms]
+  uint32_t count;    ///< number of records
+};
+
+/** \brief Incremental encoder. Records are accumulated into the current
+  *   block; complete blocks are appended to an output buffer that the user
+  *   drains (to a file or a socket) at will.
+  */
+class CTrackEncoder {
+
+public:
+
+  /// \param block_records Number of records after which a block is closed
+  CTrackEncoder(unsigned int block_records = 256);
+
+  /// Appends a sample
+  void add(const track_sample& s);
+
+  /// Appends an event
+  void add_event(int64_t t, uint32_t code);
+
+  /// Closes the current block (if not empty), making it available in the output
+  void flush();
+
+  /// Writes the block index, to be called once at the end of a file
+  void finish();
+
+  /// Number of encoded bytes waiting in the output buffer
+  size_t pending() const { return out.size(); }
+
+  /** \brief Moves the encoded bytes to the given buffer (replacing its contents)
+    *   and clears the output buffer
+    */
+  void drain(std::vector<uint8_t>& dest);
+
+  /// Total number of bytes produced so far (drained or not)
+  uint64_t stream_size() const { return produced + out.size(); }
+
+  /// Blocks produced so far
+  const std::vector<track_block>& blocks() const { return index; }
+
+private:
+
+  void begin_record(int64_t t, int kind);
+
+  unsigned int block_records;
+  std::vector<uint8_t> out;     ///< encoded bytes not yet drained
+  std::vector<uint8_t> block;   ///< records of the current block
+  uint32_t block_count;         ///< records in the current block
+  int64_t t_base;               ///< time of the first record of the block
+  int64_t t_prev;
+  int32_t x_prev, y_prev;
+  uint64_t produced;            ///< bytes drained so far
+  bool header_done;
+  std::vector<track_block> index;
+
+};
+
+/** \brief Incremental decoder. Bytes can be fed in arbitrary pieces (e.g. as
+  *   received from a socket), records are returned once their block is complete.
+  */
+class CTrackDecoder {
+
+public:
+
+  CTrackDecoder();
+
+  /** \brief Feeds encoded bytes
+    * \param samples Receives the decoded samples (appended)
+    * \param events If not NULL, receives the decoded events (appended)
+    * \return false if the stream is corrupted, true otherwise
+    */
+  bool feed(const uint8_t* data, size_t len, std::vector<track_sample>& samples,
+            std::vector<track_event>* events = NULL);
+
+  /// true once the index (end of a file) has been reached
+  bool at_end() const { return ended; }
+
+private:
+
+  std::vector<uint8_t> buf;
+  bool header_done;
+  bool ended;
+
+};
+
+/// Writes an encoded log file
+class CTrackWriter {
+
+public:
+
+  CTrackWriter();
+  ~CTrackWriter();
+
+  /// Creates the file, returns false on failure
+  bool open(const char* filename);
+
+  /// Appends a sample (written to disk each time a block is complete)
+  bool add(const track_sample& s);
+
+  /// Appends an event, and flushes the current block so that it reaches the disk
+  bool add_event(int64_t t, uint32_t code);
+
+  /// Writes the pending data and the block index, and closes the file
+  bool close();
+
+private:
+
+  bool write_pending();
+
+  CTrackEncoder enc;
+  FILE* f;
+
+};
+
+/// Reads an encoded log file, with seeking by time through the block index
+class CTrackReader {
+
+public:
+
+  CTrackReader();
+  ~CTrackReader();
+
+  /// Opens the file and loads (or rebuilds) its block index
+  bool open(const char* filename);
+
+  void close();
+
+  /// Block index of the file
+  const std::vector<track_block>& blocks() const { return index; }
+
+  /** \brief Reads the records with time in [t1, t2], only decoding the blocks
+    *   that may contain them
+    */
+  bool read_range(int64_t t1, int64_t t2, std::vector<track_sample>& samples,
+                  std::vector<track_event>* events = NULL);
+
+  /// Reads the whole file
+  bool read_all(std::vector<track_sample>& samples, std::vector<track_event>* events = NULL);
+
+private:
+
+  bool rebuild_index(uint64_t end);
+  bool read_block(size_t i, std::vector<track_sample>& samples, std::vector<track_event>* events);
+
+  FILE* f;
+  std::vector<track_block> index;
+  uint64_t data_end;   ///< end of the last block
+
+};
+
+#endif
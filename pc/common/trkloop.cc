@@ -0,0 +1,70 @@
+/*
+ * trkloop.cc -- tracking frames received as they become available
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include "trkloop.h"
+
+using namespace std;
+
+/// Part of the frame period after which the next frame is requested
+const double REQUEST_LEAD = 0.9;
+/// Interval between the requests while waiting for a new frame [s]
+const double RETRY_INTERVAL = 0.002;
+
+CTrackingLoop::CTrackingLoop(CEventLoop& loop, CTrackingClient& trk, double period)
+  : requests(0), frames(0), loop(loop), trk(trk), frame_dt(period), last_arrival(-1),
+    last_time(0), error(false)
+{
+}
+
+bool CTrackingLoop::start(const frame_handler& h)
+{
+  on_frame = h;
+  int sock = trk.get_socket();
+  if (sock < 0 || !loop.watch_socket(sock, [this]() { receive(); })) return false;
+  request();
+  return !error;
+}
+
+void CTrackingLoop::request()
+{
+  requests++;
+  if (!trk.request()) {
+    error = true;
+    loop.stop();
+  }
+}
+
+void CTrackingLoop::receive()
+{
+  uint32_t t;
+  if (!trk.receive(t)) {
+    error = true;
+    loop.stop();
+    return;
+  }
+  double now = CEventLoop::now();
+
+  if (last_arrival >= 0 && t == last_time) {
+    // still the same frame: asks again soon, less often if the tracking seems stopped
+    double wait = (now - last_arrival < 2 * frame_dt) ? RETRY_INTERVAL : frame_dt / 4;
+    loop.add_timer(wait, [this]() { request(); });
+    return;
+  }
+
+  if (last_arrival >= 0) {
+    double dt = now - last_arrival;
+    frame_period.add(dt * 1e6);
+    // ignores the gaps where frames were missed
+    if (dt < 1.5 * frame_dt) frame_dt = 0.9 * frame_dt + 0.1 * dt;
+  }
+  last_arrival = now;
+  last_time = t;
+  frames++;
+  on_frame(t);
+
+  double wait = last_arrival + REQUEST_LEAD * frame_dt - CEventLoop::now();
+  loop.add_timer(max(wait, 0.0), [this]() { request(); });
+}
@@ -0,0 +1,59 @@
+#ifndef __TRKLOOP_H
+#define __TRKLOOP_H
+
+#include <stdint.h>
+#include <functional>
+#include "evloop.h"
+#include "timing.h"
+#include "trkcli.h"
+
+/** \brief Gets the tracking frames from the server as soon as they are
+  *   available, without polling at a fixed rate. The server answers each
+  *   request with its latest frame, so the next request is sent shortly
+  *   before the next frame is due (from the measured frame period), then
+  *   repeated at short intervals until a new frame comes. The handler runs
+  *   once per new frame.
+  */
+class CTrackingLoop {
+
+public:
+
+  /// Called at each new frame, with its time; the positions are read from the client
+  typedef std::function<void(uint32_t)> frame_handler;
+
+  /** \brief Constructor
+    * \param loop The event loop
+    * \param trk A connected tracking client
+    * \param period Expected frame period [s], refined with the frames received
+    */
+  CTrackingLoop(CEventLoop& loop, CTrackingClient& trk, double period = 1.0 / 15);
+
+  /// Starts getting the frames, returns false on error
+  bool start(const frame_handler& h);
+
+  /// true if the connection failed, which stops the event loop
+  bool failed() const { return error; }
+
+  /// Estimated frame period [s]
+  double period() const { return frame_dt; }
+
+  CTimingStats frame_period;    ///< time between the arrivals of new frames
+  unsigned int requests;        ///< number of requests sent
+  unsigned int frames;          ///< number of new frames
+
+private:
+
+  void request();
+  void receive();
+
+  CEventLoop& loop;
+  CTrackingClient& trk;
+  frame_handler on_frame;
+  double frame_dt;
+  double last_arrival;          ///< arrival of the last new frame [s], negative if none
+  uint32_t last_time;
+  bool error;
+
+};
+
+#endif
@@ -17,19 +17,19 @@ bool kbhit()
     return false;
   }
 
-  INPUT_RECORD* v = new INPUT_RECORD[d];
+  // looks at the events one by one, discarding the ones that are not key
+  // presses (ext_key() would skip them anyway), so that the input handle is
+  // only signaled while a key press is waiting
+  INPUT_RECORD r;
   DWORD count;
-  PeekConsoleInput(c_in, v, d, &count);
-  
-  bool result(false);
-  for (unsigned int i(0); i < count; i++) {
-    if (v[i].EventType == KEY_EVENT && v[i].Event.KeyEvent.bKeyDown) {
-      result = true;
+  while (d > 0 && PeekConsoleInput(c_in, &r, 1, &count) && count == 1) {
+    if (r.EventType == KEY_EVENT && r.Event.KeyEvent.bKeyDown) {
+      return true;
     }
+    ReadConsoleInput(c_in, &r, 1, &count);
+    d--;
   }
-
-  delete[] v;
-  return result;
+  return false;
 }
 
 DWORD ext_key()
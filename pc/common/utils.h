@@ -11,6 +11,7 @@ double time_d();
 /// \return true if a key has been pressed, false otherwise
 /// \note Remember that the key is not removed from the input buffer! Use ext_key()
 ///   to retrieve or discard it, or call FlushConsoleInputBuffer().
+///   The other input events (key releases, mouse, ...) before it are discarded.
 bool kbhit();
 
 /// \brief Returns the key code of the first key pressed (including non-character
@@ -0,0 +1,109 @@
+/*
+ * waypoint.cc -- waypoint following in the tank, using the offset and the frequency
+ */
+
+#include <cmath>
+#include "waypoint.h"
+
+using namespace std;
+
+CWaypointFollower::CWaypointFollower(const pid_gains& gains, double write_interval,
+                                     double width, double height, const nav_settings& s)
+  : ctrl(gains, write_interval), s(s), width(width), height(height), next(0),
+    write_interval(write_interval), last_freq_write(-1), freq(0)
+{
+}
+
+waypoint CWaypointFollower::clamp(const waypoint& w) const
+{
+  waypoint c = w;
+  c.x = max(s.margin, min(width - s.margin, c.x));
+  c.y = max(s.margin, min(height - s.margin, c.y));
+  return c;
+}
+
+bool CWaypointFollower::reached(size_t i, double x, double y) const
+{
+  const waypoint& w = path[i];
+  if (hypot(w.x - x, w.y - y) < s.accept_radius) return true;
+  if (i == 0) return false;
+
+  // a waypoint missed by a little is passed rather than circled around: it
+  // counts as reached once the robot is beyond it along the leg leading to it
+  const waypoint& p = path[i - 1];
+  double dx = w.x - p.x, dy = w.y - p.y;
+  return (x - w.x) * dx + (y - w.y) * dy > 0 && hypot(w.x - x, w.y - y) < s.slow_radius;
+}
+
+void CWaypointFollower::set_path(const vector<waypoint>& p)
+{
+  path.clear();
+  for (size_t i(0); i < p.size(); i++) path.push_back(clamp(p[i]));
+  next = 0;
+  freq = 0;
+  last_freq_write = -1;
+  ctrl.reset();
+}
+
+void CWaypointFollower::go_to_pose(const robot_pose& pose, double x, double y)
+{
+  double dx = cos(pose.heading), dy = sin(pose.heading);
+  vector<waypoint> p;
+  waypoint w;
+
+  if ((x - pose.x) * dx + (y - pose.y) * dy > 0) {
+    // passes beside the pose, one turn diameter away, towards the middle of the tank
+    double nx = -dy, ny = dx;
+    if (nx * (width / 2 - pose.x) + ny * (height / 2 - pose.y) < 0) {
+      nx = -nx;
+      ny = -ny;
+    }
+    w.x = pose.x + 2 * s.turn_radius * nx;
+    w.y = pose.y + 2 * s.turn_radius * ny;
+    p.push_back(w);
+  }
+  w.x = pose.x - s.approach * dx;
+  w.y = pose.y - s.approach * dy;
+  p.push_back(w);
+  w.x = pose.x;
+  w.y = pose.y;
+  p.push_back(w);
+  set_path(p);
+}
+
+void CWaypointFollower::resync()
+{
+  freq = 0;
+  last_freq_write = -1;
+  ctrl.resync();
+}
+
+bool CWaypointFollower::update(double t, bool detected, double x, double y, nav_command& cmd)
+{
+  cmd.write_offset = cmd.write_freq = false;
+
+  // skips the waypoints already reached (several at once if they are close)
+  while (detected && next < path.size() && reached(next, x, y)) next++;
+  if (done()) return false;
+
+  const waypoint& w = path[next];
+  if (detected) ctrl.set_target(atan2(w.y - y, w.x - x));
+  cmd.write_offset = ctrl.update(t, detected, x, y, cmd.offset);
+  // keeps the current speed while the robot is not seen
+  if (!detected) return true;
+
+  // slows down in sharp turns and when approaching the end of the path
+  const waypoint& last = path.back();
+  double err = fabs(atan2(sin(ctrl.get_target() - ctrl.estimator().heading()),
+                          cos(ctrl.get_target() - ctrl.estimator().heading())));
+  bool slow = !ctrl.estimator().valid() || err > s.slow_angle ||
+              (next + 1 == path.size() && hypot(last.x - x, last.y - y) < s.slow_radius);
+  float f = slow ? s.slow_freq : s.cruise_freq;
+  if (f != freq && (last_freq_write < 0 || t - last_freq_write >= write_interval)) {
+    cmd.write_freq = true;
+    cmd.freq = f;
+    freq = f;
+    last_freq_write = t;
+  }
+  return true;
+}
@@ -0,0 +1,114 @@
+#ifndef __WAYPOINT_H
+#define __WAYPOINT_H
+
+#include <vector>
+#include "heading.h"
+
+/// A point of a path in the tank [m]
+struct waypoint {
+  double x, y;
+};
+
+/// Position [m] and heading [rad] of the robot
+struct robot_pose {
+  double x, y;
+  double heading;
+};
+
+/// Register changes requested by the waypoint follower
+struct nav_command {
+  bool write_offset;    ///< the offset register has to be written
+  float offset;         ///< new offset [deg]
+  bool write_freq;      ///< the frequency register has to be written
+  float freq;           ///< new frequency [Hz]
+};
+
+/// Speed and precision settings of the waypoint follower
+struct nav_settings {
+  float cruise_freq;      ///< frequency far from the last waypoint [Hz]
+  float slow_freq;        ///< frequency near the last waypoint and in sharp turns [Hz]
+  double slow_radius;     ///< distance to the last waypoint below which the robot slows down [m]
+  double slow_angle;      ///< heading error above which the robot slows down [rad]
+  double accept_radius;   ///< distance at which a waypoint counts as reached [m]
+  double approach;        ///< length of the straight approach to a pose [m]
+  double turn_radius;     ///< turning radius of the robot at full offset [m]
+  double margin;          ///< distance kept from the walls of the tank [m]
+
+  nav_settings() : cruise_freq(1.0f), slow_freq(0.6f), slow_radius(0.5), slow_angle(0.8),
+                   accept_radius(0.15), approach(0.6), turn_radius(0.4), margin(0.3) {}
+};
+
+/** \brief Drives the robot along a list of waypoints, steering towards the
+  *   current one with the heading controller and adjusting the speed with
+  *   the frequency. The waypoints are kept inside the tank.
+  */
+class CWaypointFollower {
+
+public:
+
+  /** \brief Constructor
+    * \param gains Gains of the heading controller
+    * \param write_interval Shortest time between two writes of a register [s]
+    * \param width Size of the tank along x [m]
+    * \param height Size of the tank along y [m]
+    * \param s Speed and precision settings
+    */
+  CWaypointFollower(const pid_gains& gains, double write_interval, double width, double height,
+                    const nav_settings& s = nav_settings());
+
+  /// Sets the path to follow, restarting from its first waypoint
+  void set_path(const std::vector<waypoint>& path);
+
+  /** \brief Sets a path ending at a pose: a waypoint behind the pose, then
+    *   the pose itself, so that the robot arrives with the right heading. If
+    *   the robot is in front of the pose, it first passes beside it, on the
+    *   side with more room, to have space to turn around.
+    * \param pose The pose to reach
+    * \param x Current (or last known) position of the robot
+    * \param y Current (or last known) position of the robot
+    */
+  void go_to_pose(const robot_pose& pose, double x, double y);
+
+  /// Forgets the last written registers (see CHeadingController::resync())
+  void resync();
+
+  /** \brief Processes a tracking frame
+    * \param t Time of the frame [s]
+    * \param detected true if the robot was found, at (x, y)
+    * \param cmd Receives the register changes
+    * \return false once the last waypoint has been reached
+    */
+  bool update(double t, bool detected, double x, double y, nav_command& cmd);
+
+  /// true once the last waypoint has been reached
+  bool done() const { return next >= path.size(); }
+
+  /// Index of the waypoint the robot is heading to
+  size_t current() const { return next; }
+
+  /// The waypoints, after clamping inside the tank
+  const std::vector<waypoint>& waypoints() const { return path; }
+
+  /// The heading controller (statistics, write timing)
+  CHeadingController& controller() { return ctrl; }
+
+private:
+
+  /// Clamps a waypoint inside the tank, away from the walls
+  waypoint clamp(const waypoint& w) const;
+
+  /// true if the robot at (x, y) has reached the waypoint i
+  bool reached(size_t i, double x, double y) const;
+
+  CHeadingController ctrl;
+  nav_settings s;
+  double width, height;
+  std::vector<waypoint> path;
+  size_t next;
+  double write_interval;
+  double last_freq_write;   ///< time of the last frequency write [s], negative if none
+  float freq;               ///< last requested frequency, 0 if none
+
+};
+
+#endif
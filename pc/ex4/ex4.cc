@@ -1,6 +1,8 @@
+#include "evloop.h"
 #include "regdefs.h"
 #include "remregs.h"
 #include "robot.h"
+#include "rtthread.h"
 #include "utils.h"
 #include <cmath>
 // #include <conio.h> // For kbhit() and getch()
@@ -16,6 +18,8 @@ const char *INTERFACE = "COM1";    // Serial port for radio interface
 const uint8_t MOTOR_ADDR = 21;     // Motor address (from modes.c)
 const double AMPLITUDE_DEG = 40.0; // Amplitude in degrees
 const double FREQUENCY_HZ = 1.0;   // Frequency in Hz
+const double SETPOINT_PERIOD = 0.01; // Time between two setpoints in seconds
+const int CONTROL_PRIORITY = 80;   // Real-time priority of the setpoint thread (0 = normal)
 
 using namespace std;
 
@@ -67,12 +71,16 @@ int main() {
       cout << "Press any key to stop." << endl;
 
       double startTime = time_d(); // Get the start time
-      double currentTime = 0.0;
-      bool running = true;
 
-      while (running) {
+      // Sends a setpoint every SETPOINT_PERIOD from a real-time control
+      // thread, at a fixed rate whatever the time taken by the radio
+      rt_settings rt;
+      rt.period = SETPOINT_PERIOD;
+      rt.priority = CONTROL_PRIORITY;
+      CRealtimeThread control(rt);
+      control.start([&]() {
         // Calculate elapsed time since start
-        currentTime = time_d() - startTime;
+        double currentTime = time_d() - startTime;
 
         // Calculate sine wave value (-1 to 1) and scale it to the desired
         // amplitude
@@ -82,17 +90,21 @@ int main() {
         // Send the setpoint to the motor (assuming register 0x06 is the
         // setpoint)
         regs.set_reg_b(0x06, static_cast<int8_t>(angle));
+        return true;
+      });
 
-        // If a key is pressed, break out of the loop
+      // Waits for a key meanwhile
+      CEventLoop loop;
+      loop.watch_input([&]() {
         if (kbhit()) {
-          // Clear the key from the buffer.
-          //getch();
-          running = false;
+          ext_key(); // Consume the key
+          loop.stop();
         }
+      });
+      loop.run();
+      control.stop();
+      control.print_summary();
 
-        // Small delay to prevent overwhelming communication
-        Sleep(10);
-      }
       // Stop the motor and return to idle mode
       regs.set_reg_b(0x06, 0); // Set setpoint to 0
       regs.set_reg_b(REG8_MODE, IMODE_IDLE);
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <windows.h>
 #include "trkcli.h"
+#include "trkloop.h"
 #include "utils.h"
 
 using namespace std;
@@ -19,13 +20,15 @@ int main()
     return 1;
   }
 
-  while (!kbhit()) {
-    uint32_t frame_time;
-    // Gets the current position
-    if (!trk.update(frame_time)) {
-      return 1;
+  // Prints each new position as soon as it is received, until a key is pressed
+  CEventLoop loop;
+  CTrackingLoop frames(loop, trk);
+  loop.watch_input([&]() {
+    if (kbhit()) {
+      loop.stop();
     }
-
+  });
+  bool started = frames.start([&](uint32_t frame_time) {
     double x, y;
     cout.precision(2);
     
@@ -38,9 +41,9 @@ int main()
     } else {
       cout << "(not detected)" << '\r';
     }
-    
-    // Waits 10 ms before getting the info next time (anyway the tracking runs at 15 fps)
-    Sleep(10);
+  });
+  if (!started || !loop.run() || frames.failed()) {
+    return 1;
   }
   
   // Clears the console input buffer (as kbhit() doesn't)
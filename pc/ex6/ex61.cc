@@ -1,6 +1,7 @@
 #include "remregs.h"
 #include "robot.h"
 #include "trkcli.h"
+#include "trkloop.h"
 #include "utils.h"
 #include "regdefs.h"
 #include <cstdlib>
@@ -57,14 +58,15 @@ int main() {
   // Fixed green component for tracking
   const uint8_t GREEN_COMPONENT = 64;
 
-  while (!kbhit()) {
-    uint32_t frame_time;
-    // Gets the current position
-    if (!trk.update(frame_time)) {
-      cerr << "Error updating tracking data" << endl;
-      return 1;
+  // Updates the color at each new frame, as soon as it is received
+  CEventLoop loop;
+  CTrackingLoop frames(loop, trk);
+  loop.watch_input([&]() {
+    if (kbhit()) {
+      loop.stop();
     }
-
+  });
+  bool started = frames.start([&](uint32_t frame_time) {
     double x, y;
 
     // Gets the ID of the first spot
@@ -93,9 +95,10 @@ int main() {
       cout << "Position: (not detected)                             \r";
       cout.flush();
     }
-
-    // Wait 10 ms before getting the info next time
-    Sleep(10);
+  });
+  if (!started || !loop.run() || frames.failed()) {
+    cerr << "Error updating tracking data" << endl;
+    return 1;
   }
 
   // Clears the console input buffer (as kbhit() doesn't)
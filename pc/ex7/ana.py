@@ -121,3 +121,32 @@ if lag_speeds:
     plt.close()
 else:
     print("⚠️ No valid speed data found for speed plot.")
+
+# --- Occupancy heatmap (from "heatmap <index> density.csv", see pc/tools) ---
+DENSITY_FILE = os.path.join(FOLDER_PATH, "density.csv")
+if os.path.exists(DENSITY_FILE):
+    grid = pd.read_csv(DENSITY_FILE)
+    xs = np.sort(grid["X"].unique())
+    ys = np.sort(grid["Y"].unique())
+    occupancy = grid["Occupancy"].to_numpy().reshape(len(ys), len(xs))
+    vx = grid["VX"].fillna(0).to_numpy().reshape(len(ys), len(xs))
+    vy = grid["VY"].fillna(0).to_numpy().reshape(len(ys), len(xs))
+    cell = xs[1] - xs[0] if len(xs) > 1 else 1.0
+
+    plt.figure(figsize=(12, 4.5))
+    plt.imshow(
+        occupancy,
+        origin="lower",
+        extent=(0, len(xs) * cell, 0, len(ys) * cell),
+        cmap="viridis",
+        aspect="equal",
+    )
+    plt.colorbar(label="Time spent (s)")
+    step = max(1, len(xs) // 30)
+    plt.quiver(xs[::step], ys[::step], vx[::step, ::step], vy[::step, ::step], color="white")
+    plt.xlabel("X Position (m)")
+    plt.ylabel("Y Position (m)")
+    plt.title("Occupancy and Mean Velocity")
+    plt.tight_layout()
+    plt.savefig("occupancy.svg", format="svg")
+    plt.close()
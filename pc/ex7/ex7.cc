@@ -1,56 +1,54 @@
-#include "regdefs.h"
+#include "gait.h"
+#include "geofence.h"
+#include "heading.h"
+#include "jobqueue.h"
+#include "latprobe.h"
+#include "optimizer.h"
+#include "profmon.h"
 #include "remregs.h"
 #include "robot.h"
+#include "runlog.h"
+#include "sweep.h"
+#include "timeline.h"
 #include "trkcli.h"
+#include "trkloop.h"
 #include "utils.h"
+#include "waypoint.h"
 #include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
-#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <stdint.h>
 #include <string>
 #include <windows.h>
 
 using namespace std;
 
-/// Idle mode: do nothing
-#define IMODE_IDLE 0
-
-/// set the robot in a warped and rigid position (prevent capsizing)
-#define IMODE_READY 1
-
-/// active swimming mode
-#define IMODE_SWIM 2
-
-// Define limits for frequency and amplitude
-#define MAX_FREQ 1.5f  // Maximum frequency in Hz
-#define MAX_AMP 60.0f  // Maximum amplitude in degrees
-#define MAX_LAG 1.5f // Maximum lag between elements in degrees
-#define MAX_OFF 3.0f // Maximum offset in degrees
-
-#define MIN_FREQ 0.1f
-#define MIN_AMP 1.0f  // Min amplitude in degrees
-#define MIN_LAG 0.5f // Min lag between elements in degrees
-#define MIN_OFF -3.0f // Min offset in degrees
-
-// Define registers for frequency, lag, offset and amplitude control
-#define REG8_SINE_FREQ 10 // Register for sine wave frequency
-#define REG8_SINE_AMP 11  // Register for sine wave amplitude
-#define REG8_SINE_LAG 12  // Register for sine wave lag between elements
-#define REG8_SINE_OFF 13  // Register for sine wave offset
-
 const char *TRACKING_PC_NAME = "biorobpc6"; ///< host name of the tracking PC
 const uint16_t TRACKING_PORT = 10502;       ///< port number of the tracking PC
 const uint8_t RADIO_CHANNEL = 126;          ///< robot radio channel
 const char *INTERFACE = "COM3";             ///< robot radio interface
+const bool COMPRESSED_LOGS = false;         ///< .trk logs instead of CSV
+
+/// Heading controller: offset [deg] per rad of heading error, and offset limits
+/// (kept with the latency compensated, until higher gains are tuned on the robot)
+const pid_gains HEADING_GAINS = { 3.0, 0.8, 0.5, MIN_OFF, MAX_OFF };
+/// Shortest time between two writes of the offset register [s]
+const double HEADING_WRITE_INTERVAL = 0.1;
+/// Longest time given to the robot to reach the start pose of a queued job [s]
+const double JOB_RETURN_TIMEOUT = 60;
 
 // Aquarium dimensions in meters
 const double AQUARIUM_WIDTH = 6.0;
 const double AQUARIUM_HEIGHT = 2.0;
 
+/// Latency compensated by the controllers [s], measured with the LED probe (0 until then)
+double control_latency = 0;
+
 // Function to map a value from one range to another
 double map_value(double value, double in_min, double in_max, double out_min,
                  double out_max) {
@@ -118,20 +116,717 @@ void update_parameter(CRemoteRegs &regs, const char *name, uint8_t reg,
 
 void update_parameter_force(CRemoteRegs &regs, uint8_t reg, float min_value,
                             float max_value, float value) {
-  // Ensure value is within bounds
-  if (value < min_value)
-    value = min_value;
-  if (value > max_value)
-    value = max_value;
-
-  // Encode and set the register
-  uint8_t encoded = ENCODE_PARAM_8(value, min_value, max_value);
-  regs.set_reg_b(reg, encoded);
+  // Encode the value within bounds and set the register
+  regs.set_reg_b(reg, encode_gait_param(value, min_value, max_value));
+}
+
+// Saves the timeline of a run next to its log
+void save_timeline(const CTimeline &timeline, const string &base) {
+  string name = base + ".tln";
+  if (!timeline.save(name.c_str())) {
+    cerr << "Unable to save the timeline" << endl;
+  }
+}
+
+// Waits for a given time [s], returns false if a key was pressed meanwhile
+bool wait_or_key(double seconds) {
+  bool elapsed = false;
+  CEventLoop loop;
+  loop.watch_input([&]() {
+    if (kbhit()) {
+      ext_key(); // Consume the key
+      loop.stop();
+    }
+  });
+  loop.add_timer(seconds, [&]() {
+    elapsed = true;
+    loop.stop();
+  });
+  loop.run();
+  return elapsed;
+}
+
+// Function called at each tracking frame, with the time since the start of
+// the run [s], whether the robot was detected and its position, and whether
+// the gait registers have been restored after a geofence override since the
+// last call; it returns false to end the run
+typedef function<bool(double, bool, double, double, bool)> frame_handler;
+
+// Sets the robot to swim mode and logs its position, until a key is pressed,
+// the frame handler ends the run or for the given duration [s] if not 0. No
+// log is written if base is empty. The geofence steers the robot away from
+// the walls, the frame handler being suspended meanwhile; a timed run without
+// frame handler (a trial) is rather ended at the first intervention, so that
+// it is not measured while steering. The interventions are marked in the log
+// and the timeline. The robot is left swimming, unless set to ready mode by
+// the geofence.
+// Returns false if a timed run was interrupted by a key or a tracking error.
+bool swim_and_log(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline,
+                  const string &base, double duration,
+                  const frame_handler &on_frame = nullptr) {
+  timeline.clear();
+
+  // The geofence turns the same way as the heading controller
+  fence_settings fs;
+  fs.steer_offset = HEADING_GAINS.kp < 0 ? MIN_OFF : MAX_OFF;
+  fs.latency = control_latency;
+  CGeofence fence(AQUARIUM_WIDTH, AQUARIUM_HEIGHT, fs);
+  fence_action action = FENCE_NONE;
+  bool resumed = false;
+  uint8_t freq_reg = regs.get_reg_b(REG8_SINE_FREQ);
+  uint8_t off_reg = regs.get_reg_b(REG8_SINE_OFF);
+
+  cout << "Setting robot to swim mode..." << endl;
+  regs.set_reg_b(REG8_MODE, IMODE_SWIM);
+  auto start = chrono::steady_clock::now();
+
+  // Creates the log file, named after the date and the gait parameters
+  CRunLogger log;
+  if (!base.empty() && !log.open(base, COMPRESSED_LOGS)) {
+    cerr << "Unable to create log file" << endl;
+  }
+
+  // Reacts to each new tracking frame as soon as it is received, and sleeps
+  // in between
+  bool completed = true;
+  CEventLoop loop;
+  CTrackingLoop frames(loop, trk);
+  bool started = frames.start([&](uint32_t frame_time) {
+    double x = 0, y = 0;
+
+    // Gets the ID of the first spot
+    int id = trk.get_first_id();
+
+    // Reads its coordinates (if (id == -1), then no spot is detected)
+    bool detected = id != -1 && trk.get_pos(id, x, y);
+    timeline.add_frame(frame_time, detected, x, y);
+    double t = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // Get the current time as milliseconds since epoch
+    auto now_ms = chrono::duration_cast<chrono::milliseconds>(
+        chrono::system_clock::now().time_since_epoch());
+
+    fence_action new_action = fence.update(t, detected, x, y);
+    if (new_action != action) {
+      bool steering = action == FENCE_STEER;
+      action = new_action;
+      timeline.add_mark(action);
+      if (log.is_open()) {
+        log.add_event(now_ms.count(), action);
+      }
+      if (action == FENCE_STOP || (action == FENCE_STEER && !on_frame && duration > 0)) {
+        // the steering override is not left in the registers
+        if (steering) {
+          regs.set_reg_b(REG8_SINE_OFF, off_reg);
+          regs.set_reg_b(REG8_SINE_FREQ, freq_reg);
+        }
+        regs.set_reg_b(REG8_MODE, IMODE_READY);
+        cout << endl << "Wall ahead, robot stopped." << endl;
+        loop.stop();
+      } else if (action == FENCE_STEER) {
+        update_parameter_force(regs, REG8_SINE_OFF, MIN_OFF, MAX_OFF, fence.steer_offset());
+        update_parameter_force(regs, REG8_SINE_FREQ, MIN_FREQ, MAX_FREQ, fs.steer_freq);
+      } else {
+        regs.set_reg_b(REG8_SINE_OFF, off_reg);
+        regs.set_reg_b(REG8_SINE_FREQ, freq_reg);
+        resumed = true;
+      }
+    }
+    if (loop.is_running() && action == FENCE_NONE && on_frame) {
+      if (!on_frame(t, detected, x, y, resumed)) {
+        loop.stop();
+      }
+      resumed = false;
+    }
+
+    if (detected) {
+
+      // Log the position to file
+      if (log.is_open()) {
+        track_sample ts = { (int64_t) now_ms.count(), (float) x, (float) y };
+        log.add(ts);
+      }
+
+      cout << "Position: (" << fixed << setprecision(3) << x << ", " << y
+           << ") m                     \r";
+    } else {
+      cout << "Position: (not detected)                             \r";
+    }
+    cout.flush();
+  });
+
+  // Stops when a key is pressed
+  loop.watch_input([&]() {
+    if (kbhit()) {
+      ext_key(); // Consume the key
+      completed = (duration == 0);
+      loop.stop();
+    }
+  });
+
+  // Stops at the end of a timed run
+  if (duration > 0) {
+    loop.add_timer(duration, [&]() { loop.stop(); });
+  }
+
+  if (!started || !loop.run() || frames.failed()) {
+    cerr << "Error updating tracking data" << endl;
+    completed = false;
+  }
+
+  if (log.is_open() && !log.close()) {
+    cerr << "Error while writing " << log.filename() << endl;
+  }
+  cout << endl << "Swimming stopped." << endl;
+  if (fence.steered > 0 || fence.stopped > 0) {
+    cout << "Geofence: " << fence.steered << " steering override(s), " << fence.stopped
+         << " stop(s)" << endl;
+    fence.compute_time.print("Geofence time");
+  }
+  return completed;
+}
+
+// Swims along the path of a waypoint follower, steering with the offset and
+// setting the speed with the frequency, until the last waypoint is reached, a
+// key is pressed or the timeout [s] expires if not 0. If pose is not NULL, the
+// path to it is planned at the first frame where the robot is seen. The robot
+// is left swimming. Returns false if a timed run was interrupted by a key or
+// a tracking error, and sets arrived if the last waypoint was reached.
+bool follow_path(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline,
+                 CWaypointFollower &nav, const robot_pose *pose, double timeout,
+                 bool &arrived) {
+  bool planned = (pose == nullptr);
+  arrived = false;
+  update_parameter_force(regs, REG8_SINE_OFF, MIN_OFF, MAX_OFF, 0);
+
+  bool completed = swim_and_log(regs, trk, timeline, "", timeout,
+                                [&](double t, bool detected, double x, double y, bool resumed) {
+    if (resumed) {
+      nav.resync();
+    }
+    if (!planned) {
+      if (!detected) {
+        return true;
+      }
+      nav.go_to_pose(*pose, x, y);
+      planned = true;
+    }
+    nav_command cmd;
+    if (!nav.update(t, detected, x, y, cmd)) {
+      arrived = true;
+      return false;
+    }
+    auto t0 = chrono::steady_clock::now();
+    if (cmd.write_offset) {
+      update_parameter_force(regs, REG8_SINE_OFF, MIN_OFF, MAX_OFF, cmd.offset);
+    }
+    if (cmd.write_freq) {
+      update_parameter_force(regs, REG8_SINE_FREQ, MIN_FREQ, MAX_FREQ, cmd.freq);
+    }
+    if (cmd.write_offset || cmd.write_freq) {
+      nav.controller().write_done(chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+    }
+    return true;
+  });
+  return completed;
+}
+
+// Brings the robot to a start pose, giving up after the timeout [s]. The gait
+// registers are set again by the next trial. Returns false if interrupted by
+// a key.
+bool go_to_start(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline,
+                 const robot_pose &start, double timeout) {
+  cout << "Returning to the start pose..." << endl;
+  CWaypointFollower nav(HEADING_GAINS, HEADING_WRITE_INTERVAL, AQUARIUM_WIDTH, AQUARIUM_HEIGHT);
+  nav.controller().set_latency(control_latency);
+  bool arrived;
+  bool completed = follow_path(regs, trk, timeline, nav, &start, timeout, arrived);
+  regs.set_reg_b(REG8_MODE, IMODE_READY);
+  if (completed && !arrived) {
+    cout << "Start pose not reached in " << timeout << " s, continuing from here." << endl;
+  }
+  return completed;
+}
+
+// Brings the robot back to the start pose of a sweep, if it has one, so that
+// the trials do not need to be started by hand. Returns false if interrupted
+// by a key.
+bool return_to_start(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline,
+                     const sweep_spec &spec) {
+  if (!spec.has_start) {
+    return true;
+  }
+  robot_pose start = { spec.start_x, spec.start_y, spec.start_heading };
+  return go_to_start(regs, trk, timeline, start, spec.return_timeout);
+}
+
+// Sets the gait of a trial and lets the robot settle in ready mode for the
+// given time [s]. Returns false if interrupted by a key or a radio error.
+bool start_trial(CRemoteRegs &regs, const gait_params &g, double settle) {
+  update_parameter_force(regs, REG8_SINE_FREQ, MIN_FREQ, MAX_FREQ, g.freq);
+  update_parameter_force(regs, REG8_SINE_AMP, MIN_AMP, MAX_AMP, g.amp);
+  update_parameter_force(regs, REG8_SINE_LAG, MIN_LAG, MAX_LAG, g.lag);
+  update_parameter_force(regs, REG8_SINE_OFF, MIN_OFF, MAX_OFF, g.off);
+
+  // Lets the robot settle in ready mode before each trial
+  if (!regs.set_reg_b(REG8_MODE, IMODE_READY)) {
+    cerr << "Unable to reach the robot" << endl;
+    return false;
+  }
+  return wait_or_key(settle);
+}
+
+// Runs a trial of a sweep: sets the gait, lets the robot settle in ready mode
+// then swims for the duration of the trial and saves its timeline. Sets base
+// to the name of the run, and returns false if interrupted by a key.
+bool run_trial(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline,
+               const sweep_spec &spec, const gait_params &g, string &base) {
+  if (!start_trial(regs, g, spec.settle)) {
+    return false;
+  }
+
+  base = make_run_name(g.freq, g.amp, g.lag, g.off);
+  bool completed = swim_and_log(regs, trk, timeline, base, spec.duration);
+  regs.set_reg_b(REG8_MODE, IMODE_READY);
+  save_timeline(timeline, base);
+  return completed;
+}
+
+// Runs the trials of a parameter sweep (see sweep.h) one after the other,
+// skipping those already completed, so that an interrupted sweep can simply
+// be started again
+void run_sweep(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline) {
+  cout << "Sweep specification file: ";
+  string spec_file;
+  getline(cin, spec_file);
+
+  sweep_spec spec;
+  if (!load_sweep_spec(spec_file.c_str(), spec)) {
+    return;
+  }
+  vector<gait_params> trials;
+  plan_sweep(spec, trials);
+
+  CSweepProgress progress;
+  string progress_file = spec_file + ".progress";
+  if (!progress.open(progress_file.c_str(), trials)) {
+    return;
+  }
+
+  cout << trials.size() << " trials, " << progress.completed()
+       << " already done. Press any key to interrupt the sweep." << endl;
+
+  for (size_t i(0); i < trials.size(); i++) {
+    if (progress.is_done(i)) {
+      continue;
+    }
+    gait_params g = quantize_gait(trials[i]);
+    cout << "Trial " << i + 1 << "/" << trials.size() << ": freq " << g.freq
+         << " Hz, amp " << g.amp << ", lag " << g.lag << ", off " << g.off << endl;
+
+    string base;
+    if (!run_trial(regs, trk, timeline, spec, g, base)) {
+      cout << "Sweep interrupted, trial " << i + 1 << " will be run again." << endl;
+      break;
+    }
+    if (!progress.mark_done(i, base)) {
+      cerr << "Unable to update " << progress_file << endl;
+    }
+    if (!return_to_start(regs, trk, timeline, spec)) {
+      cout << "Sweep interrupted." << endl;
+      break;
+    }
+  }
+
+  cout << progress.completed() << "/" << trials.size() << " trials done." << endl;
+  regs.set_reg_b(REG8_MODE, IMODE_IDLE);
+}
+
+// Loads the log of a run and returns its speed, as in the run catalog
+double run_speed(const string &base) {
+  vector<track_sample> samples;
+  run_summary sum;
+  if (!load_run_log(base + (COMPRESSED_LOGS ? ".trk" : ".csv"), samples)) {
+    return NAN;
+  }
+  summarize_run(samples, sum);
+  return sum.speed;
+}
+
+// Searches the gait maximizing the speed, each candidate proposed by the
+// optimizer being evaluated by a trial; the evaluations are stored in a
+// history file, and the optimization continues where it stopped when started
+// again with the same specification
+void run_optimizer(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline) {
+  cout << "Optimizer specification file: ";
+  string spec_file;
+  getline(cin, spec_file);
+
+  sweep_spec spec;
+  if (!load_sweep_spec(spec_file.c_str(), spec)) {
+    return;
+  }
+
+  CGaitOptimizer opt;
+  string history_file = spec_file + ".history.csv";
+  if (!opt.open(history_file.c_str(), spec)) {
+    return;
+  }
+
+  cout << opt.evaluations() << "/" << spec.samples
+       << " evaluations done. Press any key to interrupt the optimization." << endl;
+
+  while (opt.evaluations() < spec.samples) {
+    gait_params g = opt.next();
+    cout << "Evaluation " << opt.evaluations() + 1 << "/" << spec.samples << ": freq "
+         << g.freq << " Hz, amp " << g.amp << ", lag " << g.lag << ", off " << g.off << endl;
+
+    string base;
+    if (!run_trial(regs, trk, timeline, spec, g, base)) {
+      cout << "Optimization interrupted, this candidate will be evaluated again." << endl;
+      break;
+    }
+
+    double speed = run_speed(base);
+    cout << "Speed: " << speed << " m/s" << endl;
+    if (!opt.report(speed)) {
+      cerr << "Unable to update " << history_file << endl;
+    }
+    if (!return_to_start(regs, trk, timeline, spec)) {
+      cout << "Optimization interrupted." << endl;
+      break;
+    }
+  }
+
+  gait_params best;
+  double best_speed;
+  opt.best(best, best_speed);
+  cout << "Best gait so far: freq " << best.freq << " Hz, amp " << best.amp << ", lag "
+       << best.lag << ", off " << best.off << " (" << best_speed << " m/s)" << endl;
+  regs.set_reg_b(REG8_MODE, IMODE_IDLE);
+}
+
+// Prints the jobs of a queue with their progress
+void list_jobs(const CJobQueue &queue) {
+  const vector<trial_job> &jobs = queue.jobs();
+  for (size_t i(0); i < jobs.size(); i++) {
+    const trial_job &j = jobs[i];
+    cout << "Job " << j.id << ": freq " << j.gait.freq << " Hz, amp " << j.gait.amp << ", lag "
+         << j.gait.lag << ", off " << j.gait.off << ", " << j.runs.size() << "/" << j.repeat
+         << " run(s)" << (j.dropped ? ", dropped" : "") << endl;
+  }
+  cout << queue.runs_left() << " run(s) left." << endl;
+}
+
+// Adds a job for each trial of a sweep specification to a queue
+void add_jobs(CJobQueue &queue) {
+  cout << "Sweep specification file: ";
+  string spec_file;
+  getline(cin, spec_file);
+
+  sweep_spec spec;
+  if (!load_sweep_spec(spec_file.c_str(), spec)) {
+    return;
+  }
+  vector<gait_params> trials;
+  plan_sweep(spec, trials);
+
+  trial_job j;
+  j.duration = spec.duration;
+  j.settle = spec.settle;
+  j.has_start = spec.has_start;
+  j.start_x = spec.start_x;
+  j.start_y = spec.start_y;
+  j.start_heading = spec.start_heading;
+  size_t added(0);
+  for (; added < trials.size(); added++) {
+    j.gait = quantize_gait(trials[added]);
+    if (!queue.add(j)) {
+      cerr << "Unable to update the job journal" << endl;
+      break;
+    }
+  }
+  cout << added << " job(s) added." << endl;
+}
+
+// Runs the jobs of a queue back to back until it is empty, a key is pressed
+// or an error occurs. Each run is recorded in the journal before the robot
+// swims, and counted only once its log is closed, so that the queue can be
+// resumed after a crash without losing or repeating a run.
+void run_jobs(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline, CJobQueue &queue) {
+  cout << queue.runs_left() << " run(s) left. Press any key to interrupt the queue." << endl;
+
+  while (const trial_job *p = queue.next()) {
+    // the job may move in memory when the queue changes
+    trial_job j = *p;
+    cout << "Job " << j.id << ", run " << j.runs.size() + 1 << "/" << j.repeat << ": freq "
+         << j.gait.freq << " Hz, amp " << j.gait.amp << ", lag " << j.gait.lag << ", off "
+         << j.gait.off << endl;
+
+    // the robot is brought to the start pose before each run, whatever
+    // happened to the previous one
+    robot_pose start = { j.start_x, j.start_y, j.start_heading };
+    if ((j.has_start && !go_to_start(regs, trk, timeline, start, JOB_RETURN_TIMEOUT)) ||
+        !start_trial(regs, j.gait, j.settle)) {
+      cout << "Queue interrupted." << endl;
+      break;
+    }
+
+    string base = make_run_name(j.gait.freq, j.gait.amp, j.gait.lag, j.gait.off);
+    if (!queue.begin_run(j.id, base)) {
+      cerr << "Unable to update the job journal" << endl;
+      break;
+    }
+    bool completed = swim_and_log(regs, trk, timeline, base, j.duration);
+    bool stopped = regs.set_reg_b(REG8_MODE, IMODE_READY);
+    save_timeline(timeline, base);
+
+    if (!completed || !stopped) {
+      queue.abort_run(j.id, base);
+      cout << "Queue interrupted, this run will be done again." << endl;
+      break;
+    }
+    if (!queue.end_run(j.id, base)) {
+      cerr << "Unable to update the job journal" << endl;
+      break;
+    }
+  }
+
+  cout << queue.runs_left() << " run(s) left." << endl;
+  regs.set_reg_b(REG8_MODE, IMODE_IDLE);
+}
+
+// Manages a queue of trials kept in a journal file (see jobqueue.h)
+void job_queue(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline) {
+  cout << "Job journal file [jobs.journal]: ";
+  string journal;
+  getline(cin, journal);
+  if (journal.empty()) {
+    journal = "jobs.journal";
+  }
+
+  CJobQueue queue;
+  if (!queue.open(journal.c_str())) {
+    return;
+  }
+
+  bool done = false;
+  while (!done) {
+    list_jobs(queue);
+    cout << "a. Add the trials of a sweep\n";
+    cout << "d. Drop a job\n";
+    cout << "r. Run the queue\n";
+    cout << "q. Back\n";
+    cout << "Enter your choice: ";
+
+    char choice = '\0';
+    cin >> choice;
+    cin.ignore(10000, '\n');
+
+    switch (choice) {
+    case 'a':
+    case 'A':
+      add_jobs(queue);
+      break;
+
+    case 'd':
+    case 'D': {
+      cout << "Job to drop: ";
+      string input;
+      getline(cin, input);
+      unsigned int id = (unsigned int) strtoul(input.c_str(), NULL, 10);
+      if (!queue.drop(id)) {
+        cout << "No job " << input << "." << endl;
+      }
+      break;
+    }
+
+    case 'r':
+    case 'R':
+      run_jobs(regs, trk, timeline, queue);
+      break;
+
+    case 'q':
+    case 'Q':
+      done = true;
+      break;
+
+    default:
+      cout << "\nInvalid choice. Please try again." << endl;
+      break;
+    }
+  }
+}
+
+// Measures the latency from a register write to its effect in the tracking
+// frames, by switching the head LED on and off (see latprobe.h)
+void latency_probe(CRemoteRegs &regs, CTrackingClient &trk) {
+  probe_settings ps;
+  cout << "Number of LED changes [" << ps.repeats << "]: ";
+  string input;
+  getline(cin, input);
+  if (!input.empty() && atoi(input.c_str()) > 0) {
+    ps.repeats = atoi(input.c_str());
+  }
+
+  uint32_t led;
+  if (!regs.get_reg_dw(REG32_LED, led)) {
+    cerr << "Unable to reach the robot" << endl;
+    return;
+  }
+
+  cout << "The robot has to stay in view. Press any key to stop..." << endl;
+  CLatencyProbe probe(ps, time(NULL));
+  bool scheduled = false;
+  CEventLoop loop;
+  CTrackingLoop frames(loop, trk);
+
+  // Each change is written after a random pause, which puts the commands
+  // anywhere in the frame period
+  auto change = [&]() {
+    scheduled = false;
+    double sent = CEventLoop::now();
+    if (!regs.set_reg_dw(REG32_LED, probe.led_value())) {
+      cerr << endl << "Unable to reach the robot" << endl;
+      loop.stop();
+      return;
+    }
+    probe.command(sent, CEventLoop::now());
+  };
+
+  bool started = frames.start([&](uint32_t frame_time) {
+    probe.frame(CEventLoop::now(), frame_time, trk.get_first_id() != -1);
+    if (probe.done()) {
+      loop.stop();
+    } else if (!probe.waiting() && !scheduled) {
+      loop.add_timer(probe.pause(), change);
+      scheduled = true;
+    }
+    cout << probe.samples().size() << "/" << ps.repeats << " change(s) measured, "
+         << probe.timeouts << " not seen\r";
+    cout.flush();
+  });
+
+  loop.watch_input([&]() {
+    if (kbhit()) {
+      ext_key(); // Consume the key
+      loop.stop();
+    }
+  });
+
+  if (!started || !loop.run() || frames.failed()) {
+    cerr << "Error updating tracking data" << endl;
+  }
+  cout << endl;
+  regs.set_reg_dw(REG32_LED, led);
+  probe.print();
+
+  if (probe.control_latency() > 0) {
+    control_latency = probe.control_latency();
+    cout << "The controllers now compensate " << control_latency * 1000 << " ms." << endl;
+  }
+}
+
+// Prints the profile of the head firmware every second, until a key is
+// pressed (see profmon.h)
+void profile_monitor(CRemoteRegs &regs) {
+  CProfileMonitor prof;
+  cout << "Clear the counters first (y/n) [n]: ";
+  string input;
+  getline(cin, input);
+  if (!input.empty() && (input[0] == 'y' || input[0] == 'Y') && !prof.clear(regs)) {
+    cerr << "Unable to clear the profile" << endl;
+    return;
+  }
+
+  cout << "Press any key to stop..." << endl;
+  do {
+    if (!prof.poll(regs, time_d())) {
+      cerr << "Unable to read the profile (firmware without it?)" << endl;
+    }
+    cout << endl;
+    prof.print(stdout);
+  } while (wait_or_key(1.0));
+}
+
+// Swims while holding a heading with the offset, as long as no key is pressed
+void heading_hold(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline,
+                  const gait_params &g) {
+  cout << "Heading to hold in degrees (0 = along the tank) [0]: ";
+  string input;
+  getline(cin, input);
+  double target = 0;
+  try {
+    if (!input.empty()) {
+      target = stod(input) * M_PI / 180;
+    }
+  } catch (const exception &e) {
+    cout << "Invalid input, holding 0 degrees." << endl;
+  }
+
+  CHeadingController ctrl(HEADING_GAINS, HEADING_WRITE_INTERVAL);
+  ctrl.set_latency(control_latency);
+  ctrl.set_target(target);
+  update_parameter_force(regs, REG8_SINE_OFF, MIN_OFF, MAX_OFF, 0);
+
+  string base = make_run_name(g.freq, g.amp, g.lag, 0);
+  cout << "Press any key to stop swimming..." << endl;
+  swim_and_log(regs, trk, timeline, base, 0,
+               [&](double t, bool detected, double x, double y, bool resumed) {
+    if (resumed) {
+      ctrl.resync();
+    }
+    float offset;
+    if (ctrl.update(t, detected, x, y, offset)) {
+      auto t0 = chrono::steady_clock::now();
+      update_parameter_force(regs, REG8_SINE_OFF, MIN_OFF, MAX_OFF, offset);
+      ctrl.write_done(chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+    }
+    return true;
+  });
+  regs.set_reg_b(REG8_MODE, IMODE_IDLE);
+  save_timeline(timeline, base);
+
+  ctrl.print_stats();
+}
+
+// Follows a path of waypoints entered by the user, as long as no key is pressed
+void waypoint_mode(CRemoteRegs &regs, CTrackingClient &trk, CTimeline &timeline) {
+  cout << "Waypoints in meters, as x,y pairs separated by spaces: ";
+  string input;
+  getline(cin, input);
+
+  vector<waypoint> path;
+  istringstream in(input);
+  string item;
+  while (in >> item) {
+    waypoint w;
+    if (sscanf(item.c_str(), "%lf,%lf", &w.x, &w.y) != 2) {
+      cout << "Invalid waypoint: " << item << endl;
+      return;
+    }
+    path.push_back(w);
+  }
+  if (path.empty()) {
+    return;
+  }
+
+  CWaypointFollower nav(HEADING_GAINS, HEADING_WRITE_INTERVAL, AQUARIUM_WIDTH, AQUARIUM_HEIGHT);
+  nav.controller().set_latency(control_latency);
+  nav.set_path(path);
+  cout << "Press any key to stop swimming..." << endl;
+  bool arrived;
+  follow_path(regs, trk, timeline, nav, nullptr, 0, arrived);
+  regs.set_reg_b(REG8_MODE, IMODE_IDLE);
+  cout << (arrived ? "Last waypoint reached." : "Path not completed.") << endl;
+
+  nav.controller().print_stats();
 }
 
 int main() {
   CTrackingClient trk;
   CRemoteRegs regs;
+  CTimeline timeline;
 
   cout << "Initializing robot connection..." << endl;
   if (!init_radio_interface(INTERFACE, RADIO_CHANNEL, regs)) {
@@ -142,6 +837,9 @@ int main() {
   // Reboot the head microcontroller to ensure it's in a known state
   reboot_head(regs);
 
+  // Records all the register operations in the timeline
+  regs.set_observer(&timeline);
+
   cout << "Connecting to tracking system..." << endl;
   if (!trk.connect(TRACKING_PC_NAME, TRACKING_PORT)) {
     cerr << "Failed to connect to tracking system" << endl;
@@ -197,6 +895,13 @@ int main() {
     cout << "6. Ready mode\n";
     cout << "7. Swim mode\n";
     cout << "8. Interactive mode\n";
+    cout << "9. Parameter sweep\n";
+    cout << "o. Gait optimizer\n";
+    cout << "j. Job queue\n";
+    cout << "l. LED latency probe\n";
+    cout << "p. Firmware profile\n";
+    cout << "h. Heading hold\n";
+    cout << "w. Follow waypoints\n";
     cout << "0. Stop (idle mode)\n";
     cout << "q. Quit\n";
 
@@ -236,85 +941,18 @@ int main() {
       break;
 
     case '7': {
-      cout << "Setting robot to swim mode..." << endl;
-      regs.set_reg_b(REG8_MODE, IMODE_SWIM);
-
-      // Create a filename with timestamp
-      time_t now = time(0);
-      tm *ltm = localtime(&now);
-      string filename = "robot_position_" + to_string(ltm->tm_year + 1900) +
-                        "_" + to_string(ltm->tm_mon + 1) + "_" +
-                        to_string(ltm->tm_mday) + "_" +
-                        to_string(ltm->tm_hour) + "_" + to_string(ltm->tm_min) +
-                        "_" + to_string(ltm->tm_sec) + "_freq_" + to_string(freq) + "_amp_" + 
-                        to_string(amplitude) + "_lag_" + to_string(lag) + "_off_" + 
-                        to_string(offset) +".csv";
-
-      // Write header to CSV file
-      ofstream file(filename);
-      if (file.is_open()) {
-        file << "Timestamp,X,Y" << endl;
-        file.close();
-      } else {
-        cerr << "Unable to create log file" << endl;
-      }
-
+      string base = make_run_name(freq, amplitude, lag, offset);
       cout << "Press any key to stop swimming..." << endl;
-
-      bool swimming = true;
-      while (swimming) {
-        uint32_t frame_time;
-        // Gets the current position
-        if (!trk.update(frame_time)) {
-          cerr << "Error updating tracking data" << endl;
-          break;
-        }
-
-        double x = 0, y = 0;
-        // bool detected = false;
-
-        // Gets the ID of the first spot
-        int id = trk.get_first_id();
-
-        // Reads its coordinates (if (id == -1), then no spot is detected)
-        if (id != -1 && trk.get_pos(id, x, y)) {
-          // detected = true;
-
-          // Get the current time as milliseconds since epoch
-          auto now_ms = chrono::duration_cast<chrono::milliseconds>(
-              chrono::system_clock::now().time_since_epoch());
-
-          // Log the position to file
-          ofstream datafile(filename, ios::app);
-          if (datafile.is_open()) {
-            datafile << now_ms.count() << "," << fixed << setprecision(3) << x
-                     << "," << y << endl;
-            datafile.close();
-          }
-
-          cout << "Position: (" << fixed << setprecision(3) << x << ", " << y
-               << ") m                     \r";
-        } else {
-          cout << "Position: (not detected)                             \r";
-        }
-        cout.flush();
-
-        // Check for key press to exit
-        if (kbhit()) {
-          swimming = false;
-          ext_key(); // Consume the key
-        }
-
-        // Small delay to prevent excessive CPU usage
-        Sleep(10);
-      }
-
-      cout << endl << "Swimming stopped." << endl;
+      swim_and_log(regs, trk, timeline, base, 0);
       regs.set_reg_b(REG8_MODE, IMODE_IDLE);
+      save_timeline(timeline, base);
       break;
     }
 
     case '8': {
+      string base = make_run_name(freq, amplitude, lag, offset);
+      timeline.clear();
+
       cout << "Starting interactive mode..." << endl;
       regs.set_reg_b(REG8_MODE, IMODE_SWIM);
 
@@ -323,9 +961,11 @@ int main() {
       cout << "  A/D: Turn left/right (offset)" << endl;
       cout << "  Q: Return to menu" << endl;
 
-      bool interactiveMode = true;
-      while (interactiveMode) {
-        if (kbhit()) {
+      // Waits for the keys and the tracking frames, whichever comes first
+      CEventLoop loop;
+      CTrackingLoop frames(loop, trk);
+      loop.watch_input([&]() {
+        while (kbhit()) {
           DWORD key = ext_key();
           char c = key & 0xFF;
 
@@ -364,33 +1004,72 @@ int main() {
 
           case 'q':
           case 'Q':
-            interactiveMode = false;
+            loop.stop();
             break;
           }
           cout.flush();
         }
+      });
 
-        // Update tracking display
-        uint32_t frame_time;
-        if (trk.update(frame_time)) {
-          double x, y;
-          int id = trk.get_first_id();
-          if (id != -1 && trk.get_pos(id, x, y)) {
-            cout << "Position: (" << fixed << setprecision(3) << x << ", " << y
-                 << ") m | Freq: " << freq << " Hz | Offset: " << offset
-                 << "°   \r";
-            cout.flush();
-          }
+      // Update tracking display
+      bool started = frames.start([&](uint32_t frame_time) {
+        double x = 0, y = 0;
+        int id = trk.get_first_id();
+        bool detected = id != -1 && trk.get_pos(id, x, y);
+        timeline.add_frame(frame_time, detected, x, y);
+        if (detected) {
+          cout << "Position: (" << fixed << setprecision(3) << x << ", " << y
+               << ") m | Freq: " << freq << " Hz | Offset: " << offset
+               << "°   \r";
+          cout.flush();
         }
-
-        Sleep(10); // Small delay to prevent excessive CPU usage
+      });
+      if (!started || !loop.run() || frames.failed()) {
+        cerr << "Error updating tracking data" << endl;
       }
 
       cout << endl << "Interactive mode stopped." << endl;
       regs.set_reg_b(REG8_MODE, IMODE_IDLE);
+      save_timeline(timeline, base);
+      break;
+    }
+
+    case '9':
+      run_sweep(regs, trk, timeline);
+      break;
+
+    case 'o':
+    case 'O':
+      run_optimizer(regs, trk, timeline);
+      break;
+
+    case 'j':
+    case 'J':
+      job_queue(regs, trk, timeline);
+      break;
+
+    case 'l':
+    case 'L':
+      latency_probe(regs, trk);
+      break;
+
+    case 'p':
+    case 'P':
+      profile_monitor(regs);
+      break;
+
+    case 'h':
+    case 'H': {
+      gait_params g = { freq, amplitude, lag, offset };
+      heading_hold(regs, trk, timeline, g);
       break;
     }
 
+    case 'w':
+    case 'W':
+      waypoint_mode(regs, trk, timeline);
+      break;
+
     case '0':
       cout << "Stopping robot (idle mode)..." << endl;
       regs.set_reg_b(REG8_MODE, IMODE_IDLE);
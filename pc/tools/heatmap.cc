@@ -0,0 +1,78 @@
+#include "density.h"
+#include "runindex.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// Default tank dimensions in meters (as in ex6/ex7)
+const double AQUARIUM_WIDTH = 6.0;
+const double AQUARIUM_HEIGHT = 2.0;
+
+static void usage()
+{
+  cerr << "Usage: heatmap <index file> <output.csv> [cell=M] [width=M] [height=M]" << endl;
+  cerr << "               [segments] [threads=N] [query terms...]" << endl;
+  cerr << "  Bins the positions of all the matching runs into a grid and writes the" << endl;
+  cerr << "  occupancy and mean velocity of each cell. With 'segments', the path" << endl;
+  cerr << "  between two samples is rasterized instead of the samples only." << endl;
+  cerr << "  The query terms are the same as for runidx (e.g. lag=0.70~0.02)." << endl;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    usage();
+    return 1;
+  }
+
+  CRunIndex idx;
+  if (!idx.load(argv[1])) {
+    cerr << "Unable to load the run index " << argv[1] << endl;
+    return 1;
+  }
+
+  double cell(0.05), width(AQUARIUM_WIDTH), height(AQUARIUM_HEIGHT);
+  bool segments(false);
+  unsigned int threads(0);
+  run_query q;
+
+  for (int i(3); i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strncmp(arg, "cell=", 5)) cell = atof(arg + 5);
+    else if (!strncmp(arg, "width=", 6)) width = atof(arg + 6);
+    else if (!strncmp(arg, "height=", 7)) height = atof(arg + 7);
+    else if (!strncmp(arg, "threads=", 8)) threads = atoi(arg + 8);
+    else if (!strcmp(arg, "segments")) segments = true;
+    else if (!parse_query_term(arg, q)) {
+      cerr << "Invalid argument: " << arg << endl;
+      usage();
+      return 1;
+    }
+  }
+  if (cell <= 0 || width <= 0 || height <= 0) {
+    cerr << "Invalid grid geometry." << endl;
+    return 1;
+  }
+
+  vector<const run_entry*> runs;
+  idx.query(q, runs);
+  vector<string> files;
+  for (size_t i(0); i < runs.size(); i++) files.push_back(runs[i]->path);
+
+  auto t0 = chrono::steady_clock::now();
+  CDensityGrid grid(width, height, cell);
+  int n = grid.add_files(files, segments, threads);
+  auto t1 = chrono::steady_clock::now();
+
+  if (!grid.write_csv(argv[2])) return 1;
+
+  cerr << n << " run(s) binned into " << grid.size_x() << "x" << grid.size_y()
+       << " cells (" << grid.total_time() << " s of tracking) in "
+       << chrono::duration<double, milli>(t1 - t0).count() << " ms." << endl;
+
+  return 0;
+}
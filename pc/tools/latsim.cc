@@ -0,0 +1,93 @@
+#include "latprobe.h"
+#include "latsim.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+/// Largest number of frames simulated per measured change
+const unsigned int MAX_FRAMES_PER_CHANGE = 1000;
+
+/// Checks an estimated mean against the simulated one, both in us
+static bool check(const char* name, double estimated, double actual, double tolerance)
+{
+  bool ok = fabs(estimated - actual) <= tolerance;
+  printf("%-24s %8.3f ms, simulated %8.3f ms%s\n", name, estimated / 1000, actual / 1000,
+         ok ? "" : "  <- wrong");
+  return ok;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 3) {
+    cerr << "Usage: latsim [changes] [seed]" << endl;
+    cerr << "  Runs the LED latency probe of ex7 against a simulated robot and tracking" << endl;
+    cerr << "  system, and checks that it finds the simulated delays (exit status 1 if not)." << endl;
+    return 1;
+  }
+
+  probe_settings ps;
+  if (argc > 1) ps.repeats = atoi(argv[1]);
+  uint64_t seed = (argc > 2) ? strtoull(argv[2], NULL, 10) : 1;
+  latsim_settings ls;
+
+  CLatencySim sim(ls, seed);
+  CLatencyProbe probe(ps, seed);
+
+  // same sequence as ex7, in simulated time
+  double now = 0;
+  double toggle_at = probe.pause();
+  unsigned int frames(0);
+  while (!probe.done() && frames++ < MAX_FRAMES_PER_CHANGE * ps.repeats) {
+    if (toggle_at >= 0 && toggle_at < sim.next_arrival()) {
+      double acked = sim.set_led(toggle_at, probe.led_value());
+      probe.command(toggle_at, acked);
+      now = acked;
+      toggle_at = -1;
+    }
+    double t;
+    uint32_t frame_time;
+    bool detected;
+    sim.next_frame(t, frame_time, detected);
+    // the frames received during a write are processed after it
+    now = max(now, t);
+    probe.frame(now, frame_time, detected);
+    if (!probe.waiting() && toggle_at < 0) toggle_at = now + probe.pause();
+  }
+
+  probe.print();
+  printf("\n");
+
+  vector<latency_split> l;
+  probe.split(l);
+  const vector<latsim_truth>& truth = sim.truth();
+  if (l.empty() || truth.empty()) {
+    cerr << "No change measured" << endl;
+    return 1;
+  }
+
+  double radio(0), firmware(0), camera(0), total(0);
+  for (size_t i(0); i < l.size(); i++) {
+    radio += l[i].radio / l.size();
+    firmware += l[i].firmware / l.size();
+    camera += l[i].camera / l.size();
+    total += l[i].total / l.size();
+  }
+  double true_radio(0), true_firmware(0), true_camera(0);
+  for (size_t i(0); i < truth.size(); i++) {
+    true_radio += truth[i].radio * 1e6 / truth.size();
+    true_firmware += (truth[i].firmware + truth[i].exposure) * 1e6 / truth.size();
+    true_camera += truth[i].camera * 1e6 / truth.size();
+  }
+
+  // the constant part of the firmware delay goes to the camera (see CLatencyProbe)
+  double margin = 3 * ls.radio_std * 1e6 + 1000;
+  double shift = (ls.led_period + ls.led_write) * 1e6;
+  bool ok = check("Radio", radio, true_radio, margin);
+  ok = check("Firmware and exposure", firmware, true_firmware, shift + margin) && ok;
+  ok = check("Camera and network", camera, true_camera, shift + margin) && ok;
+  ok = check("Total", total, true_radio + true_firmware + true_camera, margin) && ok;
+  return ok ? 0 : 1;
+}
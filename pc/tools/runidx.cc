@@ -0,0 +1,77 @@
+#include "runindex.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static void usage()
+{
+  cerr << "Usage: runidx <index file> scan <directory>..." << endl;
+  cerr << "       runidx <index file> query [freq=R] [amp=R] [lag=R] [off=R] [date=D]" << endl;
+  cerr << "  R is either min:max or value~tolerance (e.g. lag=0.70~0.02)" << endl;
+  cerr << "  D is from:to, with dates as YYYY-MM-DD[-hh[-mm[-ss]]] (e.g. date=2025-04-07:)" << endl;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    usage();
+    return 1;
+  }
+
+  const char* index_file = argv[1];
+  CRunIndex idx;
+  idx.load(index_file);
+
+  if (!strcmp(argv[2], "scan")) {
+    int total(0);
+    for (int i(3); i < argc; i++) {
+      int n = idx.scan(argv[i]);
+      if (n < 0) return 1;
+      total += n;
+    }
+    int pruned = idx.prune();
+    if (total > 0 || pruned > 0) {
+      if (!idx.save(index_file)) return 1;
+    }
+    cout << total << " run(s) indexed, " << pruned << " removed, " << idx.size()
+         << " in the catalog." << endl;
+    return 0;
+  }
+
+  if (strcmp(argv[2], "query")) {
+    usage();
+    return 1;
+  }
+
+  run_query q;
+  for (int i(3); i < argc; i++) {
+    if (!parse_query_term(argv[i], q)) {
+      cerr << "Invalid query term: " << argv[i] << endl;
+      usage();
+      return 1;
+    }
+  }
+
+  auto t0 = chrono::steady_clock::now();
+  vector<const run_entry*> res;
+  idx.query(q, res);
+  auto t1 = chrono::steady_clock::now();
+
+  cout << "date\t\tfreq\tamp\tlag\toff\tspeed\tduration\tfile" << endl;
+  for (size_t i(0); i < res.size(); i++) {
+    const run_entry& e = *res[i];
+    cout << e.info.stamp << "\t" << fixed << setprecision(3) << e.info.freq << "\t"
+         << e.info.amp << "\t" << e.info.lag << "\t" << e.info.off << "\t";
+    if (std::isnan(e.sum.speed)) cout << "-"; else cout << e.sum.speed;
+    cout << "\t" << e.sum.duration << "\t\t" << e.path << endl;
+  }
+  cerr << res.size() << " of " << idx.size() << " run(s) matched in "
+       << chrono::duration<double, micro>(t1 - t0).count() << " us." << endl;
+
+  return 0;
+}
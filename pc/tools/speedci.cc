@@ -0,0 +1,117 @@
+#include "bootstrap.h"
+#include "runindex.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+
+using namespace std;
+
+static void usage()
+{
+  cerr << "Usage: speedci <index file> [by=freq|amp|lag|off] [resamples=N] [threads=N]" << endl;
+  cerr << "               [level=L] [seed=S] [query terms...]" << endl;
+  cerr << "  Groups the indexed runs by a gait parameter and prints the bootstrap" << endl;
+  cerr << "  confidence interval of the mean speed of each group, followed by the" << endl;
+  cerr << "  pairwise speed differences and Hedges' g effect sizes." << endl;
+  cerr << "  The query terms are the same as for runidx (e.g. freq=0.8~0.05)." << endl;
+}
+
+static float group_key(const run_info& r, const string& by)
+{
+  float v;
+  if (by == "freq") v = r.freq;
+  else if (by == "amp") v = r.amp;
+  else if (by == "off") v = r.off;
+  else v = r.lag;
+  // the parameters are logged with 6 decimals after an 8-bit encoding, so
+  // rounding to 3 decimals merges the runs done with the same setting
+  return roundf(v * 1000.0f) / 1000.0f;
+}
+
+static void print_ci(const ci_result& r)
+{
+  cout << r.value << "\t" << r.lo << "\t" << r.hi;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    usage();
+    return 1;
+  }
+
+  CRunIndex idx;
+  if (!idx.load(argv[1])) {
+    cerr << "Unable to load the run index " << argv[1] << endl;
+    return 1;
+  }
+
+  string by("lag");
+  unsigned int resamples(10000), threads(0);
+  uint64_t seed(1);
+  double level(0.95);
+  run_query q;
+
+  for (int i(2); i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strncmp(arg, "by=", 3)) by = arg + 3;
+    else if (!strncmp(arg, "resamples=", 10)) resamples = atoi(arg + 10);
+    else if (!strncmp(arg, "threads=", 8)) threads = atoi(arg + 8);
+    else if (!strncmp(arg, "level=", 6)) level = atof(arg + 6);
+    else if (!strncmp(arg, "seed=", 5)) seed = strtoull(arg + 5, NULL, 10);
+    else if (!parse_query_term(arg, q)) {
+      cerr << "Invalid argument: " << arg << endl;
+      usage();
+      return 1;
+    }
+  }
+
+  vector<const run_entry*> runs;
+  idx.query(q, runs);
+
+  map<float, vector<double> > groups;
+  for (size_t i(0); i < runs.size(); i++) {
+    if (!std::isnan(runs[i]->sum.speed)) {
+      groups[group_key(runs[i]->info, by)].push_back(runs[i]->sum.speed);
+    }
+  }
+  if (groups.empty()) {
+    cerr << "No run with a valid speed matches the query." << endl;
+    return 1;
+  }
+
+  auto t0 = chrono::steady_clock::now();
+  CBootstrap bs(resamples, threads, seed);
+
+  cout << fixed << setprecision(4);
+  cout << by << "\tn\tmean\tlo\thi" << endl;
+  for (map<float, vector<double> >::const_iterator it = groups.begin(); it != groups.end(); ++it) {
+    cout << it->first << "\t" << it->second.size() << "\t";
+    print_ci(bs.mean_ci(it->second, level));
+    cout << endl;
+  }
+
+  cout << endl << by << "_a\t" << by << "_b\tdiff\tlo\thi\tg\tg_lo\tg_hi" << endl;
+  for (map<float, vector<double> >::const_iterator a = groups.begin(); a != groups.end(); ++a) {
+    map<float, vector<double> >::const_iterator b = a;
+    for (++b; b != groups.end(); ++b) {
+      cout << a->first << "\t" << b->first << "\t";
+      print_ci(bs.diff_ci(a->second, b->second, level));
+      cout << "\t";
+      print_ci(bs.hedges_g_ci(a->second, b->second, level));
+      cout << endl;
+    }
+  }
+
+  auto t1 = chrono::steady_clock::now();
+  cerr << runs.size() << " run(s) in " << groups.size() << " group(s), " << resamples
+       << " resamples on " << bs.thread_count() << " thread(s) in "
+       << chrono::duration<double, milli>(t1 - t0).count() << " ms." << endl;
+
+  return 0;
+}
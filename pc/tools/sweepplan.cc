@@ -0,0 +1,37 @@
+#include "sweep.h"
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+int main(int argc, char** argv)
+{
+  if (argc < 2 || argc > 3) {
+    cerr << "Usage: sweepplan <sweep spec> [progress file]" << endl;
+    cerr << "  Lists the trials of a sweep, as run by ex7, with the values actually" << endl;
+    cerr << "  sent to the robot and, if a progress file is given, their status." << endl;
+    return 1;
+  }
+
+  sweep_spec spec;
+  if (!load_sweep_spec(argv[1], spec)) return 1;
+
+  vector<gait_params> trials;
+  plan_sweep(spec, trials);
+
+  CSweepProgress progress;
+  if (argc == 3 && !progress.open(argv[2], trials, true)) return 1;
+
+  printf("trial\tfreq\tamp\tlag\toff\tstatus\n");
+  for (size_t i(0); i < trials.size(); i++) {
+    gait_params q = quantize_gait(trials[i]);
+    printf("%u\t%.3f\t%.3f\t%.3f\t%.3f\t%s\n", (unsigned int) i, q.freq, q.amp, q.lag, q.off,
+           progress.is_done(i) ? "done" : "-");
+  }
+
+  double t = trials.size() * (spec.duration + spec.settle);
+  cerr << trials.size() << " trial(s), " << progress.completed() << " done, about "
+       << (int) (t / 60 + 0.5) << " min in total." << endl;
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include "timeline.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static void usage()
+{
+  cerr << "Usage: tlquery <timeline.tln> csv <output.csv>" << endl;
+  cerr << "       tlquery <timeline.tln> effects <register> [before=MS] [after=MS]" << endl;
+  cerr << "               [window=MS] [threshold=M/S]" << endl;
+  cerr << "  'csv' exports all the events of a timeline recorded by ex7." << endl;
+  cerr << "  'effects' lists each write to a register with the speed of the robot" << endl;
+  cerr << "  before and after it, and the time until the speed changed by more than" << endl;
+  cerr << "  the threshold (e.g. 'effects 13' for the offset changes)." << endl;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 4) {
+    usage();
+    return 1;
+  }
+
+  CTimeline tl;
+  if (!tl.load(argv[1])) return 1;
+
+  if (!strcmp(argv[2], "csv")) {
+    if (!tl.write_csv(argv[3])) return 1;
+    cerr << tl.size() << " event(s) written." << endl;
+    return 0;
+  }
+
+  if (strcmp(argv[2], "effects")) {
+    usage();
+    return 1;
+  }
+
+  int addr = atoi(argv[3]);
+  effect_query q;
+  for (int i(4); i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strncmp(arg, "before=", 7)) q.before = atoi(arg + 7) * 1000LL;
+    else if (!strncmp(arg, "after=", 6)) q.after = atoi(arg + 6) * 1000LL;
+    else if (!strncmp(arg, "window=", 7)) q.window = atoi(arg + 7) * 1000LL;
+    else if (!strncmp(arg, "threshold=", 10)) q.threshold = atof(arg + 10);
+    else {
+      cerr << "Invalid argument: " << arg << endl;
+      usage();
+      return 1;
+    }
+  }
+
+  vector<command_effect> eff;
+  tl.command_effects(addr, q, eff);
+
+  printf("time [s]\told\tnew\tv before\tv after\tlatency [ms]\n");
+  for (size_t i(0); i < eff.size(); i++) {
+    const command_effect& c = eff[i];
+    printf("%.3f\t\t%u\t%u\t%.3f\t\t%.3f\t", c.t / 1e6, c.old_value, c.new_value,
+           c.speed_before, c.speed_after);
+    if (c.latency >= 0) printf("%.0f\n", c.latency / 1e3); else printf("-\n");
+  }
+  cerr << eff.size() << " write(s) to register " << addr << "." << endl;
+
+  return 0;
+}
@@ -0,0 +1,64 @@
+#include "runlog.h"
+#include "trkcodec.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+
+using namespace std;
+
+static bool has_ext(const string& s, const char* ext)
+{
+  return s.size() > 4 && s.compare(s.size() - 4, 4, ext) == 0;
+}
+
+static long file_size(const string& s)
+{
+  struct stat st;
+  return stat(s.c_str(), &st) == 0 ? (long) st.st_size : -1;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc != 3 || !(has_ext(argv[2], ".trk") || has_ext(argv[2], ".csv"))) {
+    cerr << "Usage: trkconv <input.csv|input.trk> <output.trk|output.csv>" << endl;
+    cerr << "  Converts a tracking log between the CSV and the encoded formats." << endl;
+    return 1;
+  }
+  string in(argv[1]), out(argv[2]);
+
+  vector<track_sample> samples;
+  vector<track_event> events;
+  if (!load_run_log(in, samples, &events)) {
+    cerr << "Unable to read " << in << endl;
+    return 1;
+  }
+
+  string base = out.substr(0, out.size() - 4);
+  CRunLogger log;
+  auto t0 = chrono::steady_clock::now();
+  if (!log.open(base, has_ext(out, ".trk"))) return 1;
+
+  // merges the events back at their place in time
+  size_t j(0);
+  for (size_t i(0); i < samples.size(); i++) {
+    for (; j < events.size() && events[j].t <= samples[i].t; j++) {
+      log.add_event(events[j].t, events[j].code);
+    }
+    log.add(samples[i]);
+  }
+  for (; j < events.size(); j++) log.add_event(events[j].t, events[j].code);
+  if (!log.close()) {
+    cerr << "Error while writing " << out << endl;
+    return 1;
+  }
+  auto t1 = chrono::steady_clock::now();
+
+  double s = chrono::duration<double>(t1 - t0).count();
+  cout << samples.size() << " samples: " << file_size(in) << " -> " << file_size(out)
+       << " bytes in " << s * 1000 << " ms (" << (s > 0 ? samples.size() / s : 0)
+       << " samples/s)." << endl;
+
+  return 0;
+}
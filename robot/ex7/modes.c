@@ -1,9 +1,14 @@
+#include "can.h"
+#include "cantrans.h"
 #include "config.h"
 #include "hardware.h"
 #include "modes.h"
 #include "module.h"
+#include "cpg.h"
 #include "registers.h"
 #include "robot.h"
+#include "timerISR.h"
+#include "profile.h"
 
 // Define registers for frequency and amplitude control
 #define REG8_SINE_FREQ 10 // Register for sine wave frequency
@@ -32,18 +37,92 @@
 #define DEFAULT_LAG 0.75f // Default amplitude in degrees
 #define DEFAULT_OFF 0.0f // Default amplitude in degrees
 
-
-const uint8_t MOTOR_ADDR_HEAD = 25; // Motor address (this is the second element, the first is the head that is actuated by this one)
-const uint8_t MOTOR_ADDR_NECK = 22; // Motor address
-const uint8_t MOTOR_ADDR_TORSO = 24; // Motor address
-const uint8_t MOTOR_ADDR_HIP = 26; // Motor address
-const uint8_t MOTOR_ADDR_TAIL = 5; // Motor address
+// Send the setpoints of swim_mode in group frames of CAN_GROUP_SLOTS joints,
+// which the modules do not acknowledge, instead of one acknowledged write per
+// joint. Only the head side is in this tree: the modules must take their
+// slot out of the group frames (MREG_GROUP registers, see can.h), which only
+// the simulated modules of host/hostcan.c do so far. When a module does not
+// hold its group after joining, swim_mode falls back to the writes.
+#define GROUP_SETPOINTS 0
+#define SWIM_GROUP 1 // First group, the next ones follow for more joints
+#define GROUP_TIMEOUT (256 * CAN_TIMEOUT) // Timeout of the group read back
+
+// Dynamics of the wave generator
+#define CPG_COUPLING 5.0f // Coupling between neighbour joints in 1/s
+#define CPG_RATE 2.0f // Convergence rate of the parameters in 1/s
+
+// Time the parameters must stay unchanged before the generators of
+// swim_gen_mode restart, as the PC writes them one after the other
+#define GEN_SETTLE (50 * ONE_MS)
+
+// Control tick of swim_mode, counted by a timer1 user function
+#define DEFAULT_RATE 200 // Default tick rate in Hz
+#define TIMER1_RATE (1000000 / TIMER1_PERIOD) // Timer1 interrupts per second
+#define TICK_POLL 100 // Wait between two checks of the tick in sysTICs (10 us)
+#define TICK_TICS(div) ((uint32_t) (div) * TIMER1_PERIOD * (sysTICSperSEC / 1000000))
+#if TIMER1_PERIOD > 1000000 / DEFAULT_RATE
+#error "timer1 too slow for the control tick, see OPTIONS in the Makefile"
+#endif
+
+// Registers of the control tick (16 bits), to find the fastest rate that
+// the bus sustains: a write of the rate restarts the tick and clears the
+// statistics, as does a write of the overruns
+#define REG16_TICK_RATE 20     // Tick rate in Hz, rounded to whole timer1 periods
+#define REG16_TICK_PERIOD 21   // Mean period of the ticks over the last second in us
+#define REG16_TICK_JITTER 22   // Largest deviation of a period from the nominal one in us
+#define REG16_TICK_OVERRUNS 23 // Ticks missed because the loop was still busy
+
+
+// A joint of the body
+struct joint {
+  uint8_t addr;     // Motor address
+  float envelope;   // Amplitude relative to the amplitude register
+  float phase;      // Phase added to the wave in turns
+  int8_t direction; // 1, or -1 for a module mounted the other way
+  int8_t ready;     // Angle of the ready position in degrees
+};
+
+// Body of the robot, from the tail to the head: the wave travels towards
+// the tail, the phase growing by lag / JOINTS from one joint to the next.
+// The same code drives any body of up to CPG_MAX_OSC modules.
+static const struct joint body[] = {
+  { 5, 1.0f, 0.0f, 1, 40 },   // Tail
+  { 26, 1.0f, 0.0f, 1, -40 }, // Hip
+  { 24, 1.0f, 0.0f, 1, -40 }, // Torso
+  { 22, 1.0f, 0.0f, 1, 40 },  // Neck
+  { 25, 1.0f, 0.0f, 1, 40 },  // Head (this is the second element, the first is the head that is actuated by this one)
+};
+
+#define JOINTS (sizeof(body) / sizeof(body[0]))
 
 uint8_t freq_enc = DEFAULT_FREQ;
 uint8_t amp_enc = DEFAULT_AMP;
 uint8_t lag_enc = DEFAULT_LAG;
 uint8_t off_enc = DEFAULT_OFF;
 
+static volatile uint16_t tick_div = TIMER1_RATE / DEFAULT_RATE; // Timer1 interrupts per tick
+static volatile uint32_t ticks = 0; // Ticks counted by the timer
+static volatile uint8_t tick_clear = FALSE; // Set to clear the statistics
+
+// Statistics of the tick, from the times the setpoints are sent. A timer1
+// interrupt lost while I2C or the A/D converter mask them delays the tick
+// by one timer1 period, which shows as jitter.
+struct tick_stats {
+  uint32_t last;     // Time of the last tick in sysTICs
+  uint32_t sum;      // Sum of the periods of the current window in sysTICs
+  uint16_t n;        // Ticks in the current window
+  uint16_t period;   // Mean period of the last window in us
+  uint16_t jitter;   // Largest deviation of a period in us
+  uint16_t overruns; // Ticks missed
+  uint8_t started;   // FALSE until a first tick gives the time
+};
+
+static struct tick_stats stats;
+
+#if GROUP_SETPOINTS
+static uint8_t group_ok = FALSE; // All the modules joined their group
+#endif
+
 static int8_t register_handler(uint8_t operation, uint8_t address,
                                RadioData *radio_data) {
 
@@ -98,6 +177,51 @@ static int8_t register_handler(uint8_t operation, uint8_t address,
 
 }
 
+static int8_t tick_register_handler(uint8_t operation, uint8_t address,
+                                    RadioData *radio_data) {
+  uint16_t rate;
+
+  switch (address) {
+    case REG16_TICK_RATE:
+      switch (operation) {
+      case ROP_READ_16:
+        radio_data->word = TIMER1_RATE / tick_div;
+        return TRUE;
+      case ROP_WRITE_16:
+        rate = radio_data->word;
+        if (rate > TIMER1_RATE)
+          rate = TIMER1_RATE;
+        if (rate > 0)
+          tick_div = (TIMER1_RATE + rate / 2) / rate;
+        return TRUE;
+      }
+      break;
+    case REG16_TICK_PERIOD:
+      if (operation == ROP_READ_16) {
+        radio_data->word = stats.period;
+        return TRUE;
+      }
+      break;
+    case REG16_TICK_JITTER:
+      if (operation == ROP_READ_16) {
+        radio_data->word = stats.jitter;
+        return TRUE;
+      }
+      break;
+    case REG16_TICK_OVERRUNS:
+      switch (operation) {
+      case ROP_READ_16:
+        radio_data->word = stats.overruns;
+        return TRUE;
+      case ROP_WRITE_16:
+        tick_clear = TRUE;
+        return TRUE;
+      }
+      break;
+  }
+  return FALSE;
+}
+
 // Function to initialize default parameters
 void init_sine_params(void) {
   // Set default values for frequency and amplitude
@@ -107,137 +231,325 @@ void init_sine_params(void) {
   off_enc = ENCODE_PARAM_8(DEFAULT_OFF, MIN_OFF, MAX_OFF);
 }
 
-void swim_mode(void) {
-  uint32_t dt, cycletimer;
-  float my_time, delta_t, angle0, angle1, angle2, angle3, angle4;
+// Decodes the parameter registers, if they changed since the last call (last
+// holds their previous values, 0xFFFF at first), returns TRUE if they did
+static uint8_t read_params(uint16_t* last, float* freq, float* amplitude, float* lag,
+                           float* offset) {
+  if (last[0] == freq_enc && last[1] == amp_enc && last[2] == lag_enc && last[3] == off_enc)
+    return FALSE;
+  last[0] = freq_enc;
+  last[1] = amp_enc;
+  last[2] = lag_enc;
+  last[3] = off_enc;
+
+  // Decode current parameters from registers
+  *freq = DECODE_PARAM_8(freq_enc, MIN_FREQ, MAX_FREQ);
+  *amplitude = DECODE_PARAM_8(amp_enc, MIN_AMP, MAX_AMP);
+  *lag = DECODE_PARAM_8(lag_enc, MIN_LAG, MAX_LAG);
+  *offset = DECODE_PARAM_8(off_enc, MIN_OFF, MAX_OFF);
+
+  // Apply limits to ensure safety
+  if (*freq > MAX_FREQ)
+    *freq = MAX_FREQ;
+  if (*amplitude > MAX_AMP)
+    *amplitude = MAX_AMP;
+  if (*lag > MAX_LAG)
+    *lag = MAX_LAG;
+  if (*offset > MAX_OFF)
+    *offset = MAX_OFF;
+  return TRUE;
+}
+
+// Sets the targets of the wave from the parameter registers, if they changed:
+// the per-joint targets are only computed here, not at each tick
+static void update_wave(struct cpg* wave, uint16_t* last) {
   float freq, amplitude, lag, offset;
-  int8_t angle0_rounded, angle1_rounded, angle2_rounded, angle3_rounded, angle4_rounded;
+  uint8_t i;
+
+  if (!read_params(last, &freq, &amplitude, &lag, &offset))
+    return;
+
+  // The offset bends every joint the same way, which steers the robot
+  cpg_set(wave, freq, lag / JOINTS);
+  for (i = 0; i < JOINTS; i++) {
+    cpg_set_joint(wave, i, amplitude * BODY_OUTPUT_RATIO_DEG * body[i].envelope * body[i].direction,
+                  offset * BODY_OUTPUT_RATIO_DEG * body[i].direction, body[i].phase);
+  }
+}
+
+// Programs the internal generators of the modules and starts them in turn,
+// each when the wave reaches the phase of its joint, so that they run in step
+// with the lag between them. The generators restart at phase zero: the wave
+// is continuous only between two changes of the parameters.
+static void start_generators(float freq, float amplitude, float lag, float offset) {
+  uint32_t delay[JOINTS], period_tics, t0, phase;
+  uint8_t order[JOINTS], period, i, j, k;
+  float p, amp, off;
+
+  // Period in the unit of the generators, within the 8 bits of their register
+  p = 1 / (freq * INT_GEN_PERIOD_UNIT) + 0.5f;
+  period = (p > 255) ? 255 : (p < 1) ? 1 : p;
+  period_tics = period * (uint32_t) (INT_GEN_PERIOD_UNIT * sysTICSperSEC + 0.5f);
+
+  for (i = 0; i < JOINTS; i++) {
+    amp = amplitude * BODY_OUTPUT_RATIO_DEG * body[i].envelope;
+    off = offset * BODY_OUTPUT_RATIO_DEG * body[i].direction;
+    bus_set(body[i].addr, MREG_SETPOINT_SOURCE, SETPOINT_SRC_I2C);
+    set_int_gen(body[i].addr, period, (amp > 127) ? 127 : amp,
+                (off > 127) ? 127 : (off < -127) ? -127 : off);
+
+    // a joint of phase p starts (1 - p) period after phase zero, a joint
+    // mounted the other way half a period later
+    phase = (uint32_t) (int64_t) (-(i * lag / JOINTS + body[i].phase) * 4294967296.0);
+    if (body[i].direction < 0)
+      phase += 0x80000000UL;
+    delay[i] = ((uint64_t) phase * period_tics) >> 32;
+
+    // order of the starts
+    for (j = i; j > 0 && delay[order[j - 1]] > delay[i]; j--)
+      order[j] = order[j - 1];
+    order[j] = i;
+  }
+
+  t0 = getSysTICs();
+  for (k = 0; k < JOINTS; k++) {
+    while (getElapsedSysTICs(t0) < delay[order[k]]);
+    bus_set(body[order[k]].addr, MREG_SETPOINT_SOURCE, SETPOINT_SRC_SINUS);
+  }
+}
+
+static void tick_isr(void) {
+  ticks++;
+}
+
+// (Re)starts the tick, every div timer1 interrupts
+static void start_tick(uint16_t div) {
+  uint32_t irqs = disable_timer1_irq();
+
+  timer1_remove_user_function(tick_isr);
+  timer1_add_user_function(tick_isr, div);
+  restore_timer1_irq(irqs);
+  tick_clear = TRUE;
+}
+
+// Waits for the next tick and updates the statistics, returns the number of
+// ticks since the last call (more than one if the loop overran)
+static uint32_t wait_tick(uint32_t* served, uint16_t div) {
+  uint32_t n, now, period, nominal, dev;
+
+  while (ticks == *served)
+    pause(TICK_POLL);
+  now = getSysTICs();
+  n = ticks - *served;
+  *served += n;
+
+  if (tick_clear) {
+    tick_clear = FALSE;
+    stats.sum = 0;
+    stats.n = 0;
+    stats.period = 0;
+    stats.jitter = 0;
+    stats.overruns = 0;
+    stats.started = FALSE;
+  }
+
+  if (n > 1)
+    stats.overruns = (stats.overruns + n - 1 > 0xFFFF) ? 0xFFFF : stats.overruns + n - 1;
+
+  if (stats.started) {
+    period = now - stats.last;
+    nominal = n * TICK_TICS(div);
+    dev = (period > nominal) ? period - nominal : nominal - period;
+    dev = dev / (sysTICSperSEC / 1000000);
+    if (dev > stats.jitter)
+      stats.jitter = (dev > 0xFFFF) ? 0xFFFF : dev;
+
+    // Mean period over about one second of ticks
+    stats.sum += period;
+    stats.n += n;
+    if (stats.n >= TIMER1_RATE / div) {
+      stats.period = stats.sum / stats.n / (sysTICSperSEC / 1000000);
+      stats.sum = 0;
+      stats.n = 0;
+    }
+  }
+  stats.last = now;
+  stats.started = TRUE;
+  return n;
+}
+
+// Sends the setpoints of all the joints
+static void send_setpoints(const int8_t* angle) {
+  uint8_t i;
+
+#if GROUP_SETPOINTS
+  if (group_ok) {
+    for (i = 0; i < JOINTS; i += CAN_GROUP_SLOTS)
+      can_group_setpoints(SWIM_GROUP + i / CAN_GROUP_SLOTS, angle + i, JOINTS - i);
+    return;
+  }
+#endif
+  for (i = 0; i < JOINTS; i++)
+    bus_set(body[i].addr, MREG_SETPOINT, angle[i]);
+}
+
+// Initializes and starts the PID controllers of the motors
+static void start_body(void) {
+  uint8_t i;
+#if GROUP_SETPOINTS
+  int8_t h[JOINTS];
+#endif
+
+  for (i = 0; i < JOINTS; i++)
+    init_body_module(body[i].addr);
+  for (i = 0; i < JOINTS; i++)
+    start_pid(body[i].addr);
+  for (i = 0; i < JOINTS; i++)
+    set_reg_value_dw(body[i].addr, MREG32_LED, 0);
+#if GROUP_SETPOINTS
+  // A module with an older firmware may acknowledge the writes without
+  // taking the group: read it back from all the modules at once (the reads
+  // time out if the modules do not answer to the tags, see cantrans.h, and
+  // the setpoints are then written one by one)
+  group_ok = TRUE;
+  for (i = 0; i < JOINTS; i++)
+    if (!can_group_join(body[i].addr, SWIM_GROUP + i / CAN_GROUP_SLOTS, i % CAN_GROUP_SLOTS))
+      group_ok = FALSE;
+  for (i = 0; i < JOINTS; i++)
+    h[i] = can_trans_read(body[i].addr, MREG_GROUP, 1, GROUP_TIMEOUT, 0);
+  for (i = 0; i < JOINTS; i++) {
+    if (h[i] < 0) {
+      group_ok = FALSE;
+      continue;
+    }
+    if (can_trans_wait(h[i]) != CT_DONE
+        || can_trans_value(h[i]) != (uint32_t) (SWIM_GROUP + i / CAN_GROUP_SLOTS))
+      group_ok = FALSE;
+    can_trans_release(h[i]);
+  }
+#endif
+}
+
+// Returns the motors to zero and stops them
+static void stop_body(void) {
+  uint8_t i;
+
+  for (i = 0; i < JOINTS; i++)
+    bus_set(body[i].addr, MREG_SETPOINT, 0);
+
+  pause(ONE_SEC); // Give the motor time to return to center
+
+  for (i = 0; i < JOINTS; i++)
+    bus_set(body[i].addr, MREG_MODE, MODE_IDLE);
+}
+
+void swim_mode(void) {
+  uint32_t served, n;
+  struct cpg wave;
+  int8_t angle[JOINTS];
+  uint16_t last[4] = { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF };
+  uint16_t div;
 
   // Initialize and start the motor's PID controller
-  init_body_module(MOTOR_ADDR_HEAD);
-  init_body_module(MOTOR_ADDR_NECK);
-  init_body_module(MOTOR_ADDR_TORSO);
-  init_body_module(MOTOR_ADDR_HIP);
-  init_body_module(MOTOR_ADDR_TAIL);
-
-  start_pid(MOTOR_ADDR_HEAD);
-  start_pid(MOTOR_ADDR_NECK);
-  start_pid(MOTOR_ADDR_TORSO);
-  start_pid(MOTOR_ADDR_HIP);
-  start_pid(MOTOR_ADDR_TAIL);
-
-  set_reg_value_dw(MOTOR_ADDR_HEAD, MREG32_LED, 0);
-  set_reg_value_dw(MOTOR_ADDR_NECK, MREG32_LED, 0);
-  set_reg_value_dw(MOTOR_ADDR_TORSO, MREG32_LED, 0);
-  set_reg_value_dw(MOTOR_ADDR_HIP, MREG32_LED, 0);
-  set_reg_value_dw(MOTOR_ADDR_TAIL, MREG32_LED, 0);
+  start_body();
 
   // Set visual indicator that motor is active
   set_color(4); // Set LED to red
 
-  // Initialize sine wave time
-  cycletimer = getSysTICs();
-  my_time = 0;
+  // Start the wave at rest, it grows towards the parameters set below
+  cpg_init(&wave, JOINTS, CPG_COUPLING, CPG_RATE);
+  update_wave(&wave, last);
+  cpg_outputs(&wave, angle);
+
+  div = tick_div;
+  start_tick(div);
+  served = ticks;
 
   do {
-    // Decode current parameters from registers
-    freq = DECODE_PARAM_8(freq_enc, MIN_FREQ, MAX_FREQ);
-    amplitude = DECODE_PARAM_8(amp_enc, MIN_AMP, MAX_AMP);
-    lag = DECODE_PARAM_8(lag_enc, MIN_LAG, MAX_LAG);
-    offset = DECODE_PARAM_8(off_enc, MIN_OFF, MAX_OFF);
-
-    // Apply limits to ensure safety
-    if (freq > MAX_FREQ)
-      freq = MAX_FREQ;
-    if (amplitude > MAX_AMP)
-      amplitude = MAX_AMP;
-    if (lag > MAX_LAG)
-      lag = MAX_LAG;
-    if (offset > MAX_OFF)
-      offset = MAX_OFF;
-
-    // Calculate elapsed time
-    dt = getElapsedSysTICs(cycletimer);
-    cycletimer = getSysTICs();
-    delta_t = (float)dt / sysTICSperSEC;
-    my_time += delta_t;
-
-    // Calculate the sine wave for motor angle
-    angle0 = amplitude * sin(M_TWOPI * ((freq * my_time)+(0*lag/5)+offset));
-    angle1 = amplitude * sin(M_TWOPI * ((freq * my_time)+(1*lag/5)+offset));
-    angle2 = amplitude * sin(M_TWOPI * ((freq * my_time)+(2*lag/5)+offset));
-    angle3 = amplitude * sin(M_TWOPI * ((freq * my_time)+(3*lag/5)+offset));
-    angle4 = amplitude * sin(M_TWOPI * ((freq * my_time)+(4*lag/5)+offset));
-
-    // Convert angle to motor units
-    angle0_rounded = DEG_TO_OUTPUT_BODY(angle0);
-    angle1_rounded = DEG_TO_OUTPUT_BODY(angle1);
-    angle2_rounded = DEG_TO_OUTPUT_BODY(angle2);
-    angle3_rounded = DEG_TO_OUTPUT_BODY(angle3);
-    angle4_rounded = DEG_TO_OUTPUT_BODY(angle4);
-
-    // Send the angle to the motor
-    bus_set(MOTOR_ADDR_HEAD, MREG_SETPOINT, angle4_rounded);
-    bus_set(MOTOR_ADDR_NECK, MREG_SETPOINT, angle3_rounded);
-    bus_set(MOTOR_ADDR_TORSO, MREG_SETPOINT, angle2_rounded);
-    bus_set(MOTOR_ADDR_HIP, MREG_SETPOINT, angle1_rounded);
-    bus_set(MOTOR_ADDR_TAIL, MREG_SETPOINT, angle0_rounded);
+    // Send the setpoints computed in advance as soon as the tick comes, so
+    // that the time they leave does not depend on the computation
+    n = wait_tick(&served, div);
+    send_setpoints(angle);
+
+    // Then compute those of the next tick, catching up the ticks missed
+    {
+      PROF_START(t0);
+      update_wave(&wave, last);
+      cpg_advance(&wave, n * TICK_TICS(div));
+      cpg_outputs(&wave, angle);
+      PROF_END(PROF_GAIT, t0);
+    }
 
     set_rgb(255, 255, 255);
 
-    // Small delay to ensure timer updates properly
-    pause(ONE_MS);
+    // A new rate written from the radio restarts the tick
+    if (tick_div != div) {
+      div = tick_div;
+      start_tick(div);
+      served = ticks;
+    }
 
   } while (reg8_table[REG8_MODE] == IMODE_SWIM);
 
-  // Clean up: return motor to zero position
-  bus_set(MOTOR_ADDR_HEAD, MREG_SETPOINT, 0);
-  bus_set(MOTOR_ADDR_NECK, MREG_SETPOINT, 0);
-  bus_set(MOTOR_ADDR_TORSO, MREG_SETPOINT, 0);
-  bus_set(MOTOR_ADDR_HIP, MREG_SETPOINT, 0);
-  bus_set(MOTOR_ADDR_TAIL, MREG_SETPOINT, 0);
+  timer1_remove_user_function(tick_isr);
 
-  pause(ONE_SEC); // Give the motor time to return to center
+  // Clean up: return motor to zero position and stop it
+  stop_body();
 
-  // Stop the motor
-  bus_set(MOTOR_ADDR_HEAD, MREG_MODE, MODE_IDLE);
-  bus_set(MOTOR_ADDR_NECK, MREG_MODE, MODE_IDLE);
-  bus_set(MOTOR_ADDR_TORSO, MREG_MODE, MODE_IDLE);
-  bus_set(MOTOR_ADDR_HIP, MREG_MODE, MODE_IDLE);
-  bus_set(MOTOR_ADDR_TAIL, MREG_MODE, MODE_IDLE);
+  // Return LED to normal state
+  set_color(2);
+}
+
+void swim_gen_mode(void) {
+  float freq, amplitude, lag, offset;
+  uint16_t last[4] = { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF };
+  uint32_t seen = 0xFFFFFFFF, enc, changed;
+  uint8_t i;
+
+  // Initialize and start the motor's PID controller
+  start_body();
+
+  // Set visual indicator that motor is active
+  set_color(4); // Set LED to red
+
+  changed = getSysTICs();
+  do {
+    // The modules generate the wave: the bus is only used when the
+    // parameters change. Each restart takes the joints back to phase zero,
+    // so they restart once the registers have settled, not once per write.
+    enc = ((uint32_t) freq_enc << 24) | ((uint32_t) amp_enc << 16) | (lag_enc << 8) | off_enc;
+    if (enc != seen) {
+      seen = enc;
+      changed = getSysTICs();
+    } else if (getElapsedSysTICs(changed) >= GEN_SETTLE
+               && read_params(last, &freq, &amplitude, &lag, &offset)) {
+      start_generators(freq, amplitude, lag, offset);
+    }
+
+    pause(ONE_MS);
+
+  } while (reg8_table[REG8_MODE] == IMODE_SWIM_GEN);
+
+  // Clean up: stop the generators, return motor to zero position and stop it
+  for (i = 0; i < JOINTS; i++)
+    bus_set(body[i].addr, MREG_SETPOINT_SOURCE, SETPOINT_SRC_I2C);
+  stop_body();
 
   // Return LED to normal state
   set_color(2);
 }
 
 void ready_mode(void) {
+  uint8_t i;
+
   // Initialize and start the motor's PID controller
-  init_body_module(MOTOR_ADDR_HEAD);
-  init_body_module(MOTOR_ADDR_NECK);
-  init_body_module(MOTOR_ADDR_TORSO);
-  init_body_module(MOTOR_ADDR_HIP);
-  init_body_module(MOTOR_ADDR_TAIL);
-
-  start_pid(MOTOR_ADDR_HEAD);
-  start_pid(MOTOR_ADDR_NECK);
-  start_pid(MOTOR_ADDR_TORSO);
-  start_pid(MOTOR_ADDR_HIP);
-  start_pid(MOTOR_ADDR_TAIL);
-
-  set_reg_value_dw(MOTOR_ADDR_HEAD, MREG32_LED, 0);
-  set_reg_value_dw(MOTOR_ADDR_NECK, MREG32_LED, 0);
-  set_reg_value_dw(MOTOR_ADDR_TORSO, MREG32_LED, 0);
-  set_reg_value_dw(MOTOR_ADDR_HIP, MREG32_LED, 0);
-  set_reg_value_dw(MOTOR_ADDR_TAIL, MREG32_LED, 0);
+  start_body();
   set_rgb(255, 255, 255);
 
 
   // Send the angle to the motor
-  bus_set(MOTOR_ADDR_HEAD, MREG_SETPOINT, DEG_TO_OUTPUT_BODY(40)); // adopt a rigid S shape to prevent capsizing
-  bus_set(MOTOR_ADDR_NECK, MREG_SETPOINT, DEG_TO_OUTPUT_BODY(40));
-  bus_set(MOTOR_ADDR_TORSO, MREG_SETPOINT, DEG_TO_OUTPUT_BODY(-40));
-  bus_set(MOTOR_ADDR_HIP, MREG_SETPOINT, DEG_TO_OUTPUT_BODY(-40));
-  bus_set(MOTOR_ADDR_TAIL, MREG_SETPOINT, DEG_TO_OUTPUT_BODY(40));
+  for (i = 0; i < JOINTS; i++) // adopt a rigid S shape to prevent capsizing
+    bus_set(body[i].addr, MREG_SETPOINT, DEG_TO_OUTPUT_BODY(body[i].ready * body[i].direction));
 
   do { // wait until we start swimming or revert to limp mode.
     // Small delay to ensure timer updates properly
@@ -245,36 +557,28 @@ void ready_mode(void) {
 
   } while (reg8_table[REG8_MODE] == IMODE_READY);
 
-  // Clean up: return motor to zero position
-  bus_set(MOTOR_ADDR_HEAD, MREG_SETPOINT, 0);
-  bus_set(MOTOR_ADDR_NECK, MREG_SETPOINT, 0);
-  bus_set(MOTOR_ADDR_TORSO, MREG_SETPOINT, 0);
-  bus_set(MOTOR_ADDR_HIP, MREG_SETPOINT, 0);
-  bus_set(MOTOR_ADDR_TAIL, MREG_SETPOINT, 0);
-
-  pause(ONE_SEC); // Give the motor time to return to center
-
-  // Stop the motor
-  bus_set(MOTOR_ADDR_HEAD, MREG_MODE, MODE_IDLE);
-  bus_set(MOTOR_ADDR_NECK, MREG_MODE, MODE_IDLE);
-  bus_set(MOTOR_ADDR_TORSO, MREG_MODE, MODE_IDLE);
-  bus_set(MOTOR_ADDR_HIP, MREG_MODE, MODE_IDLE);
-  bus_set(MOTOR_ADDR_TAIL, MREG_MODE, MODE_IDLE);
+  // Clean up: return motor to zero position and stop it
+  stop_body();
 
   // Return LED to normal state
   set_color(2);
 }
 
 
-void main_mode_loop(void) {
+void modes_init(void) {
   // Initialize the default parameters
   init_sine_params();
 
   // Set initial mode
   reg8_table[REG8_MODE] = IMODE_IDLE;
 
-  // Add the register handler
+  // Add the register handlers
   radio_add_reg_callback(register_handler);
+  radio_add_reg_callback(tick_register_handler);
+}
+
+void main_mode_loop(void) {
+  modes_init();
 
   while (1) {
     switch (reg8_table[REG8_MODE]) {
@@ -286,6 +590,9 @@ void main_mode_loop(void) {
     case IMODE_SWIM:
       swim_mode();
       break;
+    case IMODE_SWIM_GEN:
+      swim_gen_mode();
+      break;
     default:
       reg8_table[REG8_MODE] = IMODE_IDLE;
     }
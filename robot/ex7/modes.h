@@ -10,10 +10,17 @@
 /// active swimming mode
 #define IMODE_SWIM     2
 
-/// The IDLE mode switching
+/// swimming mode with the internal generators of the modules
+#define IMODE_SWIM_GEN 3
+
+/// Sets the default parameters, the idle mode and the handler of the registers
+void modes_init(void);
+/// The IDLE mode switching (calls modes_init())
 void main_mode_loop(void);
 /// The swimming mode (active motor movement)
 void swim_mode(void);
+/// The swimming mode with the internal generators (no bus traffic while swimming steadily)
+void swim_gen_mode(void);
 /// The ready mode (move to a safe state to prevent capsize)
 void ready_mode(void);
 
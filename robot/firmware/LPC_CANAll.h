@@ -48,12 +48,14 @@ DO NOT CHANGE ANYTHING BELOW
 #define CANBitrate500k_60MHz          0x00180009
 #define CANBitrate1M_60MHz            0x00180004
 
-// CAN Interrupt Service Routines
+// CAN Interrupt Service Routines (not part of the host build, see hal.h)
+#ifndef HOST_BUILD
 void CANAll_CANISR_Err (void) __attribute__ ((interrupt));
 void CANAll_CANISR_Rx1 (void) __attribute__ ((interrupt));
 void CANAll_CANISR_Rx2 (void) __attribute__ ((interrupt));
 void CANAll_CANISR_Rx3 (void) __attribute__ ((interrupt));
 void CANAll_CANISR_Rx4 (void) __attribute__ ((interrupt));
+#endif
 
 // Type definition to hold a CAN message
 typedef struct
@@ -1,6 +1,8 @@
 #include "sysTime.h"
 #include "can.h"
+#include "module.h"
 #include "utils.h"
+#include "profile.h"
 
 void can_head_init()
 {
@@ -13,6 +15,7 @@ uint8_t set_reg_value_b(uint8_t dest, uint8_t reg, uint8_t val)
   CANALL_MSG buf;
   struct can_frame* tx;
   uint8_t cnt = 0;
+  PROF_START(t0);
 
   tx = (struct can_frame*) &buf.DatA;
   buf.Frame = 0x00040000;   // 4 bytes
@@ -29,13 +32,13 @@ uint8_t set_reg_value_b(uint8_t dest, uint8_t reg, uint8_t val)
     if (CANAll_PushMessage(1, &buf)) {
       while (!CANAll_PullMessage(1, &buf)) {
         cnt++;
-        if (cnt==0x00) return 0;
+        if (cnt==0x00) PROF_RETURN(PROF_CAN, t0, 0);
         pause(CAN_TIMEOUT);
       }
       if (buf.MsgID==(LOCAL_ADDR | 0x100)) break;
     } else pause(CAN_TIMEOUT);
   }
-  return 1;
+  PROF_RETURN(PROF_CAN, t0, 1);
 }
 
 uint8_t set_reg_value_w(uint8_t dest, uint8_t reg, uint16_t val)
@@ -43,6 +46,7 @@ uint8_t set_reg_value_w(uint8_t dest, uint8_t reg, uint16_t val)
   CANALL_MSG buf;
   struct can_frame* tx;
   uint8_t cnt = 0;
+  PROF_START(t0);
 
   tx = (struct can_frame*) &buf.DatA;
   buf.Frame = 0x00050000;   // 5 bytes
@@ -59,13 +63,13 @@ uint8_t set_reg_value_w(uint8_t dest, uint8_t reg, uint16_t val)
     if (CANAll_PushMessage(1, &buf)) {
       while (!CANAll_PullMessage(1, &buf)) {
         cnt++;
-        if (cnt==0x00) return 0;
+        if (cnt==0x00) PROF_RETURN(PROF_CAN, t0, 0);
         pause(CAN_TIMEOUT);
       }
       if (buf.MsgID==(LOCAL_ADDR | 0x100)) break;
     } else pause(CAN_TIMEOUT);
   }
-  return 1;
+  PROF_RETURN(PROF_CAN, t0, 1);
 }
 
 uint8_t set_reg_value_dw(uint8_t dest, uint8_t reg, uint32_t val)
@@ -73,6 +77,7 @@ uint8_t set_reg_value_dw(uint8_t dest, uint8_t reg, uint32_t val)
   CANALL_MSG buf;
   struct can_frame* tx;
   uint8_t cnt = 0;
+  PROF_START(t0);
 
   tx = (struct can_frame*) &buf.DatA;
   buf.Frame = 0x00070000;   // 7 bytes
@@ -89,13 +94,41 @@ uint8_t set_reg_value_dw(uint8_t dest, uint8_t reg, uint32_t val)
     if (CANAll_PushMessage(1, &buf)) {
       while (!CANAll_PullMessage(1, &buf)) {
         cnt++;
-        if (cnt==0x00) return 0;
+        if (cnt==0x00) PROF_RETURN(PROF_CAN, t0, 0);
         pause(CAN_TIMEOUT);
       }
       if (buf.MsgID==(LOCAL_ADDR | 0x100)) break;
     } else pause(CAN_TIMEOUT);
   }
-  return 1;
+  PROF_RETURN(PROF_CAN, t0, 1);
+}
+
+uint8_t can_group_join(uint8_t dest, uint8_t group, uint8_t slot)
+{
+  return set_reg_value_b(dest, MREG_GROUP_SLOT, slot) && set_reg_value_b(dest, MREG_GROUP, group);
+}
+
+uint8_t can_group_setpoints(uint8_t group, const int8_t* val, uint8_t n)
+{
+  CANALL_MSG buf;
+  uint8_t b[CAN_GROUP_SLOTS] = { 0 };
+  uint8_t i, cnt = 0;
+  PROF_START(t0);
+
+  if (n > CAN_GROUP_SLOTS) n = CAN_GROUP_SLOTS;
+  for (i = 0; i < n; i++) b[i] = val[i];
+  buf.Frame = (uint32_t) n << 16;
+  buf.MsgID = CAN_GROUP_BASE + group;
+  buf.DatA = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t) b[3] << 24);
+  buf.DatB = b[4] | (b[5] << 8) | (b[6] << 16) | ((uint32_t) b[7] << 24);
+
+  // no acknowledge: the frame only has to leave
+  while (!CANAll_PushMessage(1, &buf)) {
+    cnt++;
+    if (cnt == 0x00) PROF_RETURN(PROF_CAN, t0, 0);
+    pause(CAN_TIMEOUT);
+  }
+  PROF_RETURN(PROF_CAN, t0, 1);
 }
 
 uint8_t get_reg_value_b(uint8_t dest, uint8_t reg)
@@ -104,6 +137,7 @@ uint8_t get_reg_value_b(uint8_t dest, uint8_t reg)
   struct can_frame *tx;
   struct can_frame_b *rx;
   uint8_t cnt = 0;
+  PROF_START(t0);
 
   tx = (struct can_frame*) &buf.DatA;
   rx = (struct can_frame_b *)tx;
@@ -117,7 +151,7 @@ uint8_t get_reg_value_b(uint8_t dest, uint8_t reg)
 
   while (!CANAll_PushMessage(1, &buf)) {
     cnt++;
-    if (cnt == 0x00) return 0xFF;
+    if (cnt == 0x00) PROF_RETURN(PROF_CAN, t0, 0xFF);
     pause(CAN_TIMEOUT);
   }
   
@@ -126,11 +160,11 @@ uint8_t get_reg_value_b(uint8_t dest, uint8_t reg)
   do {
     while (!CANAll_PullMessage(1, &buf)) {
       cnt++;
-      if (cnt==0x00) return 0xFF;
+      if (cnt==0x00) PROF_RETURN(PROF_CAN, t0, 0xFF);
       pause(CAN_TIMEOUT);
     }
-  } while (!rx->reply);
-  return rx->data[0];
+  } while (!rx->reply || buf.MsgID != (LOCAL_ADDR | 0x100));
+  PROF_RETURN(PROF_CAN, t0, rx->data[0]);
 }
 
 uint16_t get_reg_value_w(uint8_t dest, uint8_t reg)
@@ -139,6 +173,7 @@ uint16_t get_reg_value_w(uint8_t dest, uint8_t reg)
   struct can_frame *tx;
   struct can_frame_b *rx;
   uint8_t cnt = 0;
+  PROF_START(t0);
 
   tx = (struct can_frame*) &buf.DatA;
   rx = (struct can_frame_b*) tx;
@@ -153,18 +188,18 @@ uint16_t get_reg_value_w(uint8_t dest, uint8_t reg)
 
   while (!CANAll_PushMessage(1, &buf)) {
     cnt++;
-    if (cnt == 0x00) return 0xFFFF;
+    if (cnt == 0x00) PROF_RETURN(PROF_CAN, t0, 0xFFFF);
     pause(CAN_TIMEOUT);
   }
 
   do {
     while (!CANAll_PullMessage(1, &buf)) {
       cnt++;
-      if (cnt==0x00) return 0xFFFF;
+      if (cnt==0x00) PROF_RETURN(PROF_CAN, t0, 0xFFFF);
       pause(CAN_TIMEOUT);
     }
-  } while (!rx->reply);
-  return unaligned_read_16(rx->data);
+  } while (!rx->reply || buf.MsgID != (LOCAL_ADDR | 0x100));
+  PROF_RETURN(PROF_CAN, t0, unaligned_read_16(rx->data));
 }
 
 uint32_t get_reg_value_dw(uint8_t dest, uint8_t reg)
@@ -173,6 +208,7 @@ uint32_t get_reg_value_dw(uint8_t dest, uint8_t reg)
   struct can_frame *tx;
   struct can_frame_b *rx;
   uint8_t cnt = 0;
+  PROF_START(t0);
 
   tx = (struct can_frame*) &buf.DatA;
   rx = (struct can_frame_b*) tx;
@@ -186,16 +222,16 @@ uint32_t get_reg_value_dw(uint8_t dest, uint8_t reg)
 
   while (!CANAll_PushMessage(1, &buf)) {
     cnt++;
-    if (cnt == 0x00) return 0xFFFFFFFF;
+    if (cnt == 0x00) PROF_RETURN(PROF_CAN, t0, 0xFFFFFFFF);
     pause(CAN_TIMEOUT);
   }
 
   do {
     while (!CANAll_PullMessage(1, &buf)) {
       cnt++;
-      if (cnt==0x00) return 0xFFFFFFFF;
+      if (cnt==0x00) PROF_RETURN(PROF_CAN, t0, 0xFFFFFFFF);
       pause(CAN_TIMEOUT);
     }
-  } while (!rx->reply);
-  return unaligned_read_32(rx->data);
+  } while (!rx->reply || buf.MsgID != (LOCAL_ADDR | 0x100));
+  PROF_RETURN(PROF_CAN, t0, unaligned_read_32(rx->data));
 }
@@ -14,6 +14,11 @@
 #define CAN_TIMEOUT 500     // timer resolution is 100 ns
 #define LOCAL_ADDR  0
 
+/// Identifier of the first group frame: group g (1 to 255) is CAN_GROUP_BASE + g
+#define CAN_GROUP_BASE  0x200
+/// Setpoints carried by a group frame
+#define CAN_GROUP_SLOTS 8
+
 /// CAN packets sent from head
 struct can_frame {
   int write:1;         //< 1 if writing a register
@@ -52,6 +57,22 @@ uint8_t set_reg_value_w(uint8_t dest, uint8_t reg, uint16_t val);
  */
 uint8_t set_reg_value_dw(uint8_t dest, uint8_t reg, uint32_t val);
 
+/** \brief  Puts a remote element in a group, to receive its setpoint in the
+ *          group frames (MREG_GROUP and MREG_GROUP_SLOT, see module.h)
+ *  \param  group Group, from 1 to 255 (0 leaves the groups)
+ *  \param  slot Byte of the group frames holding the setpoint of the element
+ *  \return 0 on failure, 1 on success
+ */
+uint8_t can_group_join(uint8_t dest, uint8_t group, uint8_t slot);
+
+/** \brief  Sends the setpoints of the elements of a group in a single frame,
+ *          which they do not acknowledge
+ *  \param  val Setpoints, by slot
+ *  \param  n Number of setpoints, at most CAN_GROUP_SLOTS
+ *  \return 0 if the frame could not be sent, 1 on success
+ */
+uint8_t can_group_setpoints(uint8_t group, const int8_t* val, uint8_t n);
+
 /** \brief  Reads a 8-bit register from a remote element
  *  \return The read value on success, or 0xFF in case of failure
  */
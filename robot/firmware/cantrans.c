@@ -0,0 +1,194 @@
+#include "sysTime.h"
+#include "can.h"
+#include "cantrans.h"
+#include "utils.h"
+
+struct trans {
+  uint8_t state;
+  uint8_t tag;           // sender address of the request
+  uint8_t dest;
+  uint8_t reg;
+  uint8_t size;
+  uint8_t write;
+  uint32_t value;        // value to write, or read
+  uint32_t start;        // [system timer tics]
+  uint32_t timeout;
+  can_trans_cb cb;
+};
+
+static struct trans trans[CAN_TRANS_MAX];
+
+// Queued transactions, in the order of their start
+static int8_t queue[CAN_TRANS_MAX];
+static uint8_t queue_in = 0, queue_out = 0, queued = 0;
+
+static uint8_t next_tag = 0;
+
+// Puts the request of a transaction in the transmit buffer, returns 0 if busy
+static uint8_t push(struct trans* t)
+{
+  CANALL_MSG buf;
+  struct can_frame* tx = (struct can_frame*) &buf.DatA;
+
+  buf.MsgID = t->dest;
+  tx->write = t->write;
+  tx->size = t->size;
+  tx->reply = 0;
+  tx->sendack = t->write;
+  tx->reg = t->reg;
+  tx->snd = t->tag;
+  if (!t->write) {
+    buf.Frame = 0x00030000;   // 3 bytes
+  } else if (t->size == 1) {
+    buf.Frame = 0x00040000;   // 4 bytes
+    tx->data[0] = t->value;
+  } else if (t->size == 2) {
+    buf.Frame = 0x00050000;   // 5 bytes
+    unaligned_write_16(tx->data, t->value);
+  } else {
+    buf.Frame = 0x00070000;   // 7 bytes
+    unaligned_write_32(tx->data, t->value);
+  }
+  if (!CANAll_PushMessage(1, &buf)) return 0;
+  t->state = CT_SENT;
+  return 1;
+}
+
+static void send_queued(void)
+{
+  while (queued && push(&trans[queue[queue_out]])) {
+    queue_out = (queue_out + 1) % CAN_TRANS_MAX;
+    queued--;
+  }
+}
+
+static int8_t start(uint8_t dest, uint8_t reg, uint8_t size, uint8_t write, uint32_t val,
+                    uint32_t timeout, can_trans_cb cb)
+{
+  struct trans* t;
+  int8_t h;
+
+  for (h = 0; h < CAN_TRANS_MAX && trans[h].state != CT_FREE; h++);
+  if (h == CAN_TRANS_MAX) return -1;
+
+  t = &trans[h];
+  t->state = CT_QUEUED;
+  t->tag = CAN_TRANS_TAG + next_tag;
+  next_tag = (next_tag + 1) & (CAN_TRANS_TAGS - 1);
+  t->dest = dest;
+  t->reg = reg;
+  t->size = size;
+  t->write = write;
+  t->value = val;
+  t->start = getSysTICs();
+  t->timeout = timeout;
+  t->cb = cb;
+
+  queue[queue_in] = h;
+  queue_in = (queue_in + 1) % CAN_TRANS_MAX;
+  queued++;
+  send_queued();
+  return h;
+}
+
+int8_t can_trans_read(uint8_t dest, uint8_t reg, uint8_t size, uint32_t timeout, can_trans_cb cb)
+{
+  return start(dest, reg, size, 0, 0, timeout, cb);
+}
+
+int8_t can_trans_write(uint8_t dest, uint8_t reg, uint8_t size, uint32_t val, uint32_t timeout,
+                       can_trans_cb cb)
+{
+  return start(dest, reg, size, 1, val, timeout, cb);
+}
+
+// Ends a transaction, calling its callback if any (the handle is then free)
+static void complete(struct trans* t, uint8_t state)
+{
+  t->state = state;
+  if (t->cb) {
+    t->state = CT_FREE;
+    t->cb(t->dest, t->reg, state, t->value);
+  }
+}
+
+// Matches an answer with the transaction of its tag
+static void receive(CANALL_MSG* buf)
+{
+  struct can_frame_b* rx = (struct can_frame_b*) &buf->DatA;
+  struct trans* t;
+  uint8_t h;
+
+  if ((buf->MsgID & ~0xFF) != 0x100 || !rx->reply) return;
+  for (h = 0; h < CAN_TRANS_MAX; h++) {
+    t = &trans[h];
+    if (t->state != CT_SENT || (buf->MsgID & 0xFF) != t->tag) continue;
+    if (t->write) {
+      if (!rx->ack) return;
+    } else {
+      if (rx->ack || (rx->size & 3) != t->size) return;  // size is a signed bitfield
+      switch (t->size) {
+        case 1:
+          t->value = rx->data[0];
+          break;
+        case 2:
+          t->value = unaligned_read_16(rx->data);
+          break;
+        default:
+          t->value = unaligned_read_32(rx->data);
+          break;
+      }
+    }
+    complete(t, CT_DONE);
+    return;
+  }
+}
+
+void can_trans_poll(void)
+{
+  CANALL_MSG buf;
+  uint8_t h;
+
+  send_queued();
+  while (CANAll_PullMessage(1, &buf)) receive(&buf);
+
+  for (h = 0; h < CAN_TRANS_MAX; h++) {
+    // a queued transaction stays in the queue until sent, and then expires
+    if (trans[h].state == CT_SENT && getElapsedSysTICs(trans[h].start) > trans[h].timeout) {
+      complete(&trans[h], CT_TIMEOUT);
+    }
+  }
+}
+
+uint8_t can_trans_status(int8_t h)
+{
+  return (h < 0 || h >= CAN_TRANS_MAX) ? CT_FREE : trans[h].state;
+}
+
+uint32_t can_trans_value(int8_t h)
+{
+  return (h < 0 || h >= CAN_TRANS_MAX) ? 0 : trans[h].value;
+}
+
+void can_trans_release(int8_t h)
+{
+  if (h >= 0 && h < CAN_TRANS_MAX && trans[h].state >= CT_DONE) trans[h].state = CT_FREE;
+}
+
+uint8_t can_trans_wait(int8_t h)
+{
+  while (can_trans_status(h) == CT_QUEUED || can_trans_status(h) == CT_SENT) {
+    can_trans_poll();
+  }
+  return can_trans_status(h);
+}
+
+uint8_t can_trans_pending(void)
+{
+  uint8_t h, n = 0;
+
+  for (h = 0; h < CAN_TRANS_MAX; h++) {
+    if (trans[h].state == CT_QUEUED || trans[h].state == CT_SENT) n++;
+  }
+  return n;
+}
@@ -0,0 +1,93 @@
+#ifndef __CANTRANS_H
+#define __CANTRANS_H
+
+/**
+ * \file   cantrans.h
+ * \brief  Pipelined register transactions on the CAN bus
+ *
+ * Several reads and writes to different elements can be outstanding at once,
+ * so that their frames and the answers of the elements overlap on the bus
+ * instead of taking a round trip each as with the functions of can.h.
+ *
+ * The answers of the elements carry no address nor register. Each transaction
+ * is thus sent with its own tag as sender (CAN_TRANS_TAG and up), and matched
+ * with its answer by this tag. The tags rotate, so that a late answer to an
+ * expired transaction is not taken for the answer to a new one.
+ *
+ * This needs elements that send their answer to the identifier 0x100 | snd,
+ * snd being the sender field of the request, as the simulated modules of
+ * host/hostcan.c do. The head always sent LOCAL_ADDR (0) until now, so an
+ * element firmware that answers to a fixed 0x100 is not told apart: all its
+ * transactions then end in CT_TIMEOUT, and the callers must fall back to the
+ * blocking functions of can.h. The element firmware is not part of this tree.
+ *
+ * The blocking functions only skip the answers to transactions: as the
+ * answers carry no address, they still cannot tell which element answered,
+ * and may take the late answer of an element to an earlier request.
+ *
+ * A transaction completes by a callback, called from can_trans_poll(), or is
+ * polled with can_trans_status() and released. Its timeout counts from its
+ * start. The blocking functions of can.h must not be used while transactions
+ * are outstanding, as they pull and drop the answers to the transactions.
+ */
+
+#include <stdint.h>
+
+/// Transactions outstanding at most
+#define CAN_TRANS_MAX   16
+
+/// First tag, used as sender address of the requests
+#define CAN_TRANS_TAG   0x80
+/// Number of tags (power of 2)
+#define CAN_TRANS_TAGS  0x80
+
+/// States of a transaction
+enum {
+  CT_FREE,       ///< handle not in use
+  CT_QUEUED,     ///< waiting for the transmit buffer
+  CT_SENT,       ///< waiting for the answer
+  CT_DONE,       ///< answered
+  CT_TIMEOUT     ///< not answered in time
+};
+
+/// Function called when a transaction completes (CT_DONE or CT_TIMEOUT)
+typedef void (*can_trans_cb)(uint8_t dest, uint8_t reg, uint8_t status, uint32_t value);
+
+/** \brief  Starts the read of a register of an element
+ *  \param  size Size of the register (1 = 8-bit, 2 = 16-bit, 3 = 32-bit)
+ *  \param  timeout Timeout [system timer tics]
+ *  \param  cb Function called on completion, NULL to poll the transaction
+ *  \return The handle of the transaction, -1 if CAN_TRANS_MAX are outstanding
+ */
+int8_t can_trans_read(uint8_t dest, uint8_t reg, uint8_t size, uint32_t timeout, can_trans_cb cb);
+
+/** \brief  Starts the write of a register of an element, acknowledged by it
+ *  \param  size Size of the register (1 = 8-bit, 2 = 16-bit, 3 = 32-bit)
+ *  \param  timeout Timeout [system timer tics]
+ *  \param  cb Function called on completion, NULL to poll the transaction
+ *  \return The handle of the transaction, -1 if CAN_TRANS_MAX are outstanding
+ */
+int8_t can_trans_write(uint8_t dest, uint8_t reg, uint8_t size, uint32_t val, uint32_t timeout,
+                       can_trans_cb cb);
+
+/// Sends the queued requests, matches the answers received and expires the transactions
+void can_trans_poll(void);
+
+/// State of a transaction (CT_QUEUED, CT_SENT, CT_DONE or CT_TIMEOUT)
+uint8_t can_trans_status(int8_t h);
+
+/// Value read by a transaction, once CT_DONE
+uint32_t can_trans_value(int8_t h);
+
+/// Frees a polled transaction, once completed
+void can_trans_release(int8_t h);
+
+/** \brief  Polls until a transaction completes
+ *  \return Its state, CT_DONE or CT_TIMEOUT
+ */
+uint8_t can_trans_wait(int8_t h);
+
+/// Number of transactions outstanding (queued or sent)
+uint8_t can_trans_pending(void);
+
+#endif // __CANTRANS_H
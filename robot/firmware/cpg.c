@@ -0,0 +1,99 @@
+#include <math.h>
+#include "cpg.h"
+#include "lutmath.h"
+#include "sysTime.h"
+
+/// Phase of a full turn, as a floating point number
+#define TURN 4294967296.0
+
+void cpg_init(struct cpg* c, uint8_t n, float coupling, float rate)
+{
+  uint8_t i;
+
+  if (n > CPG_MAX_OSC) n = CPG_MAX_OSC;
+  c->n = n;
+  // w / 2pi turns per second for a sine of 1 (32767)
+  c->coupling = coupling / (2 * M_PI) * (TURN * 65536.0 / sysTICSperSEC) / 32767 + 0.5;
+  c->rate = rate * (TURN / sysTICSperSEC) + 0.5;
+  c->step = c->step_target = 0;
+  c->lag = 0;
+  for (i = 0; i < CPG_MAX_OSC; i++) {
+    c->phase[i] = 0;
+    c->frac[i] = 0;
+    c->amplitude[i] = c->amplitude_target[i] = 0;
+    c->offset[i] = c->offset_target[i] = 0;
+    c->shift[i] = c->shift_target[i] = 0;
+  }
+}
+
+void cpg_set(struct cpg* c, float freq, float lag)
+{
+  c->step_target = freq * (TURN * 65536.0 / sysTICSperSEC) + 0.5;
+  c->lag = (uint32_t) (int64_t) (lag * TURN);
+}
+
+void cpg_set_joint(struct cpg* c, uint8_t i, float amplitude, float offset, float shift)
+{
+  if (i >= c->n) return;
+  c->amplitude_target[i] = amplitude * 65536;
+  c->offset_target[i] = offset * 65536;
+  c->shift_target[i] = (uint32_t) (int64_t) (shift * TURN);
+}
+
+// First order step of a value towards its target, k being a dt [2^-32]
+static inline int32_t converge(int32_t value, int32_t target, uint32_t k)
+{
+  return value + (int32_t) (((int64_t) (target - value) * k) >> 32);
+}
+
+// One integration step, of at most CPG_MAX_TICS
+static void step(struct cpg* c, uint32_t tics)
+{
+  int32_t sum[CPG_MAX_OSC];
+  uint32_t k = c->rate * tics;
+  int64_t d;
+  uint8_t i;
+
+  // coupling terms, all from the phases before the step
+  for (i = 0; i < c->n; i++) {
+    sum[i] = 0;
+    if (i > 0) sum[i] += isin(c->phase[i - 1] - c->phase[i] + c->lag);
+    if (i + 1 < c->n) sum[i] += isin(c->phase[i + 1] - c->phase[i] - c->lag);
+  }
+
+  for (i = 0; i < c->n; i++) {
+    d = ((int64_t) c->step + (int64_t) sum[i] * c->coupling) * tics + c->frac[i];
+    c->phase[i] += (uint32_t) (d >> 16);
+    c->frac[i] = d & 0xFFFF;
+    c->amplitude[i] = converge(c->amplitude[i], c->amplitude_target[i], k);
+    c->offset[i] = converge(c->offset[i], c->offset_target[i], k);
+    // the shift turns the shortest way towards its target
+    c->shift[i] += (int32_t) (((int64_t) (int32_t) (c->shift_target[i] - c->shift[i]) * k) >> 32);
+  }
+
+  c->step = converge((int32_t) c->step, (int32_t) c->step_target, k);
+}
+
+void cpg_advance(struct cpg* c, uint32_t tics)
+{
+  while (tics > CPG_MAX_TICS) {
+    step(c, CPG_MAX_TICS);
+    tics -= CPG_MAX_TICS;
+  }
+  step(c, tics);
+}
+
+void cpg_outputs(const struct cpg* c, int8_t* out)
+{
+  int32_t v;
+  uint8_t i;
+
+  for (i = 0; i < c->n; i++) {
+    v = c->offset[i] + (int32_t) (((int64_t) c->amplitude[i] * isin(c->phase[i] + c->shift[i])) >> 15);
+    // truncated towards zero (the shift of a negative number rounds down)
+    v = (v < 0) ? -((-v) >> 16) : (v >> 16);
+    if (v > 127) v = 127;
+    if (v < -127) v = -127;
+    out[i] = v;
+  }
+}
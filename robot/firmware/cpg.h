@@ -0,0 +1,79 @@
+#ifndef __CPG_H
+#define __CPG_H
+
+/**
+ * \file   cpg.h
+ * \brief  Central pattern generator: a chain of coupled phase oscillators
+ *
+ * Oscillator i has a phase theta_i, an amplitude r_i, an offset x_i and a
+ * phase shift s_i, and drives joint i with x_i + r_i sin(2 pi (theta_i + s_i)),
+ * where r_i, x_i and s_i describe the joint in the body. The phases are
+ * coupled to their neighbours in the chain so that theta_i+1 - theta_i tends
+ * to the lag:
+ *
+ *   dtheta_i/dt = f + w / 2pi (sin(theta_i-1 - theta_i + lag)
+ *                            + sin(theta_i+1 - theta_i - lag))
+ *
+ * while f, r_i, x_i and s_i tend to their targets at a first order
+ * rate a, e.g. dr_i/dt = a (R_i - r_i). A new set of parameters thus changes
+ * the wave smoothly, without a jump of the setpoints, from the current state.
+ *
+ * The state is integrated in fixed point, a full turn of the phases being
+ * 2^32, by steps of at most CPG_MAX_TICS: the
+ * integration is stable for w and a up to 50 /s.
+ */
+
+#include <stdint.h>
+
+/// Largest number of oscillators
+#define CPG_MAX_OSC 16
+
+/// Largest integration step [system timer tics], 10 ms
+#define CPG_MAX_TICS 100000
+
+/// State and parameters of a chain of oscillators
+struct cpg {
+  uint8_t n;                             ///< number of oscillators
+  uint32_t coupling;                     ///< w [2^-48 turn/tic per Q15 unit of sine]
+  uint32_t rate;                         ///< a [2^-32 per tic]
+  uint32_t step;                         ///< frequency [2^-48 turn/tic]
+  uint32_t step_target;
+  uint32_t lag;                          ///< phase between neighbours [2^-32 turn]
+  uint32_t phase[CPG_MAX_OSC];           ///< theta_i [2^-32 turn]
+  uint16_t frac[CPG_MAX_OSC];            ///< fraction of theta_i [2^-48 turn]
+  int32_t amplitude[CPG_MAX_OSC];        ///< r_i [setpoint units / 65536]
+  int32_t amplitude_target[CPG_MAX_OSC];
+  int32_t offset[CPG_MAX_OSC];           ///< x_i [setpoint units / 65536]
+  int32_t offset_target[CPG_MAX_OSC];
+  uint32_t shift[CPG_MAX_OSC];           ///< s_i [2^-32 turn]
+  uint32_t shift_target[CPG_MAX_OSC];
+};
+
+/** \brief Initializes a chain at rest: phases, amplitudes, offsets, shifts
+ *    and their targets at zero, the oscillators start when the targets are set
+ *  \param n Number of oscillators, at most CPG_MAX_OSC
+ *  \param coupling Coupling strength w [1/s]
+ *  \param rate Convergence rate a of the parameters [1/s]
+ */
+void cpg_init(struct cpg* c, uint8_t n, float coupling, float rate);
+
+/** \brief Sets the frequency target and the lag of the chain
+ *  \param freq Frequency [Hz]
+ *  \param lag Phase between consecutive oscillators [turns]
+ */
+void cpg_set(struct cpg* c, float freq, float lag);
+
+/** \brief Sets the targets of the output of one oscillator
+ *  \param amplitude Amplitude [setpoint units], negative to invert the joint
+ *  \param offset Offset [setpoint units], e.g. to turn
+ *  \param shift Phase added to the output [turns]
+ */
+void cpg_set_joint(struct cpg* c, uint8_t i, float amplitude, float offset, float shift);
+
+/// Advances the chain by a number of system timer tics
+void cpg_advance(struct cpg* c, uint32_t tics);
+
+/// Setpoints of all the oscillators, truncated towards zero
+void cpg_outputs(const struct cpg* c, int8_t* out);
+
+#endif // __CPG_H
@@ -0,0 +1,42 @@
+#ifndef __HAL_H
+#define __HAL_H
+
+/**
+ * \file   hal.h
+ * \brief  Hardware abstraction for the portable parts of the firmware
+ *
+ * The peripherals are only reached through the interfaces of sysTime.h,
+ * timerISR.h, armVIC.h, uart.h, uartISR.h, i2c.h, adc.h and LPC_CANAll.h.
+ * The files of this directory implement them on the LPC2129. Those of
+ * robot/host implement them on a PC (HOST_BUILD), with a virtual clock,
+ * in-memory queues for the UART and the CAN bus and simulated I2C devices,
+ * so that radio.c, robot.c, can.c, lutmath.c and the modes of the exercises
+ * run unchanged in a host program. The few registers the rest of the
+ * firmware needs are reached through the functions below.
+ */
+
+#include <stdint.h>
+
+#ifdef HOST_BUILD
+
+/// Switches the LED of the microcontroller board (P0.12) on or off
+void hal_set_led1(uint8_t on);
+
+#else
+
+#include "LPC21xx.h"
+#include "hwconfig.h"
+
+/// Switches the LED of the microcontroller board (P0.12) on or off
+static inline void hal_set_led1(uint8_t on)
+{
+  if (on) {
+    IO0SET = LED1_BIT;
+  } else {
+    IO0CLR = LED1_BIT;
+  }
+}
+
+#endif
+
+#endif // __HAL_H
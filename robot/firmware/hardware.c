@@ -6,6 +6,7 @@
 #include "irsens.h"
 #include "adc.h"
 #include "armVIC.h"
+#include "profile.h"
 
 #if defined(HARDWARE_V3)
 
@@ -26,9 +27,12 @@ void init_rgb_led()
 
 void set_rgb(uint8_t r, uint8_t g, uint8_t b)
 {
+  PROF_START(t0);
+
   i2c_set(RGB_ADDR, 2, r);
   i2c_set(RGB_ADDR, 3, g);
   i2c_set(RGB_ADDR, 4, b);
+  PROF_END(PROF_I2C_LED, t0);
 }
 
 void set_color(uint8_t c)
@@ -123,6 +127,7 @@ static void led_timer_isr(void)
 
 void uc_init()
 {
+#ifndef HOST_BUILD
   PLLCFG = PLLCFG_MSEL | PLLCFG_PSEL;    // configure the PLL
   PLLCON = PLLCON_PLLE;                  // enable the PLL
   PLLFEED = 0xAA;
@@ -141,6 +146,7 @@ void uc_init()
   VICIntEnClear = 0xFFFFFFFF;            // clear all interrupts
   VICIntSelect = 0x00000000;             // clear all FIQ selections
   VICDefVectAddr = (uint32_t) reset;     // point unvectored IRQs to reset()
+#endif
 }
 
 void hardware_init()
@@ -160,11 +166,12 @@ void hardware_init()
 
   registers_init();
   radio_init();
+  prof_init();
   adc_init();
 
   timer1_init(TIMER1_PERIOD);
   timer1_init_isr();
-  timer1_add_user_function(led_timer_isr, 1);
+  timer1_add_user_function(led_timer_isr, LED_TIMER_PERIOD);
 
 #ifdef HARDWARE_V3
   can_head_init();
@@ -8,8 +8,15 @@
 /// Value of reg32_table[REG32_LED]
 #define LED_MANUAL 0xFF000000
 
-/// The period at which timer1 should call the interrupt
+/// The period at which timer1 should call the interrupt, in microseconds:
+/// the user functions run at multiples of it. An exercise needing a finer
+/// rate (ex7, for its control tick) sets it in the OPTIONS of its Makefile.
+#ifndef TIMER1_PERIOD
 #define TIMER1_PERIOD 50000
+#endif
+
+/// Period of the LED blinking, in timer1 interrupts (50 ms)
+#define LED_TIMER_PERIOD (50000 / TIMER1_PERIOD)
 
 #ifdef HARDWARE_V3
 /// I2C address of the RGB LED controller
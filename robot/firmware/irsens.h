@@ -10,6 +10,7 @@
 #define IR_PASSIVE 0
 #define IR_ACTIVE 1
 
+/// Samples the sensors every period timer1 interrupts (of TIMER1_PERIOD us)
 void enable_ir_sensor(uint16_t period);
 void disable_ir_sensor(void);
 void set_ir_mode(uint8_t mode);
@@ -2,123 +2,145 @@
 #include <stdint.h>
 #include "lutmath.h"
 
-/// The sine lookup table. Also used for cosine.
-static const float sin_LUT[805] = {
-  0.000000, 0.007815, 0.015629, 0.023443, 0.031255, 0.039065, 0.046872, 0.054677, 0.062479, 0.070276,
-  0.078070, 0.085858, 0.093641, 0.101419, 0.109191, 0.116955, 0.124713, 0.132463, 0.140205, 0.147938,
-  0.155663, 0.163377, 0.171082, 0.178777, 0.186460, 0.194132, 0.201792, 0.209440, 0.217075, 0.224697,
-  0.232305, 0.239899, 0.247479, 0.255043, 0.262591, 0.270124, 0.277640, 0.285139, 0.292621, 0.300085,
-  0.307530, 0.314957, 0.322364, 0.329752, 0.337120, 0.344467, 0.351793, 0.359097, 0.366380, 0.373640,
-  0.380878, 0.388092, 0.395282, 0.402449, 0.409590, 0.416707, 0.423798, 0.430864, 0.437903, 0.444915,
-  0.451900, 0.458858, 0.465787, 0.472688, 0.479561, 0.486404, 0.493217, 0.500000, 0.506753, 0.513474,
-  0.520164, 0.526823, 0.533449, 0.540043, 0.546604, 0.553131, 0.559625, 0.566084, 0.572509, 0.578899,
-  0.585253, 0.591572, 0.597855, 0.604101, 0.610310, 0.616482, 0.622617, 0.628713, 0.634771, 0.640790,
-  0.646770, 0.652710, 0.658611, 0.664471, 0.670291, 0.676070, 0.681808, 0.687504, 0.693158, 0.698769,
-  0.704338, 0.709864, 0.715347, 0.720786, 0.726181, 0.731531, 0.736837, 0.742098, 0.747314, 0.752484,
-  0.757608, 0.762685, 0.767716, 0.772700, 0.777638, 0.782527, 0.787369, 0.792162, 0.796908, 0.801604,
-  0.806252, 0.810850, 0.815399, 0.819898, 0.824347, 0.828746, 0.833094, 0.837391, 0.841637, 0.845832,
-  0.849975, 0.854066, 0.858105, 0.862092, 0.866025, 0.869906, 0.873734, 0.877509, 0.881230, 0.884897,
-  0.888510, 0.892068, 0.895573, 0.899022, 0.902417, 0.905757, 0.909041, 0.912270, 0.915443, 0.918560,
-  0.921621, 0.924625, 0.927574, 0.930465, 0.933300, 0.936078, 0.938798, 0.941462, 0.944068, 0.946616,
-  0.949106, 0.951538, 0.953913, 0.956229, 0.958486, 0.960685, 0.962826, 0.964907, 0.966930, 0.968893,
-  0.970798, 0.972643, 0.974429, 0.976155, 0.977821, 0.979428, 0.980975, 0.982463, 0.983890, 0.985257,
-  0.986564, 0.987810, 0.988997, 0.990122, 0.991188, 0.992193, 0.993137, 0.994021, 0.994844, 0.995606,
-  0.996307, 0.996948, 0.997528, 0.998046, 0.998504, 0.998901, 0.999237, 0.999511, 0.999725, 0.999878,
-  0.999969, 1.000000, 0.999969, 0.999878, 0.999725, 0.999511, 0.999237, 0.998901, 0.998504, 0.998046,
-  0.997528, 0.996948, 0.996307, 0.995606, 0.994844, 0.994021, 0.993137, 0.992193, 0.991188, 0.990122,
-  0.988997, 0.987810, 0.986564, 0.985257, 0.983890, 0.982463, 0.980975, 0.979428, 0.977821, 0.976155,
-  0.974429, 0.972643, 0.970798, 0.968893, 0.966930, 0.964907, 0.962826, 0.960685, 0.958486, 0.956229,
-  0.953913, 0.951538, 0.949106, 0.946616, 0.944068, 0.941462, 0.938798, 0.936078, 0.933300, 0.930465,
-  0.927574, 0.924625, 0.921621, 0.918560, 0.915443, 0.912270, 0.909041, 0.905757, 0.902417, 0.899022,
-  0.895573, 0.892068, 0.888510, 0.884897, 0.881230, 0.877509, 0.873734, 0.869906, 0.866025, 0.862092,
-  0.858105, 0.854066, 0.849975, 0.845832, 0.841637, 0.837391, 0.833094, 0.828746, 0.824347, 0.819898,
-  0.815399, 0.810850, 0.806252, 0.801604, 0.796908, 0.792162, 0.787369, 0.782527, 0.777638, 0.772700,
-  0.767716, 0.762685, 0.757608, 0.752484, 0.747314, 0.742098, 0.736837, 0.731531, 0.726181, 0.720786,
-  0.715347, 0.709864, 0.704338, 0.698769, 0.693158, 0.687504, 0.681808, 0.676070, 0.670291, 0.664471,
-  0.658611, 0.652710, 0.646770, 0.640790, 0.634771, 0.628713, 0.622617, 0.616482, 0.610310, 0.604101,
-  0.597855, 0.591572, 0.585253, 0.578899, 0.572509, 0.566084, 0.559625, 0.553131, 0.546604, 0.540043,
-  0.533449, 0.526823, 0.520164, 0.513474, 0.506753, 0.500000, 0.493217, 0.486404, 0.479561, 0.472688,
-  0.465787, 0.458858, 0.451900, 0.444915, 0.437903, 0.430864, 0.423798, 0.416707, 0.409590, 0.402449,
-  0.395282, 0.388092, 0.380878, 0.373640, 0.366380, 0.359097, 0.351793, 0.344467, 0.337120, 0.329752,
-  0.322364, 0.314957, 0.307530, 0.300085, 0.292621, 0.285139, 0.277640, 0.270124, 0.262591, 0.255043,
-  0.247479, 0.239899, 0.232305, 0.224697, 0.217075, 0.209440, 0.201792, 0.194132, 0.186460, 0.178777,
-  0.171082, 0.163377, 0.155663, 0.147938, 0.140205, 0.132463, 0.124713, 0.116955, 0.109191, 0.101419,
-  0.093641, 0.085858, 0.078070, 0.070276, 0.062479, 0.054677, 0.046872, 0.039065, 0.031255, 0.023443,
-  0.015629, 0.007815, 0.000000, -0.007815, -0.015629, -0.023443, -0.031255, -0.039065, -0.046872, -0.054677,
-  -0.062479, -0.070276, -0.078070, -0.085858, -0.093641, -0.101419, -0.109191, -0.116955, -0.124713, -0.132463,
-  -0.140205, -0.147938, -0.155663, -0.163377, -0.171082, -0.178777, -0.186460, -0.194132, -0.201792, -0.209440,
-  -0.217075, -0.224697, -0.232305, -0.239899, -0.247479, -0.255043, -0.262591, -0.270124, -0.277640, -0.285139,
-  -0.292621, -0.300085, -0.307530, -0.314957, -0.322364, -0.329752, -0.337120, -0.344467, -0.351793, -0.359097,
-  -0.366380, -0.373640, -0.380878, -0.388092, -0.395282, -0.402449, -0.409590, -0.416707, -0.423798, -0.430864,
-  -0.437903, -0.444915, -0.451900, -0.458858, -0.465787, -0.472688, -0.479561, -0.486404, -0.493217, -0.500000,
-  -0.506753, -0.513474, -0.520164, -0.526823, -0.533449, -0.540043, -0.546604, -0.553131, -0.559625, -0.566084,
-  -0.572509, -0.578899, -0.585253, -0.591572, -0.597855, -0.604101, -0.610310, -0.616482, -0.622617, -0.628713,
-  -0.634771, -0.640790, -0.646770, -0.652710, -0.658611, -0.664471, -0.670291, -0.676070, -0.681808, -0.687504,
-  -0.693158, -0.698769, -0.704338, -0.709864, -0.715347, -0.720786, -0.726181, -0.731531, -0.736837, -0.742098,
-  -0.747314, -0.752484, -0.757608, -0.762685, -0.767716, -0.772700, -0.777638, -0.782527, -0.787369, -0.792162,
-  -0.796908, -0.801604, -0.806252, -0.810850, -0.815399, -0.819898, -0.824347, -0.828746, -0.833094, -0.837391,
-  -0.841637, -0.845832, -0.849975, -0.854066, -0.858105, -0.862092, -0.866025, -0.869906, -0.873734, -0.877509,
-  -0.881230, -0.884897, -0.888510, -0.892068, -0.895573, -0.899022, -0.902417, -0.905757, -0.909041, -0.912270,
-  -0.915443, -0.918560, -0.921621, -0.924625, -0.927574, -0.930465, -0.933300, -0.936078, -0.938798, -0.941462,
-  -0.944068, -0.946616, -0.949106, -0.951538, -0.953913, -0.956229, -0.958486, -0.960685, -0.962826, -0.964907,
-  -0.966930, -0.968893, -0.970798, -0.972643, -0.974429, -0.976155, -0.977821, -0.979428, -0.980975, -0.982463,
-  -0.983890, -0.985257, -0.986564, -0.987810, -0.988997, -0.990122, -0.991188, -0.992193, -0.993137, -0.994021,
-  -0.994844, -0.995606, -0.996307, -0.996948, -0.997528, -0.998046, -0.998504, -0.998901, -0.999237, -0.999511,
-  -0.999725, -0.999878, -0.999969, -1.000000, -0.999969, -0.999878, -0.999725, -0.999511, -0.999237, -0.998901,
-  -0.998504, -0.998046, -0.997528, -0.996948, -0.996307, -0.995606, -0.994844, -0.994021, -0.993137, -0.992193,
-  -0.991188, -0.990122, -0.988997, -0.987810, -0.986564, -0.985257, -0.983890, -0.982463, -0.980975, -0.979428,
-  -0.977821, -0.976155, -0.974429, -0.972643, -0.970798, -0.968893, -0.966930, -0.964907, -0.962826, -0.960685,
-  -0.958486, -0.956229, -0.953913, -0.951538, -0.949106, -0.946616, -0.944068, -0.941462, -0.938798, -0.936078,
-  -0.933300, -0.930465, -0.927574, -0.924625, -0.921621, -0.918560, -0.915443, -0.912270, -0.909041, -0.905757,
-  -0.902417, -0.899022, -0.895573, -0.892068, -0.888510, -0.884897, -0.881230, -0.877509, -0.873734, -0.869906,
-  -0.866025, -0.862092, -0.858105, -0.854066, -0.849975, -0.845832, -0.841637, -0.837391, -0.833094, -0.828746,
-  -0.824347, -0.819898, -0.815399, -0.810850, -0.806252, -0.801604, -0.796908, -0.792162, -0.787369, -0.782527,
-  -0.777638, -0.772700, -0.767716, -0.762685, -0.757608, -0.752484, -0.747314, -0.742098, -0.736837, -0.731531,
-  -0.726181, -0.720786, -0.715347, -0.709864, -0.704338, -0.698769, -0.693158, -0.687504, -0.681808, -0.676070,
-  -0.670291, -0.664471, -0.658611, -0.652710, -0.646770, -0.640790, -0.634771, -0.628713, -0.622617, -0.616482,
-  -0.610310, -0.604101, -0.597855, -0.591572, -0.585253, -0.578899, -0.572509, -0.566084, -0.559625, -0.553131,
-  -0.546604, -0.540043, -0.533449, -0.526823, -0.520164, -0.513474, -0.506753, -0.500000, -0.493217, -0.486404,
-  -0.479561, -0.472688, -0.465787, -0.458858, -0.451900, -0.444915, -0.437903, -0.430864, -0.423798, -0.416707,
-  -0.409590, -0.402449, -0.395282, -0.388092, -0.380878, -0.373640, -0.366380, -0.359097, -0.351793, -0.344467,
-  -0.337120, -0.329752, -0.322364, -0.314957, -0.307530, -0.300085, -0.292621, -0.285139, -0.277640, -0.270124,
-  -0.262591, -0.255043, -0.247479, -0.239899, -0.232305, -0.224697, -0.217075, -0.209440, -0.201792, -0.194132,
-  -0.186460, -0.178777, -0.171082, -0.163377, -0.155663, -0.147938, -0.140205, -0.132463, -0.124713, -0.116955,
-  -0.109191, -0.101419, -0.093641, -0.085858, -0.078070, -0.070276, -0.062479, -0.054677, -0.046872, -0.039065,
-  -0.031255, -0.023443, -0.015629, -0.007815, -0.000000
+#ifndef M_TWOPI
+#define M_TWOPI (2 * M_PI)
+#endif
+
+/// Bits of the phase below the table index, used for the interpolation
+#define FRAC_BITS (32 - LUT_BITS)
+
+/// The sine table over a full turn, Q15, with the first entry repeated at
+/// the end for the interpolation. Also used for cosine.
+static const int16_t sin_LUT[(1 << LUT_BITS) + 1] = {
+       0,    201,    402,    603,    804,   1005,   1206,   1407,   1608,   1809,   2009,   2210,
+    2410,   2611,   2811,   3012,   3212,   3412,   3612,   3811,   4011,   4210,   4410,   4609,
+    4808,   5007,   5205,   5404,   5602,   5800,   5998,   6195,   6393,   6590,   6786,   6983,
+    7179,   7375,   7571,   7767,   7962,   8157,   8351,   8545,   8739,   8933,   9126,   9319,
+    9512,   9704,   9896,  10087,  10278,  10469,  10659,  10849,  11039,  11228,  11417,  11605,
+   11793,  11980,  12167,  12353,  12539,  12725,  12910,  13094,  13279,  13462,  13645,  13828,
+   14010,  14191,  14372,  14553,  14732,  14912,  15090,  15269,  15446,  15623,  15800,  15976,
+   16151,  16325,  16499,  16673,  16846,  17018,  17189,  17360,  17530,  17700,  17869,  18037,
+   18204,  18371,  18537,  18703,  18868,  19032,  19195,  19357,  19519,  19680,  19841,  20000,
+   20159,  20317,  20475,  20631,  20787,  20942,  21096,  21250,  21403,  21554,  21705,  21856,
+   22005,  22154,  22301,  22448,  22594,  22739,  22884,  23027,  23170,  23311,  23452,  23592,
+   23731,  23870,  24007,  24143,  24279,  24413,  24547,  24680,  24811,  24942,  25072,  25201,
+   25329,  25456,  25582,  25708,  25832,  25955,  26077,  26198,  26319,  26438,  26556,  26674,
+   26790,  26905,  27019,  27133,  27245,  27356,  27466,  27575,  27683,  27790,  27896,  28001,
+   28105,  28208,  28310,  28411,  28510,  28609,  28706,  28803,  28898,  28992,  29085,  29177,
+   29268,  29358,  29447,  29534,  29621,  29706,  29791,  29874,  29956,  30037,  30117,  30195,
+   30273,  30349,  30424,  30498,  30571,  30643,  30714,  30783,  30852,  30919,  30985,  31050,
+   31113,  31176,  31237,  31297,  31356,  31414,  31470,  31526,  31580,  31633,  31685,  31736,
+   31785,  31833,  31880,  31926,  31971,  32014,  32057,  32098,  32137,  32176,  32213,  32250,
+   32285,  32318,  32351,  32382,  32412,  32441,  32469,  32495,  32521,  32545,  32567,  32589,
+   32609,  32628,  32646,  32663,  32678,  32692,  32705,  32717,  32728,  32737,  32745,  32752,
+   32757,  32761,  32765,  32766,  32767,  32766,  32765,  32761,  32757,  32752,  32745,  32737,
+   32728,  32717,  32705,  32692,  32678,  32663,  32646,  32628,  32609,  32589,  32567,  32545,
+   32521,  32495,  32469,  32441,  32412,  32382,  32351,  32318,  32285,  32250,  32213,  32176,
+   32137,  32098,  32057,  32014,  31971,  31926,  31880,  31833,  31785,  31736,  31685,  31633,
+   31580,  31526,  31470,  31414,  31356,  31297,  31237,  31176,  31113,  31050,  30985,  30919,
+   30852,  30783,  30714,  30643,  30571,  30498,  30424,  30349,  30273,  30195,  30117,  30037,
+   29956,  29874,  29791,  29706,  29621,  29534,  29447,  29358,  29268,  29177,  29085,  28992,
+   28898,  28803,  28706,  28609,  28510,  28411,  28310,  28208,  28105,  28001,  27896,  27790,
+   27683,  27575,  27466,  27356,  27245,  27133,  27019,  26905,  26790,  26674,  26556,  26438,
+   26319,  26198,  26077,  25955,  25832,  25708,  25582,  25456,  25329,  25201,  25072,  24942,
+   24811,  24680,  24547,  24413,  24279,  24143,  24007,  23870,  23731,  23592,  23452,  23311,
+   23170,  23027,  22884,  22739,  22594,  22448,  22301,  22154,  22005,  21856,  21705,  21554,
+   21403,  21250,  21096,  20942,  20787,  20631,  20475,  20317,  20159,  20000,  19841,  19680,
+   19519,  19357,  19195,  19032,  18868,  18703,  18537,  18371,  18204,  18037,  17869,  17700,
+   17530,  17360,  17189,  17018,  16846,  16673,  16499,  16325,  16151,  15976,  15800,  15623,
+   15446,  15269,  15090,  14912,  14732,  14553,  14372,  14191,  14010,  13828,  13645,  13462,
+   13279,  13094,  12910,  12725,  12539,  12353,  12167,  11980,  11793,  11605,  11417,  11228,
+   11039,  10849,  10659,  10469,  10278,  10087,   9896,   9704,   9512,   9319,   9126,   8933,
+    8739,   8545,   8351,   8157,   7962,   7767,   7571,   7375,   7179,   6983,   6786,   6590,
+    6393,   6195,   5998,   5800,   5602,   5404,   5205,   5007,   4808,   4609,   4410,   4210,
+    4011,   3811,   3612,   3412,   3212,   3012,   2811,   2611,   2410,   2210,   2009,   1809,
+    1608,   1407,   1206,   1005,    804,    603,    402,    201,      0,   -201,   -402,   -603,
+    -804,  -1005,  -1206,  -1407,  -1608,  -1809,  -2009,  -2210,  -2410,  -2611,  -2811,  -3012,
+   -3212,  -3412,  -3612,  -3811,  -4011,  -4210,  -4410,  -4609,  -4808,  -5007,  -5205,  -5404,
+   -5602,  -5800,  -5998,  -6195,  -6393,  -6590,  -6786,  -6983,  -7179,  -7375,  -7571,  -7767,
+   -7962,  -8157,  -8351,  -8545,  -8739,  -8933,  -9126,  -9319,  -9512,  -9704,  -9896, -10087,
+  -10278, -10469, -10659, -10849, -11039, -11228, -11417, -11605, -11793, -11980, -12167, -12353,
+  -12539, -12725, -12910, -13094, -13279, -13462, -13645, -13828, -14010, -14191, -14372, -14553,
+  -14732, -14912, -15090, -15269, -15446, -15623, -15800, -15976, -16151, -16325, -16499, -16673,
+  -16846, -17018, -17189, -17360, -17530, -17700, -17869, -18037, -18204, -18371, -18537, -18703,
+  -18868, -19032, -19195, -19357, -19519, -19680, -19841, -20000, -20159, -20317, -20475, -20631,
+  -20787, -20942, -21096, -21250, -21403, -21554, -21705, -21856, -22005, -22154, -22301, -22448,
+  -22594, -22739, -22884, -23027, -23170, -23311, -23452, -23592, -23731, -23870, -24007, -24143,
+  -24279, -24413, -24547, -24680, -24811, -24942, -25072, -25201, -25329, -25456, -25582, -25708,
+  -25832, -25955, -26077, -26198, -26319, -26438, -26556, -26674, -26790, -26905, -27019, -27133,
+  -27245, -27356, -27466, -27575, -27683, -27790, -27896, -28001, -28105, -28208, -28310, -28411,
+  -28510, -28609, -28706, -28803, -28898, -28992, -29085, -29177, -29268, -29358, -29447, -29534,
+  -29621, -29706, -29791, -29874, -29956, -30037, -30117, -30195, -30273, -30349, -30424, -30498,
+  -30571, -30643, -30714, -30783, -30852, -30919, -30985, -31050, -31113, -31176, -31237, -31297,
+  -31356, -31414, -31470, -31526, -31580, -31633, -31685, -31736, -31785, -31833, -31880, -31926,
+  -31971, -32014, -32057, -32098, -32137, -32176, -32213, -32250, -32285, -32318, -32351, -32382,
+  -32412, -32441, -32469, -32495, -32521, -32545, -32567, -32589, -32609, -32628, -32646, -32663,
+  -32678, -32692, -32705, -32717, -32728, -32737, -32745, -32752, -32757, -32761, -32765, -32766,
+  -32767, -32766, -32765, -32761, -32757, -32752, -32745, -32737, -32728, -32717, -32705, -32692,
+  -32678, -32663, -32646, -32628, -32609, -32589, -32567, -32545, -32521, -32495, -32469, -32441,
+  -32412, -32382, -32351, -32318, -32285, -32250, -32213, -32176, -32137, -32098, -32057, -32014,
+  -31971, -31926, -31880, -31833, -31785, -31736, -31685, -31633, -31580, -31526, -31470, -31414,
+  -31356, -31297, -31237, -31176, -31113, -31050, -30985, -30919, -30852, -30783, -30714, -30643,
+  -30571, -30498, -30424, -30349, -30273, -30195, -30117, -30037, -29956, -29874, -29791, -29706,
+  -29621, -29534, -29447, -29358, -29268, -29177, -29085, -28992, -28898, -28803, -28706, -28609,
+  -28510, -28411, -28310, -28208, -28105, -28001, -27896, -27790, -27683, -27575, -27466, -27356,
+  -27245, -27133, -27019, -26905, -26790, -26674, -26556, -26438, -26319, -26198, -26077, -25955,
+  -25832, -25708, -25582, -25456, -25329, -25201, -25072, -24942, -24811, -24680, -24547, -24413,
+  -24279, -24143, -24007, -23870, -23731, -23592, -23452, -23311, -23170, -23027, -22884, -22739,
+  -22594, -22448, -22301, -22154, -22005, -21856, -21705, -21554, -21403, -21250, -21096, -20942,
+  -20787, -20631, -20475, -20317, -20159, -20000, -19841, -19680, -19519, -19357, -19195, -19032,
+  -18868, -18703, -18537, -18371, -18204, -18037, -17869, -17700, -17530, -17360, -17189, -17018,
+  -16846, -16673, -16499, -16325, -16151, -15976, -15800, -15623, -15446, -15269, -15090, -14912,
+  -14732, -14553, -14372, -14191, -14010, -13828, -13645, -13462, -13279, -13094, -12910, -12725,
+  -12539, -12353, -12167, -11980, -11793, -11605, -11417, -11228, -11039, -10849, -10659, -10469,
+  -10278, -10087,  -9896,  -9704,  -9512,  -9319,  -9126,  -8933,  -8739,  -8545,  -8351,  -8157,
+   -7962,  -7767,  -7571,  -7375,  -7179,  -6983,  -6786,  -6590,  -6393,  -6195,  -5998,  -5800,
+   -5602,  -5404,  -5205,  -5007,  -4808,  -4609,  -4410,  -4210,  -4011,  -3811,  -3612,  -3412,
+   -3212,  -3012,  -2811,  -2611,  -2410,  -2210,  -2009,  -1809,  -1608,  -1407,  -1206,  -1005,
+    -804,   -603,   -402,   -201,      0
 };
 
+int16_t isin(uint32_t phase)
+{
+  uint32_t i = phase >> FRAC_BITS;
+  int32_t f = (phase >> (FRAC_BITS - 16)) & 0xFFFF;   // 16-bit fraction
+  int32_t s0 = sin_LUT[i];
 
-/// Internal sine LUT function, only works for positive arguments < M_TWOPI
-static float internal_sinlut(const float in) __attribute__((const));
+  return s0 + (((sin_LUT[i + 1] - s0) * f + 0x8000) >> 16);
+}
 
-float internal_sinlut(const float in)
+int16_t icos(uint32_t phase)
 {
-  uint16_t index;
-  index = in / M_TWOPI * 805;
-  return sin_LUT[index];
+  return isin(phase + (1UL << 30));
 }
 
-float sinlut(float in)
+void isincos(uint32_t phase, int16_t* s, int16_t* c)
 {
-  uint8_t neg;
-  float v;
+  *s = isin(phase);
+  *c = isin(phase + (1UL << 30));
+}
 
-  // Keeps and removes the sign of the input
-  if (in < 0) {
-    neg = 1;
-    in = -in;
-  } else neg = 0;
+void isin_n(uint32_t phase, uint32_t step, int16_t* out, uint8_t n)
+{
+  uint32_t i;
+  int32_t f, s0;
 
-  // sin(M_TWOPI * k + x) = sin(x) --> finds x for k = 0
-  while (in >= M_TWOPI)
-    in -= M_TWOPI;
+  while (n--) {
+    i = phase >> FRAC_BITS;
+    f = (phase >> (FRAC_BITS - 16)) & 0xFFFF;
+    s0 = sin_LUT[i];
+    *out++ = s0 + (((sin_LUT[i + 1] - s0) * f + 0x8000) >> 16);
+    phase += step;
+  }
+}
 
-  v = internal_sinlut (in);
-  if (neg) return -v;
-    else return v;
+float sinlut(float in)
+{
+  // the phase wraps around by itself: no range reduction, for |in| < 2^31 turns
+  return isin((uint32_t) (int64_t) (in * (float) (LUT_TURN / M_TWOPI))) * (1.0f / 32767);
 }
 
 float coslut(float in)
 {
-  return sinlut(in + M_PI_2);
+  return isin((uint32_t) (int64_t) (in * (float) (LUT_TURN / M_TWOPI)) + (1UL << 30)) * (1.0f / 32767);
 }
@@ -6,12 +6,39 @@
  * \brief  Trigonometric functions (sine, cosine) based on lookup tables
  * \author Alessandro Crespi
  * \date   July 2009
+ *
+ * The integer functions take a phase on 32 bits, a full turn being 2^32, so
+ * that the range reduction is the natural wrap-around of the integer. They
+ * interpolate linearly in a table of 2^LUT_BITS entries and return Q15
+ * values (32767 is 1), within 1.1 LSB of the exact sine.
  */
 
+#include <stdint.h>
+
+/// log2 of the number of entries of the sine table
+#define LUT_BITS 10
+
+/// Phase of a full turn, as a floating point number
+#define LUT_TURN 4294967296.0
+
 /// Lookup table based sine function
 float sinlut(float in) __attribute__((const));
 
 /// Lookup table based cosine function
 float coslut(float in) __attribute__((const));
 
+/// Sine of a phase [2^-32 turn], Q15
+int16_t isin(uint32_t phase) __attribute__((const));
+
+/// Cosine of a phase [2^-32 turn], Q15
+int16_t icos(uint32_t phase) __attribute__((const));
+
+/// Sine and cosine of a phase [2^-32 turn], Q15
+void isincos(uint32_t phase, int16_t* s, int16_t* c);
+
+/** \brief Sines of n phases in arithmetic progression, e.g. for all the joints
+ *    of a travelling wave: out[i] = isin(phase + i * step)
+ */
+void isin_n(uint32_t phase, uint32_t step, int16_t* out, uint8_t n);
+
 #endif // __LUTMATH_H
@@ -71,6 +71,8 @@
 #define MREG_EXT_DEVICE         0x61   // IR led (legs only)
 #define MREG_IR_INPUT           0x62   // IR input (legs only)
 #define MREG_RESET_VALUE        0x63   // coordinate reset (legs only)
+#define MREG_GROUP              0x64   // group of the setpoint frames, 0 for none (see can.h)
+#define MREG_GROUP_SLOT         0x65   // byte of the setpoint in the group frames
 
 // PID MREG_MODE values
 
@@ -105,6 +107,15 @@
 #define SETPOINT_SRC_SINUS      4
 ///@}
 
+// Internal generator of the modules (SETPOINT_SRC_SINUS): the setpoint is
+// MREG_INT_GEN_OFFSET + MREG_INT_GEN_AMPLITUDE * sin(2 pi t / period), in PID
+// units, t counting from the write of the setpoint source
+
+///@{
+/// Unit of MREG_INT_GEN_PERIOD [s]
+#define INT_GEN_PERIOD_UNIT     0.01f
+///@}
+
 // PID MREG_HW_OPTIONS bits
 
 ///@{
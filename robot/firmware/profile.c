@@ -0,0 +1,64 @@
+#include "profile.h"
+#include "radio.h"
+#include "hwconfig.h"
+#include "utils.h"
+
+struct section {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+};
+
+static struct section sections[PROF_MAX];
+
+static void prof_clear(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < PROF_MAX; i++) {
+    sections[i].count = 0;
+    sections[i].min = 0xFFFFFFFF;
+    sections[i].max = 0;
+    sections[i].total = 0;
+  }
+}
+
+void prof_record(uint8_t section, uint32_t tics)
+{
+  struct section* s = &sections[section];
+
+  s->count++;
+  s->total += tics;
+  if (tics < s->min) s->min = tics;
+  if (tics > s->max) s->max = tics;
+}
+
+static int8_t prof_register_handler(uint8_t operation, uint8_t address, RadioData* radio_data)
+{
+  struct section* s;
+  uint8_t* data = radio_data->multibyte.data;
+
+  if ((uint8_t) (address - REGMB_PROFILE) >= PROF_MAX) return FALSE;
+
+  switch (operation) {
+    case ROP_READ_MB:
+      s = &sections[address - REGMB_PROFILE];
+      unaligned_write_32(data, s->count);
+      unaligned_write_32(data + 4, s->count ? s->min : 0);
+      unaligned_write_32(data + 8, s->max);
+      unaligned_write_32(data + 12, s->count ? s->total / s->count : 0);
+      radio_data->multibyte.size = sizeof(struct prof_record);
+      return TRUE;
+    case ROP_WRITE_MB:
+      prof_clear();
+      return TRUE;
+  }
+  return FALSE;
+}
+
+void prof_init()
+{
+  prof_clear();
+  radio_add_reg_callback(prof_register_handler);
+}
@@ -0,0 +1,52 @@
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+/**
+ * \file   profile.h
+ * \brief  Durations of sections of the firmware, read from the PC
+ *
+ * A section (see PROF_GAIT and the others in regdefs.h) is timed between
+ * PROF_START and PROF_END with the system timer, and its count, shortest,
+ * longest and total durations are kept. The durations include the
+ * interrupts that fall in the section, and a section may contain another,
+ * e.g. the timer1 interrupt the LED writes of its user function.
+ *
+ * Each section is read over the radio as the multibyte register
+ * REGMB_PROFILE + section (struct prof_record), and a multibyte write to any
+ * of them clears them all. The records are updated and read without masking
+ * the interrupts: a record read or cleared while a section ends may be off
+ * by that one duration.
+ */
+
+#include <stdint.h>
+#include "sysTime.h"
+#include "regdefs.h"
+
+/// Compiles the timing of the sections, 0 to leave it out
+#ifndef PROFILE
+#define PROFILE 1
+#endif
+
+#if PROFILE
+/// Starts a section, declaring the variable t that holds its start
+#define PROF_START(t) uint32_t t = getSysTICs()
+/// Ends the section s started with t
+#define PROF_END(s, t) prof_record(s, getSysTICs() - (t))
+#else
+#define PROF_START(t)
+#define PROF_END(s, t)
+#endif
+
+/// Ends the section s started with t and returns v
+#define PROF_RETURN(s, t, v) do { PROF_END(s, t); return v; } while (0)
+
+/// Clears the records and installs the handler of their registers (after radio_init())
+void prof_init(void);
+
+/** \brief Adds a duration to a section
+ *  \param section Section (PROF_GAIT, ...)
+ *  \param tics Duration [system timer tics]
+ */
+void prof_record(uint8_t section, uint32_t tics);
+
+#endif // __PROFILE_H
@@ -9,6 +9,7 @@
 #include "uart.h"
 #include "uartISR.h"
 #include "utils.h"
+#include "hal.h"
 
 // Register banks
 volatile uint8_t reg8_table[REG8_MAX];       ///< 8-bit register bank
@@ -250,7 +251,7 @@ void radio_init()
   }
   uart0Init(UART_BAUD(57600), UART_8N1, UART_FIFO_8); // setup the UART
   init_uart0_isr();
-  IO0SET = LED1_BIT;   // internal LED on
+  hal_set_led1(1);     // internal LED on
   sync_radio_pic();
-  IO0CLR = LED1_BIT;   // internal LED on
+  hal_set_led1(0);     // internal LED off
 }
@@ -131,6 +131,13 @@ void start_pid(uint8_t addr)
   safe_bus_set(addr, MREG_MODE, MODE_NORMAL);
 }
 
+void set_int_gen(uint8_t addr, uint8_t period, uint8_t amplitude, int8_t offset)
+{
+  safe_bus_set(addr, MREG_INT_GEN_PERIOD, period);
+  safe_bus_set(addr, MREG_INT_GEN_AMPLITUDE, amplitude);
+  safe_bus_set(addr, MREG_INT_GEN_OFFSET, offset);
+}
+
 // Zeroes the torque bias (to be used with motor turned off!)
 static void set_torque_bias(uint8_t addr)
 {
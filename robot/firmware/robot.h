@@ -20,6 +20,9 @@ void bus_set(uint8_t module, uint8_t addr, uint8_t value);
 /// Resets the zero position and starts the PID controller of an element
 void start_pid(uint8_t addr);
 
+/// Sets the internal sine generator of an element (see module.h), without starting it
+void set_int_gen(uint8_t addr, uint8_t period, uint8_t amplitude, int8_t offset);
+
 #ifdef HAS_LEGS
 /// Resets the coordinate system on a leg element
 void reset_pos(uint8_t el);
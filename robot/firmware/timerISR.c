@@ -3,6 +3,7 @@
 #include "timerISR.h"
 #include "armVIC.h"
 #include "registers.h"
+#include "profile.h"
 
 static void timer1ISR(void) __attribute__ ((interrupt));
 
@@ -44,6 +45,7 @@ void timer1_init(uint32_t match_count)
 static void timer1ISR()
 {
   uint8_t l;
+  PROF_START(t0);
 
   // Call user timer functions
   for (l=0; l<MAX_TIMER1_USER_FUNCTIONS; l++) {
@@ -56,6 +58,7 @@ static void timer1ISR()
     }
   }
 
+  PROF_END(PROF_TIMER1_ISR, t0);
   T1IR |= 1;
   VICVectAddr = 0x00000000;
 }
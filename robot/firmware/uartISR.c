@@ -3,6 +3,7 @@
 #include "uartISR.h"
 #include "armVIC.h"
 #include "radio.h"
+#include "profile.h"
 
 void init_uart0_isr()
 {
@@ -19,12 +20,12 @@ uint8_t uart0_waitch()
   return U0RBR;
 }
 
-void uart0ISR(void)
+// Serves the interrupt sources, apart from the naked uart0ISR so that the
+// profile may keep its start time on the stack
+static void __attribute__((noinline)) uart0_service(void)
 {
   uint8_t iid;
-
-  // perform proper ISR entry so thumb-interwork works properly
-  ISR_ENTRY();
+  PROF_START(t0);
 
   // loop until not more interrupt sources
   while (((iid = U0IIR) & UIIR_NO_INT) == 0)
@@ -50,6 +51,14 @@ void uart0ISR(void)
     }
   }
 
+  PROF_END(PROF_UART_ISR, t0);
+}
+
+void uart0ISR(void)
+{
+  // perform proper ISR entry so thumb-interwork works properly
+  ISR_ENTRY();
+  uart0_service();
   VICVectAddr = 0x00000000;             // clear this interrupt from the VIC
   ISR_EXIT();                           // recover registers and return
 }
@@ -8,6 +8,8 @@ uint32_t unaligned_read_32(uint8_t* ptr);
 void unaligned_write_16(uint8_t* ptr, uint16_t val);
 void unaligned_write_32(uint8_t* ptr, uint32_t val);
 
+#ifndef NULL
 #define NULL 0
+#endif
 
 #endif // __UTILS_H
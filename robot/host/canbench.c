@@ -0,0 +1,186 @@
+/******************************************************************************
+ * canbench.c - Time taken on the simulated CAN bus to send the setpoints of
+ * a body of 3 to 10 modules, with acknowledged register writes and with
+ * group frames, and the tick rate they allow, and to read their positions
+ * one after the other and with pipelined transactions. The transactions are
+ * first checked with a register of each size.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "host.h"
+#include "hwconfig.h"
+#include "can.h"
+#include "cantrans.h"
+#include "module.h"
+
+/// Ticks timed per body
+#define TICKS 1000
+
+/// First module address of the bodies, and group
+#define FIRST_ADDR 10
+#define GROUP 1
+
+/// Register written and read with each size by the transactions
+#define SIZE_REG 0x40
+
+/// Timeout of the transactions [system timer tics]
+#define TRANS_TIMEOUT (256 * CAN_TIMEOUT)
+
+// Position of a module in the reads, different for each module and tick
+static uint8_t position(unsigned int i, unsigned int k)
+{
+  return (7 * k + 13 * i) & 0x7F;
+}
+
+// Reads the positions of n modules in pipelined transactions, returns the
+// number of wrong values
+static unsigned int read_pipelined(unsigned int n, unsigned int k)
+{
+  int8_t h[16];
+  unsigned int i, wrong = 0;
+
+  for (i = 0; i < n; i++) {
+    h[i] = can_trans_read(FIRST_ADDR + i, MREG_POSITION, 1, TRANS_TIMEOUT, NULL);
+  }
+  for (i = 0; i < n; i++) {
+    if (can_trans_wait(h[i]) != CT_DONE || can_trans_value(h[i]) != position(i, k)) wrong++;
+    can_trans_release(h[i]);
+  }
+  return wrong;
+}
+
+// Writes and reads back a register of each size with transactions, and
+// compares with the blocking functions of can.h, returns the number of
+// failures
+static unsigned int check_sizes(void)
+{
+  static const uint32_t values[] = { 0xA5, 0xBEEF, 0xDEADBEEF };
+  struct host_module* m = host_can_module(FIRST_ADDR);
+  unsigned int size, failed = 0;
+  uint32_t expected, blocking;
+  int8_t h;
+
+  for (size = 1; size <= 3; size++) {
+    expected = values[size - 1];
+    h = can_trans_write(FIRST_ADDR, SIZE_REG, size, expected, TRANS_TIMEOUT, NULL);
+    if (can_trans_wait(h) != CT_DONE) failed++;
+    can_trans_release(h);
+    h = can_trans_read(FIRST_ADDR, SIZE_REG, size, TRANS_TIMEOUT, NULL);
+    if (can_trans_wait(h) != CT_DONE || can_trans_value(h) != expected) failed++;
+    printf("%u-bit write and read: %s, read 0x%X", 8 << (size - 1),
+           can_trans_status(h) == CT_DONE ? "done" : "timeout", (unsigned int) can_trans_value(h));
+    can_trans_release(h);
+    switch (size) {
+      case 1:
+        if (m->reg8[SIZE_REG] != expected) failed++;
+        blocking = get_reg_value_b(FIRST_ADDR, SIZE_REG);
+        break;
+      case 2:
+        if (m->reg16[SIZE_REG] != expected) failed++;
+        blocking = get_reg_value_w(FIRST_ADDR, SIZE_REG);
+        break;
+      default:
+        if (m->reg32[SIZE_REG] != expected) failed++;
+        blocking = get_reg_value_dw(FIRST_ADDR, SIZE_REG);
+        break;
+    }
+    if (blocking != expected) failed++;
+    printf(", 0x%X with can.h\n", (unsigned int) blocking);
+  }
+  printf("\n");
+  return failed;
+}
+
+int main(int argc, char** argv)
+{
+  int8_t setpoint[16];
+  uint64_t t0;
+  double us_old, us_new;
+  unsigned int n, i, k, lost;
+
+  if (argc > 1) {
+    fprintf(stderr, "Usage: canbench\n");
+    fprintf(stderr, "  Compares the time taken to send the setpoints of 3 to 10 modules with one\n");
+    fprintf(stderr, "  acknowledged write per module and with group frames.\n");
+    return 1;
+  }
+
+  host_can_add(FIRST_ADDR);
+  if (check_sizes()) {
+    fprintf(stderr, "Transactions failed\n");
+    return 1;
+  }
+
+  printf("%-8s %22s %22s %8s\n", "", "writes (bus_set)", "group frames", "");
+  printf("%-8s %10s %11s %10s %11s %8s\n", "modules", "[us/tick]", "[ticks/s]", "[us/tick]",
+         "[ticks/s]", "frames");
+  for (n = 3; n <= 10; n++) {
+    for (i = 0; i < n; i++) {
+      host_can_add(FIRST_ADDR + i);
+      can_group_join(FIRST_ADDR + i, GROUP + i / CAN_GROUP_SLOTS, i % CAN_GROUP_SLOTS);
+    }
+    lost = 0;
+
+    t0 = host_cycles();
+    for (k = 0; k < TICKS; k++) {
+      for (i = 0; i < n; i++) {
+        if (!set_reg_value_b(FIRST_ADDR + i, MREG_SETPOINT, k + i)) lost++;
+      }
+    }
+    us_old = (host_cycles() - t0) * 1e6 / CCLK / TICKS;
+
+    t0 = host_cycles();
+    for (k = 0; k < TICKS; k++) {
+      for (i = 0; i < n; i++) setpoint[i] = k - i;
+      for (i = 0; i < n; i += CAN_GROUP_SLOTS) {
+        if (!can_group_setpoints(GROUP + i / CAN_GROUP_SLOTS, setpoint + i, n - i)) lost++;
+      }
+    }
+    us_new = (host_cycles() - t0) * 1e6 / CCLK / TICKS;
+
+    // the modules got the setpoints of the last tick
+    for (i = 0; i < n; i++) {
+      if ((int8_t) host_can_module(FIRST_ADDR + i)->reg8[MREG_SETPOINT] != setpoint[i]) lost++;
+    }
+    if (lost) {
+      fprintf(stderr, "%u setpoints lost with %u modules\n", lost, n);
+      return 1;
+    }
+
+    printf("%-8u %10.1f %11.0f %10.1f %11.0f %8u\n", n, us_old, 1e6 / us_old,
+           us_new, 1e6 / us_new, (n + CAN_GROUP_SLOTS - 1) / CAN_GROUP_SLOTS);
+  }
+  printf("\nOnly the CAN transfers are timed: a tick of swim_mode also pauses and uses I2C.\n\n");
+
+  printf("%-8s %22s %22s\n", "", "reads (bus_get)", "transactions");
+  printf("%-8s %10s %11s %10s %11s\n", "modules", "[us/tick]", "[ticks/s]", "[us/tick]",
+         "[ticks/s]");
+  for (n = 3; n <= 10; n++) {
+    lost = 0;
+
+    t0 = host_cycles();
+    for (k = 0; k < TICKS; k++) {
+      for (i = 0; i < n; i++) host_can_module(FIRST_ADDR + i)->reg8[MREG_POSITION] = position(i, k);
+      for (i = 0; i < n; i++) {
+        if (get_reg_value_b(FIRST_ADDR + i, MREG_POSITION) != position(i, k)) lost++;
+      }
+    }
+    us_old = (host_cycles() - t0) * 1e6 / CCLK / TICKS;
+
+    t0 = host_cycles();
+    for (k = 0; k < TICKS; k++) {
+      for (i = 0; i < n; i++) host_can_module(FIRST_ADDR + i)->reg8[MREG_POSITION] = position(i, k);
+      lost += read_pipelined(n, k);
+    }
+    us_new = (host_cycles() - t0) * 1e6 / CCLK / TICKS;
+
+    if (lost) {
+      fprintf(stderr, "%u positions wrong with %u modules\n", lost, n);
+      return 1;
+    }
+    printf("%-8u %10.1f %11.0f %10.1f %11.0f\n", n, us_old, 1e6 / us_old,
+           us_new, 1e6 / us_new);
+  }
+  return 0;
+}
@@ -0,0 +1,193 @@
+/******************************************************************************
+ * gensim.c - Runs the swimming mode of ex7 with the internal generators of
+ * the modules on the simulated hardware, checks how they are programmed and
+ * started, and that the bus is silent while the robot swims steadily
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "host.h"
+#include "hardware.h"
+#include "registers.h"
+#include "module.h"
+#include "modes.h"
+
+/// Modules of ex7, from the head to the tail
+static const uint8_t modules[] = { 25, 22, 24, 26, 5 };
+#define MODULES (sizeof(modules) / sizeof(modules[0]))
+
+/// Swimming parameters of ex7 (defaults of modes.c, as decoded from their registers)
+#define SWIM_FREQ   (DECODE_PARAM_8(ENCODE_PARAM_8(0.8f, 0.1f, 1.5f), 0.1f, 1.5f))
+#define SWIM_AMP    (DECODE_PARAM_8(ENCODE_PARAM_8(40.0f, 1.0f, 60.0f), 1.0f, 60.0f))
+#define SWIM_LAG    (DECODE_PARAM_8(ENCODE_PARAM_8(0.75f, 0.5f, 1.5f), 0.5f, 1.5f))
+
+/// Parameters written from the PC in the middle of the swim (registers of modes.c)
+#define REG8_SINE_FREQ 10
+#define REG8_SINE_LAG  12
+#define NEW_FREQ_ENC   ENCODE_PARAM_8(1.2f, 0.1f, 1.5f)
+#define NEW_LAG_ENC    ENCODE_PARAM_8(1.0f, 0.5f, 1.5f)
+#define NEW_FREQ       (DECODE_PARAM_8(NEW_FREQ_ENC, 0.1f, 1.5f))
+#define NEW_LAG        (DECODE_PARAM_8(NEW_LAG_ENC, 0.5f, 1.5f))
+
+/// Starts of the generators recorded (two per module)
+#define STARTS 2
+
+struct gen {
+  uint8_t period;           // last values written to the generator registers
+  uint8_t amplitude;
+  int8_t offset;
+  unsigned int starts;
+  double start[STARTS];     // times of the starts [s]
+  uint8_t start_period[STARTS];
+  uint8_t start_amplitude[STARTS];
+};
+
+static struct gen gens[MODULES];
+static unsigned int starts = 0;
+static double last_start, quiet_start, quiet_end;
+static uint32_t frames_at_start, frames_quiet;
+static uint8_t quiet_measured = 0;
+
+// Records the programming and the starts of the generators
+static void record(uint8_t addr, uint8_t reg, uint32_t val)
+{
+  unsigned int m;
+  struct gen* g = NULL;
+
+  for (m = 0; m < MODULES; m++) {
+    if (modules[m] == addr) g = &gens[m];
+  }
+  if (!g) return;
+
+  // frames between the end of the first start sequence and the next write
+  if (starts == MODULES && !quiet_measured) {
+    frames_quiet = host_stats.can_frames - 1 - frames_at_start;
+    quiet_start = last_start;
+    quiet_end = host_time();
+    quiet_measured = 1;
+  }
+
+  switch (reg) {
+    case MREG_INT_GEN_PERIOD:
+      g->period = val;
+      break;
+    case MREG_INT_GEN_AMPLITUDE:
+      g->amplitude = val;
+      break;
+    case MREG_INT_GEN_OFFSET:
+      g->offset = val;
+      break;
+    case MREG_SETPOINT_SOURCE:
+      if (val == SETPOINT_SRC_SINUS && g->starts < STARTS) {
+        g->start[g->starts] = host_time();
+        g->start_period[g->starts] = g->period;
+        g->start_amplitude[g->starts] = g->amplitude;
+        g->starts++;
+        starts++;
+        last_start = host_time();
+        frames_at_start = host_stats.can_frames;
+      }
+      break;
+  }
+}
+
+static int check(const char* name, double value, double expected, double tolerance)
+{
+  int ok = fabs(value - expected) <= tolerance;
+  printf("%-28s %10.4f, expected %10.4f%s\n", name, value, expected, ok ? "" : "  <- wrong");
+  return ok;
+}
+
+// Checks the generators started by the k-th start sequence
+static int check_start(unsigned int k, double freq, double lag_expected)
+{
+  double period, lag;
+  unsigned int m;
+  int ok = 1;
+
+  for (m = 0; m < MODULES; m++) {
+    if (gens[m].starts <= k) {
+      printf("Module %u not started\n", modules[m]);
+      return 0;
+    }
+  }
+  period = gens[0].start_period[k] * INT_GEN_PERIOD_UNIT;
+  ok = check("Frequency [Hz]", 1 / period, freq, 0.01 * freq) && ok;
+  ok = check("Amplitude [PID units]", gens[MODULES - 1].start_amplitude[k],
+             DEG_TO_OUTPUT_BODY(SWIM_AMP), 1) && ok;
+  for (m = 0; m + 1 < MODULES; m++) {
+    // the phase grows from the tail to the head by lag / 5 periods per module:
+    // a module starts lag / 5 periods before the next one towards the tail
+    lag = fmod(gens[m + 1].start[k] - gens[m].start[k] + 10 * period, period) / period;
+    ok = check("Phase lag [periods]", lag, lag_expected / 5, 0.001) && ok;
+  }
+  return ok;
+}
+
+int main(int argc, char** argv)
+{
+  double duration = (argc > 1) ? atof(argv[1]) : 10.0;
+  const uint8_t sync = 0xAA;
+  double swim_start, change, swim_end, first, end;
+  unsigned int m, stopped = 0;
+  int ok = 1;
+
+  if (argc > 2 || duration < 6) {
+    fprintf(stderr, "Usage: gensim [seconds]\n");
+    fprintf(stderr, "  Runs the swimming mode of ex7 with the generators of the modules, checks\n");
+    fprintf(stderr, "  their phases before and after a change of parameters in the middle, and the\n");
+    fprintf(stderr, "  bus traffic while swimming (exit status 1 if wrong). Seconds are at least 6.\n");
+    return 1;
+  }
+
+  for (m = 0; m < MODULES; m++) host_can_add(modules[m]);
+  host_can_set_hook(record);
+  host_i2c_add(RGB_ADDR);
+  host_i2c_add(BATT_ADDR);
+
+  // boot as main.c, then start the mode directly (see swimsim.c)
+  host_radio_send(0, &sync, 1);
+  hardware_init();
+  registers_init();
+  set_color_i(2, 0);
+  if (host_radio_recv() != 0x55) {
+    fprintf(stderr, "The firmware did not answer the synchronisation of the radio\n");
+    return 1;
+  }
+  modes_init();
+
+  swim_start = host_time();
+  change = swim_start + duration / 2;
+  swim_end = swim_start + duration;
+  host_radio_write_8(change, REG8_SINE_FREQ, NEW_FREQ_ENC);
+  host_radio_write_8(change, REG8_SINE_LAG, NEW_LAG_ENC);
+  host_radio_write_8(swim_end, REG8_MODE, IMODE_IDLE);
+  reg8_table[REG8_MODE] = IMODE_SWIM_GEN;
+
+  swim_gen_mode();
+
+  printf("Swimming with the generators of the modules for %.1f s of virtual time\n\n", duration);
+  ok = check_start(0, SWIM_FREQ, SWIM_LAG) && ok;
+  first = end = gens[0].start[0];
+  for (m = 0; m < MODULES; m++) {
+    if (gens[m].start[0] < first) first = gens[m].start[0];
+    if (gens[m].start[0] > end) end = gens[m].start[0];
+  }
+  printf("  started in %.3f s\n", end - first);
+  ok = check("Frames while swimming", quiet_measured ? frames_quiet : -1, 0, 0) && ok;
+  printf("  from %.3f s to %.3f s, the parameters changed at %.3f s\n", quiet_start - swim_start,
+         quiet_end - swim_start, change - swim_start);
+
+  printf("After the change of frequency and lag:\n");
+  ok = check_start(1, NEW_FREQ, NEW_LAG) && ok;
+
+  for (m = 0; m < MODULES; m++) {
+    struct host_module* mod = host_can_module(modules[m]);
+    if (mod->reg8[MREG_SETPOINT_SOURCE] == SETPOINT_SRC_I2C && mod->reg8[MREG_SETPOINT] == 0
+        && mod->reg8[MREG_MODE] == MODE_IDLE) stopped++;
+  }
+  ok = check("Modules stopped at zero", stopped, MODULES, 0) && ok;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#ifndef __HOST_H
+#define __HOST_H
+
+/**
+ * \file   host.h
+ * \brief  Simulated hardware of the head, to run the firmware on a PC
+ *
+ * The firmware runs on a virtual clock counting the cycles of the
+ * microcontroller (CCLK, 60 MHz). The clock only moves when the firmware
+ * waits or uses a peripheral: pause() and each reading of the system timer,
+ * the radio bytes, the CAN frames and the I2C transfers take the time they
+ * take on the robot, while the computations take none. The interrupts (UART
+ * receiver and timer1 user functions) are run when the clock passes their
+ * time, if they are enabled, and do not nest.
+ *
+ * The radio PIC is replaced by two byte queues, the CAN bus by modules with
+ * register banks that answer the requests of can.c and take their setpoints
+ * from the group frames, and the I2C bus by devices with 256 byte registers.
+ */
+
+#include <stdint.h>
+
+/// Categories of the virtual time
+enum {
+  HOST_PAUSE,          ///< waiting in pause() or for an interrupt
+  HOST_POLL,           ///< readings of the system timer and calls to the CAN controller
+                       ///< (the waits for the answers of the modules are pauses)
+  HOST_UART,           ///< waiting for radio bytes
+  HOST_I2C,            ///< I2C transfers
+  HOST_ADC,            ///< A/D conversions
+  HOST_TIME_MAX
+};
+
+/// Statistics of the simulated hardware since the start
+struct host_stats {
+  uint64_t cycles[HOST_TIME_MAX];  ///< virtual time per category [cycles]
+  uint32_t interrupts;             ///< interrupt routines run
+  uint32_t radio_in;               ///< bytes received from the radio
+  uint32_t radio_out;              ///< bytes sent to the radio
+  uint32_t can_frames;             ///< frames sent by the head
+  uint32_t can_lost;               ///< frames to absent modules
+  uint64_t can_busy;               ///< time the bus carried frames [cycles]
+  uint32_t can_busy_tx;            ///< frames refused, the transmit buffer being full
+  uint32_t i2c_transfers;          ///< register reads and writes on I2C
+};
+
+extern struct host_stats host_stats;
+
+/// State of the LED of the microcontroller board
+extern uint8_t host_led1;
+
+/// Values read on the A/D converter inputs (10 bits)
+extern uint16_t host_adc[4];
+
+// ---------------------------------------------------------------------------
+// Virtual clock (hostcpu.c)
+
+/// Virtual time since the start [cycles]
+uint64_t host_cycles(void);
+
+/// Virtual time since the start [s]
+double host_time(void);
+
+/// Converts a time [s] to cycles
+uint64_t host_to_cycles(double t);
+
+/// Advances the virtual clock, running the interrupts that fall due
+void host_spend(uint8_t category, uint64_t cycles);
+
+/// Advances the virtual clock to a time [cycles], if it is later than now
+void host_wait_until(uint8_t category, uint64_t t);
+
+/// Stops the program: the firmware waits for something that never comes
+void host_fail(const char* msg) __attribute__((noreturn));
+
+// ---------------------------------------------------------------------------
+// Radio (hostuart.c)
+
+/// Queues bytes from the radio PIC, received one after the other from time t [s]
+void host_radio_send(double t, const uint8_t* data, uint8_t n);
+
+/// Queues a radio write of an 8-bit register at time t [s]
+void host_radio_write_8(double t, uint16_t addr, uint8_t val);
+
+/// Queues a radio read of an 8-bit register at time t [s]
+void host_radio_read_8(double t, uint16_t addr);
+
+/// Queues a radio read of a 16-bit register at time t [s], answered low byte first
+void host_radio_read_16(double t, uint16_t addr);
+
+/// Queues a radio read of a multibyte register at time t [s], answered by its
+/// size and its bytes
+void host_radio_read_mb(double t, uint16_t addr);
+
+/// Next byte sent by the firmware to the radio PIC, -1 if none
+int host_radio_recv(void);
+
+// ---------------------------------------------------------------------------
+// CAN bus (hostcan.c)
+
+/// Registers of a simulated module
+struct host_module {
+  uint8_t reg8[256];
+  uint16_t reg16[256];
+  uint32_t reg32[256];
+};
+
+/// Function called for each register written on a module
+typedef void (*host_can_hook_t)(uint8_t addr, uint8_t reg, uint32_t val);
+
+/// Connects a module to the bus, with all its registers zeroed
+struct host_module* host_can_add(uint8_t addr);
+
+/// Registers of a module, NULL if it is not on the bus
+struct host_module* host_can_module(uint8_t addr);
+
+/// Sets the function called on register writes (NULL for none)
+void host_can_set_hook(host_can_hook_t hook);
+
+// ---------------------------------------------------------------------------
+// I2C bus (hosti2c.c)
+
+/// Connects a device to the bus, returns its registers (zeroed)
+uint8_t* host_i2c_add(uint8_t addr);
+
+/// Registers of a device, NULL if it is not on the bus
+uint8_t* host_i2c_device(uint8_t addr);
+
+// ---------------------------------------------------------------------------
+// Interrupt sources, for the virtual clock
+
+/// Time of the next UART interrupt [cycles], UINT64_MAX if none
+uint64_t host_uart_next(void);
+/// UART receiver interrupt (uart0ISR)
+void host_uart_isr(void);
+/// Time of the next timer1 interrupt [cycles], UINT64_MAX if none
+uint64_t host_timer1_next(void);
+/// Timer1 match interrupt (timer1ISR)
+void host_timer1_isr(void);
+/// Runs the interrupts due, e.g. when they are enabled again
+void host_run_interrupts(void);
+
+#endif // __HOST_H
@@ -0,0 +1,200 @@
+/******************************************************************************
+ * hostcan.c - CAN bus of the simulated head, with modules answering can.c
+ * (host implementation of LPC_CANAll.h)
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "hwconfig.h"
+#include "can.h"
+#include "module.h"
+#include "utils.h"
+
+/// Duration of a bit at 1 Mbps
+#define BIT_CYCLES (CCLK / 1000000)
+
+/// Bits of a standard frame besides the data, without stuffing
+#define FRAME_BITS 47
+
+/// Time taken by a module to answer a request
+#define MODULE_CYCLES (20 * BIT_CYCLES)
+
+/// Cost of a call to the driver of the CAN controller
+#define CALL_CYCLES 40
+
+struct rx_frame {
+  uint64_t t;          // end of the frame on the bus [cycles]
+  CANALL_MSG msg;
+};
+
+static struct host_module* modules[256];
+static host_can_hook_t hook = NULL;
+static struct rx_frame rx[MAX_QUEUE];
+static uint8_t rx_in = 0, rx_out = 0;
+static uint64_t bus_free = 0;
+static uint64_t tx_done = 0;   // end of the frame in the transmit buffer [cycles]
+
+struct host_module* host_can_add(uint8_t addr)
+{
+  if (!modules[addr]) modules[addr] = malloc(sizeof(struct host_module));
+  memset(modules[addr], 0, sizeof(struct host_module));
+  return modules[addr];
+}
+
+struct host_module* host_can_module(uint8_t addr)
+{
+  return modules[addr];
+}
+
+void host_can_set_hook(host_can_hook_t h)
+{
+  hook = h;
+}
+
+static uint64_t frame_cycles(const CANALL_MSG* msg)
+{
+  return (FRAME_BITS + 8 * ((msg->Frame >> 16) & 0x0F)) * BIT_CYCLES;
+}
+
+// Puts a frame on the bus from time t on, returns the time of its end
+static uint64_t transmit(uint64_t t, const CANALL_MSG* msg)
+{
+  if (t < bus_free) t = bus_free;
+  bus_free = t + frame_cycles(msg);
+  host_stats.can_busy += frame_cycles(msg);
+  return bus_free;
+}
+
+static void receive(uint64_t t, const CANALL_MSG* msg)
+{
+  uint8_t next = (rx_in + 1) % MAX_QUEUE;
+
+  // as in the driver, there is no overrun handling
+  if (next == rx_out) return;
+  rx[rx_in].t = t;
+  rx[rx_in].msg = *msg;
+  rx_in = next;
+}
+
+// Handles a request of can.c on a module, returns 1 and the answer if any
+static uint8_t answer(struct host_module* m, uint8_t addr, const struct can_frame* req,
+                      CANALL_MSG* ans)
+{
+  struct can_frame_b* rep = (struct can_frame_b*) &ans->DatA;
+  uint8_t size = req->size & 3;
+  uint32_t val = 0;
+
+  memset(ans, 0, sizeof(CANALL_MSG));
+  ans->MsgID = req->snd | 0x100;
+  rep->reply = 1;
+
+  if (req->write) {
+    switch (size) {
+      case 1:
+        val = m->reg8[req->reg] = req->data[0];
+        // the position controller is ideal
+        if (req->reg == MREG_SETPOINT) m->reg8[MREG_POSITION] = val;
+        break;
+      case 2:
+        val = m->reg16[req->reg] = unaligned_read_16((uint8_t*) req->data);
+        break;
+      case 3:
+        val = m->reg32[req->reg] = unaligned_read_32((uint8_t*) req->data);
+        break;
+    }
+    if (hook) hook(addr, req->reg, val);
+    if (!req->sendack) return 0;
+    rep->ack = 1;
+    ans->Frame = 0x00010000;
+    return 1;
+  }
+
+  rep->size = size;
+  switch (size) {
+    case 1:
+      rep->data[0] = m->reg8[req->reg];
+      ans->Frame = 0x00020000;
+      break;
+    case 2:
+      unaligned_write_16(rep->data, m->reg16[req->reg]);
+      ans->Frame = 0x00030000;
+      break;
+    case 3:
+      unaligned_write_32(rep->data, m->reg32[req->reg]);
+      ans->Frame = 0x00050000;
+      break;
+  }
+  return 1;
+}
+
+short CANAll_Init(unsigned short can_port, unsigned short can_isrvect, unsigned long can_btr)
+{
+  rx_in = rx_out = 0;
+  tx_done = 0;
+  return 1;
+}
+
+short CANAll_SetErrIRQ(unsigned short can_isrvect)
+{
+  return 1;
+}
+
+// Delivers a group frame to the modules of the group, each taking the
+// setpoint of its slot if the frame holds it
+static void group_frame(const CANALL_MSG* msg)
+{
+  uint8_t group = msg->MsgID - CAN_GROUP_BASE;
+  uint8_t n = (msg->Frame >> 16) & 0x0F;
+  struct host_module* m;
+  uint8_t slot;
+  int8_t val;
+  int addr;
+
+  for (addr = 0; addr < 256; addr++) {
+    m = modules[addr];
+    if (!m || m->reg8[MREG_GROUP] != group || m->reg8[MREG_GROUP_SLOT] >= n) continue;
+    slot = m->reg8[MREG_GROUP_SLOT];
+    val = (slot < 4 ? msg->DatA >> (8 * slot) : msg->DatB >> (8 * (slot - 4))) & 0xFF;
+    m->reg8[MREG_SETPOINT] = m->reg8[MREG_POSITION] = val;
+    if (hook) hook(addr, MREG_SETPOINT, (uint8_t) val);
+  }
+}
+
+short CANAll_PushMessage(unsigned short can_port, CANALL_MSG* pTransmitBuf)
+{
+  const struct can_frame* req = (const struct can_frame*) &pTransmitBuf->DatA;
+  uint8_t addr = pTransmitBuf->MsgID & 0xFF;
+  CANALL_MSG ans;
+  uint64_t t;
+
+  host_spend(HOST_POLL, CALL_CYCLES);
+  // as the driver, only the first transmit buffer is used
+  if (host_cycles() < tx_done) {
+    host_stats.can_busy_tx++;
+    return 0;
+  }
+  t = tx_done = transmit(host_cycles(), pTransmitBuf);
+  host_stats.can_frames++;
+  if (pTransmitBuf->MsgID > CAN_GROUP_BASE && pTransmitBuf->MsgID <= CAN_GROUP_BASE + 0xFF) {
+    group_frame(pTransmitBuf);
+    return 1;
+  }
+  if (!modules[addr]) {
+    host_stats.can_lost++;
+    return 1;
+  }
+  if (answer(modules[addr], addr, req, &ans)) {
+    receive(transmit(t + MODULE_CYCLES, &ans), &ans);
+  }
+  return 1;
+}
+
+short CANAll_PullMessage(unsigned short can_port, CANALL_MSG* pReceiveBuf)
+{
+  host_spend(HOST_POLL, CALL_CYCLES);
+  if (rx_in == rx_out || rx[rx_out].t > host_cycles()) return 0;
+  *pReceiveBuf = rx[rx_out].msg;
+  rx_out = (rx_out + 1) % MAX_QUEUE;
+  return 1;
+}
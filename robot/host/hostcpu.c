@@ -0,0 +1,267 @@
+/******************************************************************************
+ * hostcpu.c - Virtual clock, interrupts and timers of the simulated head
+ * (host implementation of sysTime.h, timerISR.h and armVIC.h)
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "host.h"
+#include "hal.h"
+#include "sysTime.h"
+#include "timerISR.h"
+#include "armVIC.h"
+#include "profile.h"
+
+/// Cycles per tic of the system timer
+#define CYCLES_PER_TIC (CCLK / sysTICSperSEC)
+
+/// Cost of a reading of the system timer (call and VPB access)
+#define TIMER_READ_CYCLES 12
+
+/// IRQ disable bit of the CPSR
+#define CPSR_I 0x80
+
+struct host_stats host_stats;
+uint8_t host_led1 = 0;
+
+static uint64_t now = 0;
+static uint8_t in_isr = 0;
+static unsigned cpsr = CPSR_I;        // the interrupts are disabled at reset
+
+uint64_t host_cycles()
+{
+  return now;
+}
+
+double host_time()
+{
+  return now / (double) CCLK;
+}
+
+uint64_t host_to_cycles(double t)
+{
+  return (uint64_t) (t * CCLK + 0.5);
+}
+
+void host_fail(const char* msg)
+{
+  fprintf(stderr, "t = %.6f s: %s\n", host_time(), msg);
+  exit(1);
+}
+
+static uint64_t next_interrupt(void)
+{
+  uint64_t t1 = host_uart_next(), t2 = host_timer1_next();
+  return t1 < t2 ? t1 : t2;
+}
+
+void host_run_interrupts()
+{
+  if (in_isr || (cpsr & CPSR_I)) return;
+
+  // the routines take time themselves, so that others may fall due
+  in_isr = 1;
+  while (1) {
+    if (host_uart_next() <= now) {
+      host_uart_isr();
+    } else if (host_timer1_next() <= now) {
+      host_timer1_isr();
+    } else {
+      break;
+    }
+    host_stats.interrupts++;
+  }
+  in_isr = 0;
+}
+
+void host_wait_until(uint8_t category, uint64_t t)
+{
+  uint64_t next;
+
+  host_run_interrupts();
+  while (now < t) {
+    next = t;
+    if (!in_isr && !(cpsr & CPSR_I) && next_interrupt() < next) {
+      next = next_interrupt();
+    }
+    host_stats.cycles[category] += next - now;
+    now = next;
+    host_run_interrupts();
+  }
+}
+
+void host_spend(uint8_t category, uint64_t cycles)
+{
+  host_wait_until(category, now + cycles);
+}
+
+void hal_set_led1(uint8_t on)
+{
+  host_led1 = on;
+}
+
+/******************************************************************************
+ * armVIC.h
+ *****************************************************************************/
+
+unsigned disableIRQ()
+{
+  unsigned old = cpsr;
+  cpsr |= CPSR_I;
+  return old;
+}
+
+unsigned restoreIRQ(unsigned oldCPSR)
+{
+  unsigned old = cpsr;
+  cpsr = (cpsr & ~CPSR_I) | (oldCPSR & CPSR_I);
+  host_run_interrupts();
+  return old;
+}
+
+unsigned enableIRQ()
+{
+  unsigned old = cpsr;
+  cpsr &= ~CPSR_I;
+  host_run_interrupts();
+  return old;
+}
+
+/******************************************************************************
+ * sysTime.h
+ *****************************************************************************/
+
+void initSysTime()
+{
+}
+
+uint32_t getSysTICs()
+{
+  host_spend(HOST_POLL, TIMER_READ_CYCLES);
+  return (uint32_t) (now / CYCLES_PER_TIC);
+}
+
+uint32_t getElapsedSysTICs(uint32_t startTime)
+{
+  return getSysTICs() - startTime;
+}
+
+void pause(uint32_t duration)
+{
+  uint64_t start;
+
+  getSysTICs();                         // the start is read as on the robot
+  start = now;
+  host_wait_until(HOST_PAUSE, start + (uint64_t) duration * CYCLES_PER_TIC);
+}
+
+/******************************************************************************
+ * timerISR.h
+ *****************************************************************************/
+
+struct FunctionEntry {
+  TimerFunction ptr;
+  uint16_t counter;
+  uint16_t period;
+};
+
+static struct FunctionEntry function_table[MAX_TIMER1_USER_FUNCTIONS];
+static uint64_t timer1_period = 0;      // 0 while the timer is stopped
+static uint64_t timer1_match;
+static uint8_t timer1_installed = 0;
+static uint32_t timer1_mcr = 0;         // T1MCR, only the TMCR_MR0_I bit is used
+
+void timer1_init_isr()
+{
+  disable_timer1_irq();
+  timer1_installed = 1;
+  enable_timer1_irq();
+}
+
+void timer1_init(uint32_t match_count)
+{
+  uint8_t i;
+
+  for (i=0; i<MAX_TIMER1_USER_FUNCTIONS; i++) {
+    function_table[i].ptr = 0;
+  }
+  timer1_period = (uint64_t) match_count * (CCLK / 1000000);
+  timer1_match = now + timer1_period;
+}
+
+uint64_t host_timer1_next()
+{
+  if (!timer1_period || !timer1_installed || !(timer1_mcr & TMCR_MR0_I)) return UINT64_MAX;
+  return timer1_match;
+}
+
+void host_timer1_isr()
+{
+  uint8_t l;
+  PROF_START(t0);
+
+  // a match missed while the interrupt was disabled is served once, late
+  timer1_match += timer1_period;
+  if (timer1_match <= now) timer1_match = now + timer1_period;
+
+  // Call user timer functions
+  for (l=0; l<MAX_TIMER1_USER_FUNCTIONS; l++) {
+    if (function_table[l].ptr) {
+      function_table[l].counter--;
+      if (function_table[l].counter==0) {
+        function_table[l].counter = function_table[l].period;
+        function_table[l].ptr();
+      }
+    }
+  }
+  PROF_END(PROF_TIMER1_ISR, t0);
+}
+
+uint32_t disable_timer1_irq()
+{
+  uint32_t old = timer1_mcr;
+  timer1_mcr &= ~(TMCR_MR0_I);
+  return old;
+}
+
+uint32_t enable_timer1_irq()
+{
+  uint32_t old = timer1_mcr;
+  timer1_mcr |= TMCR_MR0_I;
+  host_run_interrupts();
+  return old;
+}
+
+uint32_t restore_timer1_irq(uint32_t flag)
+{
+  uint32_t old = timer1_mcr;
+  timer1_mcr = (old & ~TMCR_MR0_I) | (flag & TMCR_MR0_I);
+  host_run_interrupts();
+  return old;
+}
+
+void timer1_add_user_function(TimerFunction tf, uint16_t period)
+{
+  uint8_t i;
+
+  for (i=0; i<MAX_TIMER1_USER_FUNCTIONS; i++) {
+    if (function_table[i].ptr == 0) {
+      function_table[i].ptr = tf;
+      function_table[i].counter = period;
+      function_table[i].period = period;
+      break;
+    }
+  }
+}
+
+void timer1_remove_user_function(TimerFunction tf)
+{
+  uint8_t i;
+
+  for (i=0; i<MAX_TIMER1_USER_FUNCTIONS; i++) {
+    if (function_table[i].ptr == tf) {
+      function_table[i].ptr = 0;
+      break;
+    }
+  }
+}
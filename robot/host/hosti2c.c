@@ -0,0 +1,107 @@
+/******************************************************************************
+ * hosti2c.c - I2C devices and A/D converter of the simulated head
+ * (host implementation of i2c.h and adc.h)
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "hwconfig.h"
+#include "i2c.h"
+#include "adc.h"
+#include "sysTime.h"
+#include "timerISR.h"
+
+/// Duration of a bit at 100 kbps
+#define BIT_CYCLES (CCLK / 100000)
+
+/// Register write: start, address, register, data and stop
+#define SET_BITS (1 + 3 * 9 + 1)
+
+/// Register read: the write of the register, repeated start, address and data
+#define GET_BITS (1 + 2 * 9 + 1 + 2 * 9 + 1)
+
+/// Address byte of a transfer to an absent device, without acknowledge
+#define NACK_BITS (1 + 9 + 1)
+
+/// A/D conversion, 11 clocks at 4.29 MHz
+#define ADC_CYCLES (11 * CCLK / 4290000)
+
+uint16_t host_adc[4];
+
+static uint8_t* devices[128];
+static uint8_t adc_channel = 0;
+
+uint8_t* host_i2c_add(uint8_t addr)
+{
+  if (!devices[addr & 0x7F]) devices[addr & 0x7F] = malloc(256);
+  memset(devices[addr & 0x7F], 0, 256);
+  return devices[addr & 0x7F];
+}
+
+uint8_t* host_i2c_device(uint8_t addr)
+{
+  return devices[addr & 0x7F];
+}
+
+void i2c_init()
+{
+}
+
+void i2c_reset()
+{
+}
+
+uint8_t i2c_set(uint8_t addr, uint8_t reg, uint8_t val)
+{
+  unsigned irqs = disable_timer1_irq();  // as on the robot, T1 ISR uses I2C sometimes...
+  uint8_t* d = devices[addr & 0x7F];
+
+  host_stats.i2c_transfers++;
+  host_spend(HOST_I2C, (d ? SET_BITS : NACK_BITS) * BIT_CYCLES);
+  if (d) d[reg] = val;
+  restore_timer1_irq(irqs);
+  return d != NULL;
+}
+
+uint8_t i2c_get(uint8_t addr, uint8_t reg)
+{
+  unsigned irqs = disable_timer1_irq();
+  uint8_t* d = devices[addr & 0x7F];
+
+  host_stats.i2c_transfers++;
+  host_spend(HOST_I2C, (d ? GET_BITS : NACK_BITS) * BIT_CYCLES);
+  restore_timer1_irq(irqs);
+  return d ? d[reg] : 0xFF;
+}
+
+void adc_init()
+{
+  adc_channel = 0;
+}
+
+void adc_set_channel(uint8_t ch)
+{
+  if (ch>3) {
+    ch = 0;
+  }
+  adc_channel = ch;
+}
+
+uint16_t adc_read()
+{
+  host_spend(HOST_ADC, ADC_CYCLES);
+  return host_adc[adc_channel] & 0x3FF;
+}
+
+uint16_t adc_read_ch(uint8_t ch)
+{
+  unsigned irqs = disable_timer1_irq();
+  uint16_t res;
+
+  adc_set_channel(ch);
+  pause(100);
+  res = adc_read();
+  restore_timer1_irq(irqs);
+  return res;
+}
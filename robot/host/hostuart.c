@@ -0,0 +1,192 @@
+/******************************************************************************
+ * hostuart.c - Radio link of the simulated head, as byte queues
+ * (host implementation of uart.h and uartISR.h)
+ *****************************************************************************/
+
+#include "host.h"
+#include "uart.h"
+#include "uartISR.h"
+#include "radio.h"
+#include "profile.h"
+
+/// Baud rate between the radio PIC and the microcontroller
+#define RADIO_BAUD 57600
+
+/// Duration of a byte on the UART (start, 8 data and stop bits)
+#define BYTE_CYCLES ((uint64_t) CCLK * 10 / RADIO_BAUD)
+
+/// Size of the queue of received bytes (power of 2)
+#define RX_QUEUE 4096
+
+struct rx_byte {
+  uint64_t t;          // arrival time [cycles]
+  uint8_t b;
+};
+
+static struct rx_byte rx[RX_QUEUE];
+static uint16_t rx_in = 0, rx_out = 0;
+static uint64_t rx_last = 0;
+static uint8_t rx_isr = 0;
+
+static uint8_t tx[UART0_TX_BUFFER_SIZE];
+static uint16_t tx_in = 0, tx_out = 0;
+
+void host_radio_send(double t, const uint8_t* data, uint8_t n)
+{
+  uint64_t c = host_to_cycles(t);
+  uint8_t i;
+
+  if (c < rx_last) c = rx_last;
+  for (i = 0; i < n; i++) {
+    if (((rx_in + 1) & (RX_QUEUE - 1)) == rx_out) host_fail("radio receive queue full");
+    c += BYTE_CYCLES;
+    rx[rx_in].t = c;
+    rx[rx_in].b = data[i];
+    rx_in = (rx_in + 1) & (RX_QUEUE - 1);
+  }
+  rx_last = c;
+}
+
+void host_radio_write_8(double t, uint16_t addr, uint8_t val)
+{
+  uint8_t b[3];
+
+  b[0] = (ROP_WRITE_8 << 2) | (addr >> 8);
+  b[1] = addr & 0xFF;
+  b[2] = val;
+  host_radio_send(t, b, 3);
+}
+
+void host_radio_read_8(double t, uint16_t addr)
+{
+  uint8_t b[2];
+
+  b[0] = (ROP_READ_8 << 2) | (addr >> 8);
+  b[1] = addr & 0xFF;
+  host_radio_send(t, b, 2);
+}
+
+void host_radio_read_16(double t, uint16_t addr)
+{
+  uint8_t b[2];
+
+  b[0] = (ROP_READ_16 << 2) | (addr >> 8);
+  b[1] = addr & 0xFF;
+  host_radio_send(t, b, 2);
+}
+
+void host_radio_read_mb(double t, uint16_t addr)
+{
+  uint8_t b[2];
+
+  b[0] = (ROP_READ_MB << 2) | (addr >> 8);
+  b[1] = addr & 0xFF;
+  host_radio_send(t, b, 2);
+}
+
+int host_radio_recv()
+{
+  int ch;
+
+  if (tx_in == tx_out) return -1;
+  ch = tx[tx_out];
+  tx_out = (tx_out + 1) % UART0_TX_BUFFER_SIZE;
+  return ch;
+}
+
+uint64_t host_uart_next()
+{
+  if (!rx_isr || rx_in == rx_out) return UINT64_MAX;
+  return rx[rx_out].t;
+}
+
+void host_uart_isr()
+{
+  PROF_START(t0);
+
+  do {
+    process_UART_in();
+  } while (rx_in != rx_out && rx[rx_out].t <= host_cycles());
+  PROF_END(PROF_UART_ISR, t0);
+}
+
+/******************************************************************************
+ * uartISR.h
+ *****************************************************************************/
+
+void init_uart0_isr()
+{
+  rx_isr = 1;
+}
+
+uint8_t uart0_waitch()
+{
+  uint8_t b;
+
+  // the byte may be taken by the interrupt routine while waiting for it
+  while (rx_in != rx_out && rx[rx_out].t > host_cycles()) {
+    host_wait_until(HOST_UART, rx[rx_out].t);
+  }
+  if (rx_in == rx_out) host_fail("the firmware waits for a radio byte that is never sent");
+  b = rx[rx_out].b;
+  rx_out = (rx_out + 1) & (RX_QUEUE - 1);
+  host_stats.radio_in++;
+  return b;
+}
+
+/******************************************************************************
+ * uart.h
+ *****************************************************************************/
+
+void uart0Init(uint16_t baud, uint8_t mode, uint8_t fmode)
+{
+  tx_in = tx_out = 0;
+}
+
+int uart0Putch(int ch)
+{
+  uint16_t next = (tx_in + 1) % UART0_TX_BUFFER_SIZE;
+
+  if (next == tx_out) return -1;
+  tx[tx_in] = ch;
+  tx_in = next;
+  host_stats.radio_out++;
+  return (uint8_t) ch;
+}
+
+uint16_t uart0Space()
+{
+  int space = (int) tx_out - tx_in - 1;
+
+  if (space < 0) space += UART0_TX_BUFFER_SIZE;
+  return space;
+}
+
+const char* uart0Puts(const char* string)
+{
+  while (*string && uart0Putch(*string) >= 0) string++;
+  return string;
+}
+
+int uart0Write(const char* buffer, uint16_t count)
+{
+  if (count > uart0Space()) return -1;
+  while (count && uart0Putch(*buffer++) >= 0) count--;
+  return count ? -2 : 0;
+}
+
+int uart0TxEmpty()
+{
+  return 1;
+}
+
+void uart0TxFlush()
+{
+  tx_in = tx_out = 0;
+}
+
+int uart0Getch()
+{
+  if (rx_in == rx_out || rx[rx_out].t > host_cycles()) return -1;
+  return uart0_waitch();
+}
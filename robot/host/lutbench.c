@@ -0,0 +1,164 @@
+/******************************************************************************
+ * lutbench.c - Accuracy and host time of the sine functions of lutmath.c,
+ * against sin() and sinf() of the C library
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "lutmath.h"
+
+/// Phases checked for the accuracy, evenly spread over a turn
+#define ACCURACY_POINTS (1 << 22)
+
+/// Calls timed per function
+#define SPEED_CALLS 10000000
+
+/// Joints filled per call of isin_n, as in ex7
+#define JOINTS 5
+
+/// Arbitrary phase increment, to avoid an easy pattern in the table accesses
+#define STEP 0x9E3779B9UL
+
+static double now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Largest error of a Q15 function of the phase [LSB]
+static double q15_error(int16_t (*f)(uint32_t), double shift)
+{
+  double e, max = 0;
+  uint32_t k, phase;
+
+  for (k = 0; k < ACCURACY_POINTS; k++) {
+    phase = k * (uint32_t) (LUT_TURN / ACCURACY_POINTS) + k;
+    e = fabs(f(phase) - 32767 * sin(2 * M_PI * (phase / LUT_TURN) + shift));
+    if (e > max) max = e;
+  }
+  return max;
+}
+
+// Largest error of a float function of the angle [LSB of Q15]
+static double float_error(float (*f)(float), double shift, double turns)
+{
+  double a, e, max = 0;
+  uint32_t k;
+
+  for (k = 0; k < ACCURACY_POINTS; k++) {
+    a = (float) (2 * M_PI * turns * k / ACCURACY_POINTS);
+    e = fabs(f(a) - sin(a + shift));
+    if (e > max) max = e;
+  }
+  return max * 32767;
+}
+
+static int16_t isincos_sin(uint32_t phase)
+{
+  int16_t s, c;
+
+  isincos(phase, &s, &c);
+  return s;
+}
+
+static int16_t isincos_cos(uint32_t phase)
+{
+  int16_t s, c;
+
+  isincos(phase, &s, &c);
+  return c;
+}
+
+static int16_t isin_n_last(uint32_t phase)
+{
+  int16_t out[JOINTS];
+
+  isin_n(phase - (JOINTS - 1) * STEP, STEP, out, JOINTS);
+  return out[JOINTS - 1];
+}
+
+int main(int argc, char** argv)
+{
+  volatile double dsink = 0;
+  volatile float fsink = 0;
+  volatile int isink = 0;
+  int16_t s, c, out[JOINTS];
+  uint32_t k, phase;
+  float a;
+  double t0, ns[7];
+
+  if (argc > 1) {
+    fprintf(stderr, "Usage: lutbench\n");
+    fprintf(stderr, "  Compares the error and the speed of the lookup table sines of lutmath.c\n");
+    fprintf(stderr, "  with those of the C library.\n");
+    return 1;
+  }
+
+  printf("Table of %d entries, %d phases per turn checked\n\n", 1 << LUT_BITS, ACCURACY_POINTS);
+  printf("%-26s %8s\n", "", "max err");
+  printf("%-26s %8s\n", "", "[LSB]");
+  printf("%-26s %8.2f\n", "isin", q15_error(isin, 0));
+  printf("%-26s %8.2f\n", "icos", q15_error(icos, M_PI / 2));
+  printf("%-26s %8.2f\n", "isincos (sine)", q15_error(isincos_sin, 0));
+  printf("%-26s %8.2f\n", "isincos (cosine)", q15_error(isincos_cos, M_PI / 2));
+  printf("%-26s %8.2f\n", "isin_n", q15_error(isin_n_last, 0));
+  printf("%-26s %8.2f\n", "sinlut, 1 turn", float_error(sinlut, 0, 1));
+  printf("%-26s %8.2f\n", "coslut, 1 turn", float_error(coslut, M_PI / 2, 1));
+  printf("%-26s %8.2f\n", "sinf, 1 turn", float_error(sinf, 0, 1));
+  // the conversion of a float angle to a phase is rounded to 24 bits
+  printf("%-26s %8.2f\n", "sinlut, 1000 turns", float_error(sinlut, 0, 1000));
+  printf("%-26s %8.2f\n", "sinf, 1000 turns", float_error(sinf, 0, 1000));
+
+  // large angles take the time of small ones (the old sinlut looped per turn)
+  t0 = now_ns();
+  for (k = 0; k < SPEED_CALLS / 100; k++) fsink += sinlut(1e6f + k);
+  printf("\nsinlut of angles near 1e6: %.1f ns per call\n\n",
+         (now_ns() - t0) / (SPEED_CALLS / 100));
+
+  t0 = now_ns();
+  for (k = 0, a = 0; k < SPEED_CALLS; k++, a += 0.001f) dsink += sin(a);
+  ns[0] = (now_ns() - t0) / SPEED_CALLS;
+  t0 = now_ns();
+  for (k = 0, a = 0; k < SPEED_CALLS; k++, a += 0.001f) fsink += sinf(a);
+  ns[1] = (now_ns() - t0) / SPEED_CALLS;
+  t0 = now_ns();
+  for (k = 0, a = 0; k < SPEED_CALLS; k++, a += 0.001f) fsink += sinlut(a);
+  ns[2] = (now_ns() - t0) / SPEED_CALLS;
+  t0 = now_ns();
+  for (k = 0, phase = 0; k < SPEED_CALLS; k++, phase += STEP) isink += isin(phase);
+  ns[3] = (now_ns() - t0) / SPEED_CALLS;
+  t0 = now_ns();
+  for (k = 0, phase = 0; k < SPEED_CALLS; k++, phase += STEP) {
+    isincos(phase, &s, &c);
+    isink += s + c;
+  }
+  ns[4] = (now_ns() - t0) / SPEED_CALLS;
+  t0 = now_ns();
+  for (k = 0, phase = 0; k < SPEED_CALLS; k++, phase += STEP) {
+    isin_n(phase, STEP, out, JOINTS);
+    isink += out[0] + out[JOINTS - 1];
+  }
+  ns[5] = (now_ns() - t0) / SPEED_CALLS / JOINTS;
+  t0 = now_ns();
+  for (k = 0, phase = 0; k < SPEED_CALLS; k++, phase += STEP) {
+    int i;
+    for (i = 0; i < JOINTS; i++) out[i] = isin(phase + i * STEP);
+    isink += out[0] + out[JOINTS - 1];
+  }
+  ns[6] = (now_ns() - t0) / SPEED_CALLS / JOINTS;
+
+  printf("%-26s %8s\n", "", "host time");
+  printf("%-26s %8s\n", "", "[ns/sine]");
+  printf("%-26s %8.2f\n", "sin", ns[0]);
+  printf("%-26s %8.2f\n", "sinf", ns[1]);
+  printf("%-26s %8.2f\n", "sinlut", ns[2]);
+  printf("%-26s %8.2f\n", "isin", ns[3]);
+  printf("%-26s %8.2f\n", "isincos (2 values)", ns[4] / 2);
+  printf("%-26s %8.2f\n", "isin_n, 5 joints", ns[5]);
+  printf("%-26s %8.2f\n", "isin per joint, 5 joints", ns[6]);
+  return 0;
+}
@@ -0,0 +1,208 @@
+/******************************************************************************
+ * oscbench.c - Compares the fixed-point CPG of swim_mode, once converged, with
+ * the float time and sin() it replaced: error against an exact wave, drift
+ * and host time per tick
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "cpg.h"
+#include "sysTime.h"
+#include "module.h"
+#include "regdefs.h"
+
+/// Joints of ex7
+#define JOINTS 5
+
+/// Average loop period of ex7 on the simulated hardware (see swimsim) [tics]
+#define TICK 28940
+
+/// Coupling and convergence rate of the CPG of ex7 (see modes.c) [1/s]
+#define CPG_COUPLING 5.0f
+#define CPG_RATE 2.0f
+
+/// Phase of a full turn of the CPG, as a floating point number
+#define TURN 4294967296.0
+
+/// Tics between the two timer readings of the float version, lost each tick
+#define LOST_TICS 4
+
+/// Parameters of ex7 (defaults of modes.c)
+static const float FREQ = DECODE_PARAM_8(ENCODE_PARAM_8(0.8f, 0.1f, 1.5f), 0.1f, 1.5f);
+static const float AMP = DECODE_PARAM_8(ENCODE_PARAM_8(40.0f, 1.0f, 60.0f), 1.0f, 60.0f);
+static const float LAG = DECODE_PARAM_8(ENCODE_PARAM_8(0.75f, 0.5f, 1.5f), 0.5f, 1.5f);
+static const float OFF = DECODE_PARAM_8(ENCODE_PARAM_8(0.0f, -3.0f, 3.0f), -3.0f, 3.0f);
+
+struct result {
+  int max_error;             // largest setpoint error [units]
+  unsigned long off;         // setpoints differing from the exact ones
+  double drift;              // phase error at the end [turns]
+  double ns;                 // host time per tick
+};
+
+static uint32_t seed = 1;
+
+// Loop period with some jitter, the same sequence for each version
+static uint32_t next_tick(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return TICK - 50 + (seed >> 16) % 100;
+}
+
+// Setpoints of the exact wave at time t [s]
+static void exact_wave(double t, int8_t* out)
+{
+  uint8_t i;
+
+  for (i = 0; i < JOINTS; i++) {
+    out[i] = (int8_t) (AMP * BODY_OUTPUT_RATIO_DEG
+                       * sin(2 * M_PI * (FREQ * t + i * LAG / 5 + OFF)));
+  }
+}
+
+// swim_mode before the CPG: decoding of the parameters, float time
+// and one sin() per joint
+static void float_wave(float* my_time, uint32_t dt, int8_t* out)
+{
+  float freq, amplitude, lag, offset, delta_t, angle;
+  uint8_t i;
+
+  freq = FREQ;
+  amplitude = AMP;
+  lag = LAG;
+  offset = OFF;
+  delta_t = (float) dt / sysTICSperSEC;
+  *my_time += delta_t;
+  for (i = 0; i < JOINTS; i++) {
+    angle = amplitude * sin(M_TWOPI * ((freq * *my_time) + (i * lag / 5) + offset));
+    out[i] = DEG_TO_OUTPUT_BODY(angle);
+  }
+}
+
+// Starts a chain on the wave that swim_mode reaches once its parameters have
+// converged: the coupling terms are then zero and the phases keep the lag
+static void start_cpg(struct cpg* c)
+{
+  uint8_t i;
+
+  cpg_init(c, JOINTS, CPG_COUPLING, CPG_RATE);
+  cpg_set(c, FREQ, LAG / 5);
+  for (i = 0; i < JOINTS; i++) cpg_set_joint(c, i, AMP * BODY_OUTPUT_RATIO_DEG, 0, OFF);
+  c->step = c->step_target;
+  for (i = 0; i < JOINTS; i++) {
+    c->phase[i] = i * c->lag;
+    c->amplitude[i] = c->amplitude_target[i];
+    c->shift[i] = c->shift_target[i];
+  }
+}
+
+static void fixed_wave(struct cpg* c, uint32_t dt, int8_t* out)
+{
+  cpg_advance(c, dt);
+  cpg_outputs(c, out);
+}
+
+// Phase error of a wave of phase p at time t [turns], in [-0.5, 0.5]
+static double phase_error(double p, double t)
+{
+  double e = fmod(p - FREQ * t, 1.0);
+
+  if (e > 0.5) e -= 1;
+  if (e < -0.5) e += 1;
+  return e;
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void run(int fixed, unsigned long ticks, struct result* r)
+{
+  struct cpg w;
+  float my_time = 0;
+  uint64_t tics = 0;
+  int8_t out[JOINTS], ref[JOINTS];
+  unsigned long k;
+  uint32_t dt;
+  uint8_t i;
+  volatile int sink = 0;
+  double t0;
+
+  r->max_error = 0;
+  r->off = 0;
+  start_cpg(&w);
+  seed = 1;
+  for (k = 0; k < ticks; k++) {
+    dt = next_tick();
+    tics += dt;
+    if (fixed) {
+      fixed_wave(&w, dt, out);
+    } else {
+      float_wave(&my_time, dt - LOST_TICS, out);
+    }
+    exact_wave(tics / (double) sysTICSperSEC, ref);
+    for (i = 0; i < JOINTS; i++) {
+      if (abs(out[i] - ref[i]) > r->max_error) r->max_error = abs(out[i] - ref[i]);
+      if (out[i] != ref[i]) r->off++;
+    }
+  }
+  if (fixed) {
+    r->drift = phase_error((w.phase[0] + w.frac[0] / 65536.0) / TURN, tics / (double) sysTICSperSEC);
+  } else {
+    r->drift = phase_error(FREQ * my_time, tics / (double) sysTICSperSEC);
+  }
+
+  // timing, without the exact wave
+  start_cpg(&w);
+  my_time = 0;
+  seed = 1;
+  t0 = now_ns();
+  for (k = 0; k < ticks; k++) {
+    dt = next_tick();
+    if (fixed) {
+      fixed_wave(&w, dt, out);
+    } else {
+      float_wave(&my_time, dt - LOST_TICS, out);
+    }
+    sink += out[0] + out[JOINTS - 1];
+  }
+  r->ns = (now_ns() - t0) / ticks;
+}
+
+static void print(const char* name, const struct result* r, unsigned long ticks)
+{
+  printf("%-24s %7d %12.3f%% %+14.6f %10.1f\n", name, r->max_error,
+         100.0 * r->off / (ticks * JOINTS), r->drift, r->ns);
+}
+
+int main(int argc, char** argv)
+{
+  double duration = (argc > 1) ? atof(argv[1]) : 3600;
+  unsigned long ticks;
+  struct result fl, fx;
+
+  if (argc > 2 || duration <= 0) {
+    fprintf(stderr, "Usage: oscbench [seconds]\n");
+    fprintf(stderr, "  Compares the wave of swim_mode computed with the fixed-point CPG\n");
+    fprintf(stderr, "  and with float time and sin(), against the exact wave.\n");
+    return 1;
+  }
+  ticks = duration * sysTICSperSEC / TICK;
+
+  run(0, ticks, &fl);
+  run(1, ticks, &fx);
+
+  printf("%d joints, %lu ticks of %.3f ms on average (%.0f s)\n\n", JOINTS, ticks,
+         TICK * 1000.0 / sysTICSperSEC, duration);
+  printf("%-24s %7s %13s %14s %10s\n", "", "max err", "setpoints", "phase error", "host time");
+  printf("%-24s %7s %13s %14s %10s\n", "", "[units]", "off", "[turns]", "[ns/tick]");
+  print("float time and sin()", &fl, ticks);
+  print("fixed-point CPG", &fx, ticks);
+  return 0;
+}
@@ -0,0 +1,327 @@
+/******************************************************************************
+ * swimsim.c - Runs the swimming firmware of ex7 on the simulated hardware,
+ * checks the wave it sends to the modules, before and after a change of its
+ * parameters (the offset steers: it moves the mean of the setpoints), and
+ * measures its control loop
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "host.h"
+#include "hardware.h"
+#include "registers.h"
+#include "module.h"
+#include "modes.h"
+
+/// Modules of ex7, from the head to the tail
+static const uint8_t modules[] = { 25, 22, 24, 26, 5 };
+#define MODULES (sizeof(modules) / sizeof(modules[0]))
+
+/// Largest number of setpoints recorded per module
+#define MAX_SETPOINTS 200000
+
+/// Swimming parameters of ex7 (defaults of modes.c, as decoded from their registers)
+#define SWIM_FREQ   (DECODE_PARAM_8(ENCODE_PARAM_8(0.8f, 0.1f, 1.5f), 0.1f, 1.5f))
+#define SWIM_AMP    (DECODE_PARAM_8(ENCODE_PARAM_8(40.0f, 1.0f, 60.0f), 1.0f, 60.0f))
+#define SWIM_LAG    (DECODE_PARAM_8(ENCODE_PARAM_8(0.75f, 0.5f, 1.5f), 0.5f, 1.5f))
+
+/// Parameters written from the PC in the middle of the swim (registers of modes.c)
+#define REG8_SINE_FREQ 10
+#define REG8_SINE_LAG  12
+#define REG8_SINE_OFF  13
+#define NEW_FREQ_ENC   ENCODE_PARAM_8(1.2f, 0.1f, 1.5f)
+#define NEW_LAG_ENC    ENCODE_PARAM_8(1.0f, 0.5f, 1.5f)
+#define NEW_FREQ       (DECODE_PARAM_8(NEW_FREQ_ENC, 0.1f, 1.5f))
+#define NEW_LAG        (DECODE_PARAM_8(NEW_LAG_ENC, 0.5f, 1.5f))
+#define NEW_OFF_ENC    ENCODE_PARAM_8(2.0f, -3.0f, 3.0f)
+#define NEW_OFF        (DECODE_PARAM_8(NEW_OFF_ENC, -3.0f, 3.0f))
+#define SWIM_OFF       (DECODE_PARAM_8(ENCODE_PARAM_8(0.0f, -3.0f, 3.0f), -3.0f, 3.0f))
+
+/// Registers of the control tick (modes.c), and its default rate [Hz]
+#define REG16_TICK_RATE     20
+#define REG16_TICK_PERIOD   21
+#define REG16_TICK_JITTER   22
+#define REG16_TICK_OVERRUNS 23
+#define TICK_RATE           200
+
+/// Sections of the profile of the firmware (regdefs.h)
+static const char* sections[PROF_MAX] = { "gait", "CAN", "I2C LED", "UART ISR", "timer1 ISR" };
+
+/// Largest jitter of the tick [us]: the polling of the tick by the loop
+#define MAX_JITTER 20
+
+/// Time for the wave to settle after a change of its parameters [s]
+#define SETTLE 3.0
+
+/// Largest error of the mean setpoint of the tail over whole periods, which
+/// is the offset [PID units]
+#define MAX_MEAN_ERROR 0.5
+
+/// Largest change of a setpoint between two iterations [PID units]: the
+/// wave never jumps, also when its parameters change
+#define MAX_STEP 3
+
+struct setpoint {
+  double t;
+  int8_t val;
+};
+
+static struct setpoint* setpoints[MODULES];
+static unsigned int count[MODULES];
+static double swim_start, swim_end;
+static struct host_stats first, last;   // at the first and last head setpoints
+static clock_t cpu_first, cpu_last;
+
+// Records the setpoints sent while swimming
+static void record(uint8_t addr, uint8_t reg, uint32_t val)
+{
+  unsigned int i;
+  double t = host_time();
+
+  if (reg != MREG_SETPOINT || t < swim_start || t > swim_end) return;
+  if (addr == modules[0]) {
+    if (!count[0]) {
+      first = host_stats;
+      cpu_first = clock();
+    }
+    last = host_stats;
+    cpu_last = clock();
+  }
+  for (i = 0; i < MODULES; i++) {
+    if (modules[i] == addr && count[i] < MAX_SETPOINTS) {
+      setpoints[i][count[i]].t = t;
+      setpoints[i][count[i]].val = val;
+      count[i]++;
+    }
+  }
+}
+
+// Times of the upward zero crossings of the setpoint of a module, from t0 to t1
+static unsigned int crossings(unsigned int m, double t0, double t1, double* t, unsigned int max)
+{
+  unsigned int i, n = 0;
+
+  for (i = 1; i < count[m] && n < max; i++) {
+    if (setpoints[m][i].t < t0 || setpoints[m][i].t > t1) continue;
+    if (setpoints[m][i - 1].val < 0 && setpoints[m][i].val >= 0) t[n++] = setpoints[m][i].t;
+  }
+  return n;
+}
+
+// Mean setpoint of a module over the whole periods from t0 to t1
+static double mean_setpoint(unsigned int m, double t0, double t1)
+{
+  double tc[64], sum = 0;
+  unsigned int i, nc, n = 0;
+
+  nc = crossings(m, t0, t1, tc, 64);
+  for (i = 0; nc >= 2 && i < count[m]; i++) {
+    if (setpoints[m][i].t < tc[0] || setpoints[m][i].t >= tc[nc - 1]) continue;
+    sum += setpoints[m][i].val;
+    n++;
+  }
+  return n ? sum / n : 0;
+}
+
+static int check(const char* name, double value, double expected, double tolerance)
+{
+  int ok = fabs(value - expected) <= tolerance;
+  printf("%-28s %10.4f, expected %10.4f%s\n", name, value, expected, ok ? "" : "  <- wrong");
+  return ok;
+}
+
+// Checks the frequency on the tail and the lag between neighbours, from t0 to t1
+static int check_wave(double t0, double t1, double freq, double lag_expected)
+{
+  double tc[64], tn[64], period, lag;
+  unsigned int m, n, nn;
+  int ok = 1;
+
+  n = crossings(MODULES - 1, t0, t1, tc, 64);
+  if (n < 3) {
+    fprintf(stderr, "Too few periods, swim longer\n");
+    exit(1);
+  }
+  period = (tc[n - 1] - tc[0]) / (n - 1);
+  ok = check("Frequency [Hz]", 1 / period, freq, 0.01 * freq) && ok;
+  for (m = 0; m + 1 < MODULES; m++) {
+    // the phase grows from the tail to the head by lag / 5 periods per module
+    n = crossings(m, t0, t1, tn, 64);
+    nn = crossings(m + 1, t0, t1, tc, 64);
+    if (n < 2 || nn < 2) break;
+    lag = fmod(tc[1] - tn[1] + 10 * period, period) / period;
+    ok = check("Phase lag [periods]", lag, lag_expected / 5, 0.01) && ok;
+  }
+  return ok;
+}
+
+// 16-bit answer of the radio, -1 if none
+static int recv_16(void)
+{
+  int lo = host_radio_recv(), hi = host_radio_recv();
+
+  return (lo < 0 || hi < 0) ? -1 : (hi << 8) | lo;
+}
+
+// Reads the answer to a multibyte read of a profile section, returns 0 if wrong
+static int recv_prof(struct prof_record* r)
+{
+  uint8_t b[sizeof(struct prof_record)];
+  unsigned int i;
+  int ch;
+
+  if (host_radio_recv() != sizeof(struct prof_record)) return 0;
+  for (i = 0; i < sizeof(b); i++) {
+    if ((ch = host_radio_recv()) < 0) return 0;
+    b[i] = ch;
+  }
+  r->count = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t) b[3] << 24);
+  r->min = b[4] | (b[5] << 8) | (b[6] << 16) | ((uint32_t) b[7] << 24);
+  r->max = b[8] | (b[9] << 8) | (b[10] << 16) | ((uint32_t) b[11] << 24);
+  r->mean = b[12] | (b[13] << 8) | (b[14] << 16) | ((uint32_t) b[15] << 24);
+  return 1;
+}
+
+int main(int argc, char** argv)
+{
+  double duration = (argc > 1) ? atof(argv[1]) : 20.0;
+  const uint8_t sync = 0xAA;
+  double period, change, loop_max = 0;
+  unsigned int i, m, loops, stopped = 0;
+  int peak = 0, jump = 0, ok = 1, rate, tick_period, jitter, overruns;
+  struct prof_record prof[PROF_MAX];
+  uint8_t* rgb;
+
+  if (argc > 2 || duration < 4 * SETTLE) {
+    fprintf(stderr, "Usage: swimsim [seconds]\n");
+    fprintf(stderr, "  Runs the swimming mode of ex7 on a simulated head and modules, checks the\n");
+    fprintf(stderr, "  wave sent to the modules (exit status 1 if wrong) and times its loop.\n");
+    fprintf(stderr, "  The frequency, lag and offset change in the middle, seconds are at least %.0f.\n",
+            4 * SETTLE);
+    return 1;
+  }
+
+  for (m = 0; m < MODULES; m++) {
+    host_can_add(modules[m]);
+    setpoints[m] = malloc(MAX_SETPOINTS * sizeof(struct setpoint));
+  }
+  host_can_set_hook(record);
+  rgb = host_i2c_add(RGB_ADDR);
+  host_i2c_add(BATT_ADDR);
+
+  // boot as main.c, the radio PIC sends the synchronisation byte
+  host_radio_send(0, &sync, 1);
+  hardware_init();
+  registers_init();
+  set_color_i(2, 0);
+  if (host_radio_recv() != 0x55) {
+    fprintf(stderr, "The firmware did not answer the synchronisation of the radio\n");
+    return 1;
+  }
+  modes_init();
+
+  // main_mode_loop() waits for a mode without using the clock, which only a
+  // real interrupt can end: the mode is started directly, and stopped by a
+  // radio write as from the PC, after a radio read of the mode, a change of
+  // the parameters and the reading of the tick statistics and of the profile
+  swim_start = host_time() + 0.5;
+  swim_end = swim_start + duration;
+  change = swim_start + duration / 2;
+  host_radio_read_8(change - 1, REG8_MODE);
+  host_radio_write_8(change, REG8_SINE_FREQ, NEW_FREQ_ENC);
+  host_radio_write_8(change, REG8_SINE_LAG, NEW_LAG_ENC);
+  host_radio_write_8(change, REG8_SINE_OFF, NEW_OFF_ENC);
+  host_radio_read_16(swim_end - 0.5, REG16_TICK_RATE);
+  host_radio_read_16(swim_end - 0.5, REG16_TICK_PERIOD);
+  host_radio_read_16(swim_end - 0.5, REG16_TICK_JITTER);
+  host_radio_read_16(swim_end - 0.5, REG16_TICK_OVERRUNS);
+  for (i = 0; i < PROF_MAX; i++) host_radio_read_mb(swim_end - 0.5, REGMB_PROFILE + i);
+  host_radio_write_8(swim_end, REG8_MODE, IMODE_IDLE);
+  reg8_table[REG8_MODE] = IMODE_SWIM;
+
+  swim_mode();
+
+  printf("Swimming for %.1f s of virtual time\n\n", duration);
+  ok = check("Radio read of the mode", host_radio_recv(), IMODE_SWIM, 0) && ok;
+  rate = recv_16();
+  tick_period = recv_16();
+  jitter = recv_16();
+  overruns = recv_16();
+  for (i = 0; i < PROF_MAX; i++) {
+    if (!recv_prof(&prof[i])) {
+      fprintf(stderr, "No answer to the read of the profile\n");
+      return 1;
+    }
+  }
+  for (m = 0; m < MODULES; m++) {
+    struct host_module* mod = host_can_module(modules[m]);
+    if (mod->reg8[MREG_SETPOINT] == 0 && mod->reg8[MREG_MODE] == MODE_IDLE) stopped++;
+  }
+  ok = check("Modules stopped at zero", stopped, MODULES, 0) && ok;
+  ok = check("Head LED green", rgb[3] != 0 && rgb[2] == 0 && rgb[4] == 0, 1, 0) && ok;
+
+  // wave: amplitude (before the offset), frequency and offset on the tail,
+  // lag between neighbours, once settled from the start and from the
+  // change, and no jump of the setpoints
+  m = MODULES - 1;
+  for (i = 0; i < count[m] && setpoints[m][i].t < change; i++) {
+    if (abs(setpoints[m][i].val) > peak) peak = abs(setpoints[m][i].val);
+  }
+  ok = check("Amplitude [PID units]", peak, DEG_TO_OUTPUT_BODY(SWIM_AMP), 1) && ok;
+  ok = check_wave(swim_start + SETTLE, change, SWIM_FREQ, SWIM_LAG) && ok;
+  ok = check("Mean setpoint [PID units]", mean_setpoint(m, swim_start + SETTLE, change),
+             SWIM_OFF * BODY_OUTPUT_RATIO_DEG, MAX_MEAN_ERROR) && ok;
+  printf("After the change of frequency, lag and offset:\n");
+  ok = check_wave(change + SETTLE, swim_end, NEW_FREQ, NEW_LAG) && ok;
+  ok = check("Mean setpoint [PID units]", mean_setpoint(m, change + SETTLE, swim_end),
+             NEW_OFF * BODY_OUTPUT_RATIO_DEG, MAX_MEAN_ERROR) && ok;
+  for (m = 0; m < MODULES; m++) {
+    for (i = 1; i < count[m]; i++) {
+      if (abs(setpoints[m][i].val - setpoints[m][i - 1].val) > jump) {
+        jump = abs(setpoints[m][i].val - setpoints[m][i - 1].val);
+      }
+    }
+  }
+  ok = check("Largest setpoint step", jump, 0, MAX_STEP) && ok;
+
+  // control loop, from the head setpoints
+  loops = count[0] > 1 ? count[0] - 1 : 1;
+  period = (setpoints[0][count[0] - 1].t - setpoints[0][0].t) / loops;
+  for (i = 1; i < count[0]; i++) {
+    if (setpoints[0][i].t - setpoints[0][i - 1].t > loop_max) {
+      loop_max = setpoints[0][i].t - setpoints[0][i - 1].t;
+    }
+  }
+  ok = check("Tick rate [Hz]", rate, TICK_RATE, 0) && ok;
+  ok = check("Tick period [us]", tick_period, 1e6 / TICK_RATE, 1) && ok;
+  ok = check("Tick jitter [us]", jitter, 0, MAX_JITTER) && ok;
+  ok = check("Tick overruns", overruns, 0, 0) && ok;
+
+  printf("\nControl loop: %u iterations, %.3f ms on average, %.3f ms at most\n", loops,
+         period * 1000, loop_max * 1000);
+  printf("  per iteration: %.1f CAN frames (bus busy %.3f ms), %.1f I2C transfers\n",
+         (last.can_frames - first.can_frames) / (double) loops,
+         (last.can_busy - first.can_busy) * 1000.0 / CCLK / loops,
+         (last.i2c_transfers - first.i2c_transfers) / (double) loops);
+  printf("  virtual time: pauses %.3f ms, polling %.3f ms, I2C %.3f ms, A/D %.3f ms\n",
+         (last.cycles[HOST_PAUSE] - first.cycles[HOST_PAUSE]) * 1000.0 / CCLK / loops,
+         (last.cycles[HOST_POLL] - first.cycles[HOST_POLL]) * 1000.0 / CCLK / loops,
+         (last.cycles[HOST_I2C] - first.cycles[HOST_I2C]) * 1000.0 / CCLK / loops,
+         (last.cycles[HOST_ADC] - first.cycles[HOST_ADC]) * 1000.0 / CCLK / loops);
+  printf("  host CPU time: %.3f us (the computations take no virtual time)\n",
+         (double) (cpu_last - cpu_first) / CLOCKS_PER_SEC * 1e6 / loops);
+
+
+  // profile of the firmware, from the boot (the computations and the
+  // interrupts take no virtual time but the readings of the timer)
+  printf("\nProfile of the firmware, as read from the radio:\n");
+  printf("  %-12s %8s %10s %10s %10s\n", "", "count", "min [us]", "mean [us]", "max [us]");
+  for (i = 0; i < PROF_MAX; i++) {
+    printf("  %-12s %8u %10.1f %10.1f %10.1f\n", sections[i], prof[i].count, prof[i].min / 10.0,
+           prof[i].mean / 10.0, prof[i].max / 10.0);
+  }
+
+  return ok ? 0 : 1;
+}